@@ -0,0 +1,13 @@
+macro ( ADD_ANMP_BENCHMARK _bench )
+    ADD_EXECUTABLE(${_bench} ${_bench}.cpp )
+
+    # only build this benchmark when explicitly requested by "make bench"
+    set_target_properties(${_bench} PROPERTIES EXCLUDE_FROM_ALL TRUE)
+
+    TARGET_LINK_LIBRARIES(${_bench} anmp)
+
+    # run the benchmark as part of the bench-target
+    add_custom_command(TARGET bench POST_BUILD COMMAND ${_bench})
+    add_dependencies(bench ${_bench})
+
+endmacro ( ADD_ANMP_BENCHMARK )
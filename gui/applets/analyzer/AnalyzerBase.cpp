@@ -17,7 +17,6 @@
  ****************************************************************************************/
 
 #include "AnalyzerBase.h"
-#include "Config.h"
 #include "Song.h"
 
 #include <cmath> // interpolate()
@@ -33,7 +32,7 @@
 
 
 AnalyzerBase::AnalyzerBase(QWidget *parent)
-: QGLWidget(parent), m_fht(new FHT(log2(gConfig.FramesToRender))), m_fftData(m_fht->size()), m_renderTimer(new QTimer(this))
+: QGLWidget(parent), m_fht(new FHT(11 /* i.e. 2048 frames, independent of the render block size */)), m_fftData(m_fht->size()), m_renderTimer(new QTimer(this))
 {
     setFps(60); // Default unless changed by subclass
 
@@ -78,8 +77,12 @@ void AnalyzerBase::prepareScope(const Song *s, frame_t playhead, QVector<float>
     const unsigned int nVoices = s->Format.Voices;
     const T *pcmBuf = static_cast<T *>(s->data) + (playhead * s->Format.Channels()) % s->count;
 
+    // if the song uses a ring buffer, dont read over its end
+    const frame_t framesInBuf = (s->count - (playhead * s->Format.Channels()) % s->count) / s->Format.Channels();
+    const unsigned int scopeSize = scope.size();
+
     unsigned int frame;
-    for (frame = 0; (frame < gConfig.FramesToRender) && ((playhead + frame) < s->getFrames()); frame++)
+    for (frame = 0; (frame < scopeSize) && (frame < framesInBuf) && ((playhead + frame) < s->getFrames()); frame++)
     {
         /* init the frame'th element */
         float sampleItem = 0;
@@ -114,7 +117,7 @@ void AnalyzerBase::prepareScope(const Song *s, frame_t playhead, QVector<float>
     // workaround: the fft buffer may not be completely filled yet (e.g. end of song reached or seeked back to beginning).
     // we cannot FFT less frames than with what we've initialized FHT.
     // thus to avoid FFTing uninitialized PCM, fill up the rest of the buffer with zeros.
-    for(;frame < gConfig.FramesToRender; frame++)
+    for(;frame < scopeSize; frame++)
     {
         scope[frame]=0;
     }
@@ -9,7 +9,7 @@
 #include "ui_playcontrol.h"
 
 
-void MainWindow::callbackIsPlayingChanged(void *context, bool isPlaying, Nullable<std::string> msg)
+void MainWindow::callbackIsPlayingChanged(void *context, bool isPlaying, const Nullable<std::string> &msg)
 {
     MainWindow *ctx = static_cast<MainWindow *>(context);
     QMetaObject::invokeMethod(ctx, "slotIsPlayingChanged", Qt::QueuedConnection, Q_ARG(bool, isPlaying), Q_ARG(bool, msg.hasValue), Q_ARG(QString, QString::fromStdString(msg.Value)));
@@ -27,6 +27,12 @@ void MainWindow::callbackCurrentSongChanged(void *context, const Song *newSong)
     QMetaObject::invokeMethod(ctx, "slotCurrentSongChanged", Qt::QueuedConnection, Q_ARG(const Song *, newSong));
 }
 
+void MainWindow::callbackFadeoutFinished(void *context)
+{
+    MainWindow *ctx = static_cast<MainWindow *>(context);
+    QMetaObject::invokeMethod(ctx, "slotFadeoutFinished", Qt::QueuedConnection);
+}
+
 void MainWindow::callbackBufferHealth(void *context, frame_t pos)
 {
     MainWindow *ctx = static_cast<MainWindow *>(context);
@@ -139,6 +139,8 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(this->playlistModel, &PlaylistModel::SongAdded, this, &MainWindow::slotSongAdded, Qt::QueuedConnection);
     connect(this->playlistModel, &PlaylistModel::UnloadCurrentSong, this, [this] {this->player->stop(); this->player->setCurrentSong(nullptr); });
+    // the song following the current one might be preloaded in the background, dont let it get deleted underneath
+    connect(this->playlistModel, &PlaylistModel::rowsAboutToBeRemoved, this, [this] { this->player->cancelPreload(); });
 
     connect(this->treeView, &QTreeView::clicked, this, &MainWindow::treeViewClicked);
 
@@ -148,6 +150,7 @@ MainWindow::MainWindow(QWidget *parent)
     this->player->onPlayheadChanged += std::make_pair(this, &MainWindow::callbackSeek);
     this->player->onCurrentSongChanged += std::make_pair(this, &MainWindow::callbackCurrentSongChanged);
     this->player->onIsPlayingChanged += std::make_pair(this, &MainWindow::callbackIsPlayingChanged);
+    this->player->onFadeoutFinished += std::make_pair(this, &MainWindow::callbackFadeoutFinished);
 
     this->createShortcuts();
 
@@ -162,6 +165,7 @@ MainWindow::~MainWindow()
     this->player->onPlayheadChanged -= this;
     this->player->onCurrentSongChanged -= this;
     this->player->onIsPlayingChanged -= this;
+    this->player->onFadeoutFinished -= this;
 
     delete this->ui;
 
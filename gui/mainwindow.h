@@ -41,7 +41,8 @@ class MainWindow : public QMainWindow
     static void callbackBufferHealth(void *, frame_t pos);
     static void callbackSeek(void *, frame_t pos);
     static void callbackCurrentSongChanged(void *, const Song *newSong);
-    static void callbackIsPlayingChanged(void *context, bool isPlaying, Nullable<std::string> msg);
+    static void callbackIsPlayingChanged(void *context, bool isPlaying, const Nullable<std::string> &msg);
+    static void callbackFadeoutFinished(void *context);
 
     protected:
     void resizeEvent(QResizeEvent *event) override;
@@ -61,6 +62,8 @@ class MainWindow : public QMainWindow
     Playlist *playlist = nullptr;
     PlaylistModel *playlistModel = nullptr;
     Player *player = nullptr;
+    // whether to stop rather than pause the playback, once a fadeout finished
+    bool stopAfterFadeout = false;
     ChannelConfigModel *channelConfigModel = nullptr;
 
 #ifdef USE_VISUALIZER
@@ -115,6 +118,7 @@ class MainWindow : public QMainWindow
     void slotSeek(long long);
     void slotBufferHealthChanged(long long);
     void slotCurrentSongChanged(const Song *s);
+    void slotFadeoutFinished();
 
     void shufflePlaylist();
     void clearPlaylist();
@@ -116,6 +116,18 @@ void MainWindow::slotCurrentSongChanged(const Song* s)
     this->playlistModel->SlotCurrentSongChanged(s);
 }
 
+void MainWindow::slotFadeoutFinished()
+{
+    if (this->stopAfterFadeout)
+    {
+        this->Stop();
+    }
+    else
+    {
+        this->Pause();
+    }
+}
+
 void MainWindow::treeViewClicked(const QModelIndex &index)
 {
     if (!index.isValid())
@@ -211,8 +223,8 @@ void MainWindow::TogglePlayPauseFade()
 {
     if (this->player->IsPlaying())
     {
+        this->stopAfterFadeout = false;
         this->player->fadeout(gConfig.fadeTimePause);
-        this->Pause();
     }
     else
     {
@@ -246,8 +258,8 @@ void MainWindow::Pause()
 
 void MainWindow::StopFade()
 {
+    this->stopAfterFadeout = true;
     this->player->fadeout(gConfig.fadeTimeStop);
-    this->Stop();
 }
 
 void MainWindow::Stop()
@@ -198,6 +198,9 @@ void ALSAOutput::_init(SongFormat &format, bool realtime)
         THROW_RUNTIME_ERROR("Can't use period equal to buffer size (" << alsa_period_size << " == " << buffer_size << ")");
     }
 
+    // the player shall push exactly one period at a time
+    this->periodSize = alsa_period_size;
+
     snd_pcm_hw_params_free(hw_params);
 
 
@@ -268,9 +271,7 @@ int ALSAOutput::write(const int32_t *buffer, frame_t frames)
 template<typename T>
 int ALSAOutput::write(const T *buffer, frame_t frames)
 {
-    T* profBuf = reinterpret_cast<T*>(processedBuffer.data());
-    
-    this->Mix<T, T>(frames, buffer, this->currentFormat, profBuf);
+    const T *profBuf = this->Process<T>(frames, buffer);
 
     if (this->epipe_count > 0)
     {
@@ -1,6 +1,9 @@
 #include "IAudioOutput.h"
 
 #include "CommonExceptions.h"
+#include "Config.h"
+
+#include <cmath>
 
 
 IAudioOutput::IAudioOutput()
@@ -19,6 +22,48 @@ void IAudioOutput::setVolume(float vol)
     this->volume = vol;
 }
 
+void IAudioOutput::rampVolume(float target, frame_t frames, GainCurve curve)
+{
+    std::lock_guard<std::mutex> lck(this->mtxRamp);
+
+    this->pendingRamp.target = target;
+    this->pendingRamp.length = std::max<frame_t>(frames, 0);
+    this->pendingRamp.position = 0;
+    this->pendingRamp.curve = curve;
+    this->rampPending = true;
+}
+
+bool IAudioOutput::IsRamping() const noexcept
+{
+    return this->rampPending || this->rampActive;
+}
+
+float IAudioOutput::GainRamp::GainAt(frame_t pos) const noexcept
+{
+    if (pos >= this->length)
+    {
+        return this->target;
+    }
+
+    const float t = static_cast<float>(pos) / this->length;
+    float progress;
+    switch (this->curve)
+    {
+        case GainCurve::Logarithmic:
+            // normalized, so that the ramp starts at this->start
+            progress = (std::pow(0.1f, 1.0f - t) - 0.1f) / 0.9f;
+            break;
+        case GainCurve::Sine:
+            progress = std::sin(t * static_cast<float>(M_PI) / 2);
+            break;
+        default:
+            progress = t;
+            break;
+    }
+
+    return this->start + (this->target - this->start) * progress;
+}
+
 uint8_t IAudioOutput::GetOutputChannels()
 {
     return this->outputChannels;
@@ -29,6 +74,26 @@ void IAudioOutput::SetOutputChannels(uint8_t chan)
     this->outputChannels = chan;
 }
 
+frame_t IAudioOutput::GetPeriodSize() const noexcept
+{
+    if (this->periodSize != 0)
+    {
+        return this->periodSize;
+    }
+
+    return this->IsRealtime() ? gConfig.FramesToRender : NonRealtimePeriodSize;
+}
+
+bool IAudioOutput::IsRealtime() const noexcept
+{
+    return true;
+}
+
+bool IAudioOutput::CanSpliceSongs() const noexcept
+{
+    return true;
+}
+
 void IAudioOutput::SetVoiceConfig(decltype(SongFormat::Voices) voices, decltype(SongFormat::VoiceChannels) &voiceChannels)
 {
     this->currentFormat.Voices = voices;
@@ -43,27 +108,53 @@ void IAudioOutput::SetMuteMask(decltype(SongFormat::VoiceIsMuted) &mask)
 // takes care of pointer arithmetic
 int IAudioOutput::write(const pcm_t *frameBuffer, frame_t frames, size_t offset)
 {
+    // never wait for rampVolume() here, in case it is just being called the ramp is taken over by the next write
+    std::unique_lock<std::mutex> lck(this->mtxRamp, std::defer_lock);
+    if (this->rampPending && lck.try_lock())
+    {
+        // continue from the gain currently applied, so that replacing a running ramp doesnt cause a jump
+        const float current = this->ramp.GainAt(this->ramp.position);
+        this->ramp = this->pendingRamp;
+        this->ramp.start = current;
+
+        this->rampActive = this->ramp.IsActive();
+        this->rampPending = false;
+        lck.unlock();
+    }
+
+    const SongFormat &f = this->currentFormat;
+    this->passthrough = this->volume == 1.0f && !this->ramp.IsActive() && this->ramp.target == 1.0f &&
+                        f.Voices == 1 && !f.VoiceIsMuted[0] && f.VoiceChannels[0] == this->GetOutputChannels();
+
+    // make sure the mixdown buffer is able to hold the frames, no matter which (4 byte at max) sample format the driver uses
+    const size_t bytesNeeded = frames * this->GetOutputChannels() * sizeof(int32_t);
+    if (this->processedBuffer.size() < bytesNeeded)
+    {
+        this->processedBuffer.resize(bytesNeeded);
+    }
+
+    int ret;
     switch (this->currentFormat.SampleFormat)
     {
         case SampleFormat_t::float32:
         {
             const float *buf = static_cast<const float *>(frameBuffer);
             buf += offset;
-            return this->write(buf, frames);
+            ret = this->write(buf, frames);
             break;
         }
         case SampleFormat_t::int16:
         {
             const int16_t *buf = static_cast<const int16_t *>(frameBuffer);
             buf += offset;
-            return this->write(buf, frames);
+            ret = this->write(buf, frames);
             break;
         }
         case SampleFormat_t::int32:
         {
             const int32_t *buf = static_cast<const int32_t *>(frameBuffer);
             buf += offset;
-            return this->write(buf, frames);
+            ret = this->write(buf, frames);
             break;
         }
         case SampleFormat_t::unknown:
@@ -74,4 +165,13 @@ int IAudioOutput::write(const pcm_t *frameBuffer, frame_t frames, size_t offset)
             throw NotImplementedException();
             break;
     }
+
+    // only advance the ramp by what has actually been played
+    if (ret > 0 && this->ramp.IsActive())
+    {
+        this->ramp.position = std::min<frame_t>(this->ramp.position + ret, this->ramp.length);
+        this->rampActive = this->ramp.IsActive();
+    }
+
+    return ret;
 }
@@ -3,10 +3,21 @@
 #include "SongFormat.h"
 #include "types.h"
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <vector>
 
 
+// shape of a gain ramp, see IAudioOutput::rampVolume()
+enum class GainCurve : uint8_t
+{
+    Linear = 1,
+    Logarithmic = 2,
+    Sine = 3,
+};
+
+
 /**
   * Abstract base class for all classes that handle audio playback in ANMP
   *
@@ -16,8 +27,8 @@
   *  - this->write() public method called with Song::data
   *  - public write() gives that pointer to private write() methods
   *  - private write() methods are specialized by child classes
-  *    - there they usually call this->Mix() on the pcm buffer
-  *    - Song::data's PCM gets mixed into custom allocated buffers within child classes
+  *    - there they usually call this->Process() on the pcm buffer
+  *    - Song::data's PCM gets mixed into custom allocated buffers within child classes, unless no mixing is needed at all
   *    - (for jack, this buffer will get (partly) resampled)
   *    - finally it will be played
   */
@@ -82,11 +93,46 @@ class IAudioOutput
      */
     void setVolume(float vol);
 
+    /**
+     * smoothly changes the gain, that is applied on top of the volume, to @p target
+     *
+     * the ramp is applied sample by sample to the pcm passed to subsequent calls of this->write(). may be called from any thread.
+     *
+     * @param target gain to be reached, usually ranged [0.0,1.0]
+     * @param frames number of frames it takes to reach @p target; if zero, @p target is applied at once
+     * @param curve shape of the ramp
+     */
+    void rampVolume(float target, frame_t frames, GainCurve curve = GainCurve::Sine);
+
+    /**
+     * @return true if a ramp requested by this->rampVolume() has not been completely played yet
+     */
+    bool IsRamping() const noexcept;
+
     // gets and sets the number of mixdown channels, all non muted voices of a song get mixed to
     uint8_t GetOutputChannels();
     // only call this when playback is paused, i.e. no call to this->write() is pending
     virtual void SetOutputChannels(uint8_t);
 
+    /**
+     * @return the number of frames the audio driver prefers to receive per call to this->write(), i.e. its period size
+     *
+     * may change during this->init()
+     */
+    virtual frame_t GetPeriodSize() const noexcept;
+
+    /**
+     * @return true if the pcm is played back in realtime, e.g. by a sound card. false if it's consumed as fast as possible,
+     * e.g. by writing it to a file or analyzing it; pcm will then be written in large blocks and realtime-only logic is skipped
+     */
+    virtual bool IsRealtime() const noexcept;
+
+    /**
+     * @return true if the end of a song and the beginning of the next one may be passed to a single call to this->write(),
+     * false if the driver handles each song separately (e.g. writes them to separate files)
+     */
+    virtual bool CanSpliceSongs() const noexcept;
+
     void SetVoiceConfig(decltype(SongFormat::Voices) voices, decltype(SongFormat::VoiceChannels) &voiceChannels);
     void SetMuteMask(decltype(SongFormat::VoiceIsMuted) &mask);
 
@@ -120,6 +166,49 @@ class IAudioOutput
     // the current volume [0,1.0] to use, i.e. a factor by that the PCM gets amplified.
     float volume = 1.0f;
 
+    struct GainRamp
+    {
+        float start = 1.0f;
+        float target = 1.0f;
+        // duration of the ramp in frames
+        frame_t length = 0;
+        // number of frames of the ramp that have already been played
+        frame_t position = 0;
+        GainCurve curve = GainCurve::Linear;
+
+        // @return the gain to be applied to the frame at @p pos, counted from the beginning of the ramp
+        float GainAt(frame_t pos) const noexcept;
+
+        bool IsActive() const noexcept
+        {
+            return this->position < this->length;
+        }
+    };
+
+    // the ramp currently applied by this->Mix(), only to be accessed by the thread calling this->write()
+    GainRamp ramp;
+
+    // number of frames consumed by the underlying audio driver per period, as negotiated during init()
+    // if zero, gConfig.FramesToRender is used, or NonRealtimePeriodSize if this driver is not realtime
+    frame_t periodSize = 0;
+
+    static constexpr frame_t NonRealtimePeriodSize = 1 << 16;
+
+    // whether the pcm currently passed to write() can be played as it is, i.e. there is only a single unmuted voice
+    // having as many channels as the output, volume is 1.0 and no gain ramp is applied, so no mixing or amplification is needed; updated by the public write()
+    bool passthrough = false;
+
+    /**
+     * prepares the pcm provided by @p in to be played in the sample format TOUT
+     *
+     * if this->passthrough is set, @p in is returned unchanged, or if TOUT differs from TIN, converted to TOUT into processedBuffer;
+     * else @p in gets mixed into processedBuffer by calling this->Mix()
+     *
+     * @return pointer to the pcm to be played, either @p in or processedBuffer
+     */
+    template<typename TIN, typename TOUT = TIN>
+    const TOUT *Process(const frame_t frames, const TIN *in) noexcept;
+
     /**
      * mixes all the available audio channels of pcm provided by @p in into the @p out pcm buffer
      * 
@@ -131,6 +220,14 @@ class IAudioOutput
     template<typename TIN, typename TOUT = TIN>
     void Mix(const frame_t frames, const TIN *RESTRICT in, const SongFormat &inputFormat, TOUT *RESTRICT out) noexcept;
 
+    /**
+     * same as Mix(), but supports any channel layout by mixing frame by frame
+     * 
+     * Mix() falls back to this, if there is no vectorized kernel for the given layout
+     */
+    template<typename TIN, typename TOUT = TIN>
+    void MixGeneric(const frame_t frames, const TIN *RESTRICT in, const SongFormat &inputFormat, TOUT *RESTRICT out) noexcept;
+
     /**
      * pushes the pcm pointed to by buffer to the underlying audio driver and by that causes it to play
      * 
@@ -153,4 +250,10 @@ private:
     // number of audio channels all the different song's voices will be mixed to (by this->Mix())
     // if it has no value, no mixing takes place
     uint8_t outputChannels;
+
+    // ramp requested by this->rampVolume(), to be taken over by the next call to this->write() that doesnt find mtxRamp locked
+    GainRamp pendingRamp;
+    std::atomic<bool> rampPending{false};
+    std::atomic<bool> rampActive{false};
+    std::mutex mtxRamp;
 };
@@ -1,13 +1,134 @@
 #ifndef IAUDIOOUTPUT_IMPL_H
 #define IAUDIOOUTPUT_IMPL_H
 
+#include "MixKernels.h"
+
 #include <cmath> // lround
 #include <type_traits>
 #include <limits>
 
 
+template<typename TIN, typename TOUT>
+const TOUT *IAudioOutput::Process(const frame_t frames, const TIN *in) noexcept
+{
+    TOUT *out = reinterpret_cast<TOUT *>(this->processedBuffer.data());
+
+    if (!this->passthrough)
+    {
+        this->Mix<TIN, TOUT>(frames, in, this->currentFormat, out);
+        return out;
+    }
+
+    if constexpr (std::is_same<TIN, TOUT>::value)
+    {
+        return in;
+    }
+    else
+    {
+        static_assert(std::is_floating_point<TOUT>::value && !std::is_floating_point<TIN>::value, "passthrough can only convert integers to floats");
+
+        MixConvert(in, out, frames * this->GetOutputChannels(), 1.0f / (std::numeric_limits<TIN>::max() + 1.0f));
+        return out;
+    }
+}
+
 template<typename TIN, typename TOUT>
 void IAudioOutput::Mix(const frame_t frames, const TIN *RESTRICT in, const SongFormat &inputFormat, TOUT *RESTRICT out) noexcept
+{
+    using TACC = MixAcc_t<TIN>;
+
+    const unsigned int N = this->GetOutputChannels();
+    const unsigned int nVoices = inputFormat.Voices;
+    const unsigned int inChannels = inputFormat.Channels();
+
+    // a running gain ramp is applied frame by frame, else it is constant and can be folded into the volume
+    const bool ramping = this->ramp.IsActive();
+
+    // amplify volume and normalize, if integers are converted to floats
+    TACC gain = this->volume * (ramping ? 1.0f : this->ramp.target);
+    if (std::is_floating_point<TOUT>() && !std::is_floating_point<TIN>())
+    {
+        gain /= (std::numeric_limits<TIN>::max() + 1.0);
+    }
+
+    // find out whether there is a specialized kernel for the given channel layout
+    const bool singleVoice = nVoices == 1 && !inputFormat.VoiceIsMuted[0];
+    const bool passthrough = singleVoice && inputFormat.VoiceChannels[0] == N;
+    const bool monoToStereo = singleVoice && inputFormat.VoiceChannels[0] == 1 && N == 2;
+    bool stereoVoices = N == 2 && nVoices > 0;
+    for (unsigned int v = 0; v < nVoices && stereoVoices; v++)
+    {
+        stereoVoices = inputFormat.VoiceChannels[v] == 2;
+    }
+
+    if (!passthrough && !monoToStereo && !stereoVoices)
+    {
+        this->MixGeneric(frames, in, inputFormat, out);
+        return;
+    }
+
+    // intermediate mixdown buffer, the specialized kernels always mix to no more than two channels
+    alignas(32) TACC acc[MixBlockItems];
+    const frame_t framesPerBlock = MixBlockItems / std::max(N, 2u);
+
+    for (frame_t done = 0; done < frames; done += framesPerBlock)
+    {
+        const frame_t n = std::min(framesPerBlock, frames - done);
+        const TIN *blockIn = in + done * inChannels;
+
+        if (passthrough)
+        {
+            MixLoad(blockIn, acc, n * N);
+        }
+        else if (monoToStereo)
+        {
+            // convert into the upper half, then spread each item to both channels from the front
+            TACC *mono = acc + framesPerBlock;
+            MixLoad(blockIn, mono, n);
+            for (frame_t f = 0; f < n; f++)
+            {
+                const TACC item = mono[f];
+                acc[2 * f] = item;
+                acc[2 * f + 1] = item;
+            }
+        }
+        else // stereoVoices
+        {
+            std::fill(acc, acc + n * 2, TACC(0));
+            for (unsigned int v = 0; v < nVoices; v++)
+            {
+                if (inputFormat.VoiceIsMuted[v])
+                {
+                    continue;
+                }
+
+                const TIN *voiceIn = blockIn + 2 * v;
+                for (frame_t f = 0; f < n; f++)
+                {
+                    acc[2 * f] += voiceIn[f * inChannels];
+                    acc[2 * f + 1] += voiceIn[f * inChannels + 1];
+                }
+            }
+        }
+
+        if (ramping)
+        {
+            for (frame_t f = 0; f < n; f++)
+            {
+                const TACC g = this->ramp.GainAt(this->ramp.position + done + f);
+                for (unsigned int c = 0; c < N; c++)
+                {
+                    acc[f * N + c] *= g;
+                }
+            }
+        }
+
+        MixStore(acc, out + done * N, n * N, gain);
+    }
+}
+
+template<typename TIN, typename TOUT>
+void IAudioOutput::MixGeneric(const frame_t frames, const TIN *RESTRICT in, const SongFormat &inputFormat, TOUT *RESTRICT out) noexcept
 {
     const auto N = this->GetOutputChannels();
     const unsigned int nVoices = inputFormat.Voices;
@@ -41,6 +162,8 @@ void IAudioOutput::Mix(const frame_t frames, const TIN *RESTRICT in, const SongF
             in += vchan;
         }
 
+        const double rampGain = this->ramp.GainAt(this->ramp.position + f);
+
         // write the mixed buffer to out
         for (unsigned int i = 0; i < N; i++)
         {
@@ -49,7 +172,7 @@ void IAudioOutput::Mix(const frame_t frames, const TIN *RESTRICT in, const SongF
             auto item = temp[i];
 
             // amplify volume
-            item *= this->volume;
+            item *= this->volume * rampGain;
 
             if (std::is_floating_point<TOUT>())
             {
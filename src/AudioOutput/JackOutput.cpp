@@ -170,6 +170,17 @@ void JackOutput::init(SongFormat &format, bool)
     this->currentFormat = format;
 }
 
+frame_t JackOutput::GetPeriodSize() const noexcept
+{
+    if (this->jackBufSize == 0 || this->jackSampleRate == 0 || this->currentFormat.SampleRate == 0)
+    {
+        return this->IAudioOutput::GetPeriodSize();
+    }
+
+    // number of (not yet resampled) frames required to fill one jack period
+    return (static_cast<frame_t>(this->jackBufSize) * this->currentFormat.SampleRate + this->jackSampleRate - 1) / this->jackSampleRate;
+}
+
 void JackOutput::close()
 {
     if (this->handle != nullptr)
@@ -235,8 +246,7 @@ int JackOutput::doResampling(const float *inBuf, const size_t Frames)
 template<typename T>
 int JackOutput::write(const T *buffer, frame_t frames)
 {
-    auto* procBuf = reinterpret_cast<float*>(processedBuffer.data());
-    this->Mix<T, float>(frames, buffer, this->currentFormat, procBuf);
+    const float *procBuf = this->Process<T, float>(frames, buffer);
 
     unique_lock<mutex> lck(this->mtx);
 
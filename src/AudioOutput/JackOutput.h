@@ -46,6 +46,8 @@ class JackOutput : public IAudioOutput
 
     void SetOutputChannels(uint8_t) override;
 
+    frame_t GetPeriodSize() const noexcept override;
+
     protected:
     vector<jack_port_t *> playbackPorts;
 
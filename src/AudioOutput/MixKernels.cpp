@@ -0,0 +1,708 @@
+#include "MixKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__GNUC__) || defined(__clang__)
+#define MIX_HAVE_X86 1
+#include <immintrin.h>
+#endif
+#endif
+
+
+//
+// Scalar implementation, used for the remainder of the vectorized loops as well
+//
+static void LoadScalar(const int16_t *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    for (size_t i = 0; i < items; i++)
+    {
+        acc[i] = in[i];
+    }
+}
+
+static void LoadScalar(const float *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    std::memcpy(acc, in, items * sizeof(float));
+}
+
+static void LoadScalar(const int32_t *RESTRICT in, double *RESTRICT acc, size_t items) noexcept
+{
+    for (size_t i = 0; i < items; i++)
+    {
+        acc[i] = in[i];
+    }
+}
+
+static void StoreScalar(const float *RESTRICT acc, float *RESTRICT out, size_t items, float gain) noexcept
+{
+    for (size_t i = 0; i < items; i++)
+    {
+        out[i] = std::min(std::max(acc[i] * gain, -1.0f), 1.0f);
+    }
+}
+
+static void StoreScalar(const float *RESTRICT acc, int16_t *RESTRICT out, size_t items, float gain) noexcept
+{
+    constexpr float MAX = std::numeric_limits<int16_t>::max();
+    constexpr float MIN = std::numeric_limits<int16_t>::min();
+    for (size_t i = 0; i < items; i++)
+    {
+        out[i] = static_cast<int16_t>(std::nearbyint(std::min(std::max(acc[i] * gain, MIN), MAX)));
+    }
+}
+
+static void StoreScalar(const double *RESTRICT acc, int32_t *RESTRICT out, size_t items, double gain) noexcept
+{
+    constexpr double MAX = std::numeric_limits<int32_t>::max();
+    constexpr double MIN = std::numeric_limits<int32_t>::min();
+    for (size_t i = 0; i < items; i++)
+    {
+        out[i] = static_cast<int32_t>(std::nearbyint(std::min(std::max(acc[i] * gain, MIN), MAX)));
+    }
+}
+
+static void StoreScalar(const double *RESTRICT acc, float *RESTRICT out, size_t items, double gain) noexcept
+{
+    for (size_t i = 0; i < items; i++)
+    {
+        out[i] = static_cast<float>(std::min(std::max(acc[i] * gain, -1.0), 1.0));
+    }
+}
+
+template<typename TIN>
+static void ConvertScalar(const TIN *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    for (size_t i = 0; i < items; i++)
+    {
+        out[i] = static_cast<float>(in[i]) * scale;
+    }
+}
+
+// libmad's fixed point samples: MAD_F_FRACBITS fractional bits, MAD_F_ONE being 1.0
+constexpr int MadFracBits = 28;
+constexpr int32_t MadOne = 1 << MadFracBits;
+// the number of significant bits kept
+constexpr int MadSampleBits = 24;
+
+// the greatest float below 2^31, i.e. the greatest one that can be converted to int32
+constexpr float Int32MaxFloat = 2147483520.0f;
+
+/* FROM minimad.c
+ *
+ * The following utility routine performs simple rounding, clipping, and
+ * scaling of MAD's high-resolution samples down to 24 bits. It does not
+ * perform any dithering or noise shaping, which would be recommended to
+ * obtain any exceptional audio quality. It is therefore not recommended to
+ * use this routine if high-quality output is desired.
+ */
+static inline int32_t FixedToInt24(int32_t sample) noexcept
+{
+    /* round */
+    sample = static_cast<int32_t>(static_cast<uint32_t>(sample) + (1u << (MadFracBits - MadSampleBits)));
+
+    /* clip */
+    sample = std::min(std::max(sample, -MadOne), MadOne - 1);
+
+    /* quantize, i.e. cut the fractional bits we dont need anymore */
+    sample >>= (MadFracBits + 1 - MadSampleBits);
+
+    /* make sure the 24th bit becomes the msb */
+    return static_cast<int32_t>(static_cast<uint32_t>(sample) << (32 - MadSampleBits));
+}
+
+static inline int32_t AmplifyFloor(int32_t sample, float gain) noexcept
+{
+    const float y = std::min(std::max(sample * gain, -Int32MaxFloat - 128.0f), Int32MaxFloat);
+
+    // floor: truncate, then subtract one where that rounded up
+    const int32_t t = static_cast<int32_t>(y);
+    return t - (static_cast<float>(t) > y);
+}
+
+static void ConvertFixedScalar(const int32_t *RESTRICT left, const int32_t *RESTRICT right, int32_t *RESTRICT out, size_t frames, uint32_t channels, float gain) noexcept
+{
+    const bool amplify = gain != 1.0f;
+    for (size_t f = 0; f < frames; f++)
+    {
+        int32_t l = FixedToInt24(left[f]);
+        out[f * channels] = amplify ? AmplifyFloor(l, gain) : l;
+
+        if (channels == 2)
+        {
+            int32_t r = FixedToInt24(right[f]);
+            out[f * 2 + 1] = amplify ? AmplifyFloor(r, gain) : r;
+        }
+    }
+}
+
+template<typename T>
+static void InterleaveScalar(const T *const *planes, T *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    if (channels == 1)
+    {
+        std::memcpy(out, planes[0], frames * sizeof(T));
+        return;
+    }
+
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        const T *RESTRICT plane = planes[c];
+        for (size_t f = 0; f < frames; f++)
+        {
+            out[f * channels + c] = plane[f];
+        }
+    }
+}
+
+
+#ifdef MIX_HAVE_X86
+//
+// SSE2 implementation
+//
+__attribute__((target("sse2"))) static void LoadSSE2(const int16_t *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        // sign extend by moving the int16 into the upper half of each int32, then shift back
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(acc + i, _mm_cvtepi32_ps(lo));
+        _mm_storeu_ps(acc + i + 4, _mm_cvtepi32_ps(hi));
+    }
+    LoadScalar(in + i, acc + i, items - i);
+}
+
+__attribute__((target("sse2"))) static void LoadSSE2(const int32_t *RESTRICT in, double *RESTRICT acc, size_t items) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_pd(acc + i, _mm_cvtepi32_pd(x));
+        _mm_storeu_pd(acc + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    LoadScalar(in + i, acc + i, items - i);
+}
+
+__attribute__((target("sse2"))) static void StoreSSE2(const float *RESTRICT acc, float *RESTRICT out, size_t items, float gain) noexcept
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(acc + i), g);
+        _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(x, lo), hi));
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("sse2"))) static void StoreSSE2(const float *RESTRICT acc, int16_t *RESTRICT out, size_t items, float gain) noexcept
+{
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(std::numeric_limits<int16_t>::min());
+    const __m128 hi = _mm_set1_ps(std::numeric_limits<int16_t>::max());
+
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(acc + i), g), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(acc + i + 4), g), lo), hi);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("sse2"))) static void StoreSSE2(const double *RESTRICT acc, int32_t *RESTRICT out, size_t items, double gain) noexcept
+{
+    const __m128d g = _mm_set1_pd(gain);
+    const __m128d lo = _mm_set1_pd(std::numeric_limits<int32_t>::min());
+    const __m128d hi = _mm_set1_pd(std::numeric_limits<int32_t>::max());
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128d a = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(acc + i), g), lo), hi);
+        __m128d b = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(acc + i + 2), g), lo), hi);
+        __m128i packed = _mm_unpacklo_epi64(_mm_cvtpd_epi32(a), _mm_cvtpd_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("sse2"))) static void StoreSSE2(const double *RESTRICT acc, float *RESTRICT out, size_t items, double gain) noexcept
+{
+    const __m128d g = _mm_set1_pd(gain);
+    const __m128d lo = _mm_set1_pd(-1.0);
+    const __m128d hi = _mm_set1_pd(1.0);
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128d a = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(acc + i), g), lo), hi);
+        __m128d b = _mm_min_pd(_mm_max_pd(_mm_mul_pd(_mm_loadu_pd(acc + i + 2), g), lo), hi);
+        _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(a), _mm_cvtpd_ps(b)));
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("sse2"))) static void ConvertSSE2(const int16_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    const __m128 s = _mm_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+    }
+    ConvertScalar(in + i, out + i, items - i, scale);
+}
+
+__attribute__((target("sse2"))) static void ConvertSSE2(const int32_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    const __m128 s = _mm_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(x), s));
+    }
+    ConvertScalar(in + i, out + i, items - i, scale);
+}
+
+__attribute__((target("sse2"))) static inline __m128i FixedToInt24SSE2(__m128i x, bool amplify, __m128 gain) noexcept
+{
+    const __m128i lo = _mm_set1_epi32(-MadOne);
+    const __m128i hi = _mm_set1_epi32(MadOne - 1);
+
+    x = _mm_add_epi32(x, _mm_set1_epi32(1 << (MadFracBits - MadSampleBits)));
+
+    // there is no min/max for int32 in SSE2, select by comparing instead
+    __m128i m = _mm_cmpgt_epi32(x, hi);
+    x = _mm_or_si128(_mm_and_si128(m, hi), _mm_andnot_si128(m, x));
+    m = _mm_cmplt_epi32(x, lo);
+    x = _mm_or_si128(_mm_and_si128(m, lo), _mm_andnot_si128(m, x));
+
+    x = _mm_slli_epi32(_mm_srai_epi32(x, MadFracBits + 1 - MadSampleBits), 32 - MadSampleBits);
+    if (!amplify)
+    {
+        return x;
+    }
+
+    __m128 y = _mm_mul_ps(_mm_cvtepi32_ps(x), gain);
+    y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-Int32MaxFloat - 128.0f)), _mm_set1_ps(Int32MaxFloat));
+
+    // floor: truncate, then subtract one where that rounded up
+    __m128i t = _mm_cvttps_epi32(y);
+    return _mm_add_epi32(t, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), y)));
+}
+
+__attribute__((target("sse2"))) static void ConvertFixedSSE2(const int32_t *RESTRICT left, const int32_t *RESTRICT right, int32_t *RESTRICT out, size_t frames, uint32_t channels, float gain) noexcept
+{
+    const bool amplify = gain != 1.0f;
+    const __m128 g = _mm_set1_ps(gain);
+
+    size_t f = 0;
+    if (channels == 2)
+    {
+        for (; f + 4 <= frames; f += 4)
+        {
+            __m128i l = FixedToInt24SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left + f)), amplify, g);
+            __m128i r = FixedToInt24SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(right + f)), amplify, g);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2), _mm_unpacklo_epi32(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2 + 4), _mm_unpackhi_epi32(l, r));
+        }
+    }
+    else
+    {
+        for (; f + 4 <= frames; f += 4)
+        {
+            __m128i l = FixedToInt24SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left + f)), amplify, g);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f), l);
+        }
+    }
+    ConvertFixedScalar(left + f, right + f, out + f * channels, frames - f, channels, gain);
+}
+
+// only stereo is worth it, everything else is done by the scalar implementation
+template<typename T>
+__attribute__((target("sse2"))) static void InterleaveSSE2(const T *const *planes, T *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    if (channels != 2)
+    {
+        InterleaveScalar(planes, out, frames, channels);
+        return;
+    }
+
+    constexpr size_t N = sizeof(__m128i) / sizeof(T);
+
+    size_t f = 0;
+    for (; f + N <= frames; f += N)
+    {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[0] + f));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[1] + f));
+        if constexpr (sizeof(T) == 2)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2), _mm_unpacklo_epi16(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2 + N), _mm_unpackhi_epi16(l, r));
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2), _mm_unpacklo_epi32(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + f * 2 + N), _mm_unpackhi_epi32(l, r));
+        }
+    }
+
+    const T *rest[2] = {planes[0] + f, planes[1] + f};
+    InterleaveScalar(rest, out + f * 2, frames - f, channels);
+}
+
+
+//
+// AVX2 implementation
+//
+__attribute__((target("avx2"))) static void LoadAVX2(const int16_t *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        _mm256_storeu_ps(acc + i, _mm256_cvtepi32_ps(x));
+    }
+    LoadScalar(in + i, acc + i, items - i);
+}
+
+__attribute__((target("avx2"))) static void LoadAVX2(const int32_t *RESTRICT in, double *RESTRICT acc, size_t items) noexcept
+{
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm256_storeu_pd(acc + i, _mm256_cvtepi32_pd(x));
+    }
+    LoadScalar(in + i, acc + i, items - i);
+}
+
+__attribute__((target("avx2"))) static void StoreAVX2(const float *RESTRICT acc, float *RESTRICT out, size_t items, float gain) noexcept
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(acc + i), g);
+        _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(x, lo), hi));
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("avx2"))) static void StoreAVX2(const float *RESTRICT acc, int16_t *RESTRICT out, size_t items, float gain) noexcept
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(std::numeric_limits<int16_t>::min());
+    const __m256 hi = _mm256_set1_ps(std::numeric_limits<int16_t>::max());
+
+    size_t i = 0;
+    for (; i + 16 <= items; i += 16)
+    {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(acc + i), g), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(acc + i + 8), g), lo), hi);
+        // packs works within 128 bit lanes, restore the order of the 64 bit blocks afterwards
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("avx2"))) static void StoreAVX2(const double *RESTRICT acc, int32_t *RESTRICT out, size_t items, double gain) noexcept
+{
+    const __m256d g = _mm256_set1_pd(gain);
+    const __m256d lo = _mm256_set1_pd(std::numeric_limits<int32_t>::min());
+    const __m256d hi = _mm256_set1_pd(std::numeric_limits<int32_t>::max());
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m256d x = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(acc + i), g), lo), hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm256_cvtpd_epi32(x));
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("avx2"))) static void StoreAVX2(const double *RESTRICT acc, float *RESTRICT out, size_t items, double gain) noexcept
+{
+    const __m256d g = _mm256_set1_pd(gain);
+    const __m256d lo = _mm256_set1_pd(-1.0);
+    const __m256d hi = _mm256_set1_pd(1.0);
+
+    size_t i = 0;
+    for (; i + 4 <= items; i += 4)
+    {
+        __m256d x = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(_mm256_loadu_pd(acc + i), g), lo), hi);
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(x));
+    }
+    StoreScalar(acc + i, out + i, items - i, gain);
+}
+
+__attribute__((target("avx2"))) static void ConvertAVX2(const int16_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    const __m256 s = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+    }
+    ConvertScalar(in + i, out + i, items - i, scale);
+}
+
+__attribute__((target("avx2"))) static void ConvertAVX2(const int32_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    const __m256 s = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i + 8 <= items; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), s));
+    }
+    ConvertScalar(in + i, out + i, items - i, scale);
+}
+
+__attribute__((target("avx2"))) static inline __m256i FixedToInt24AVX2(__m256i x, bool amplify, __m256 gain) noexcept
+{
+    x = _mm256_add_epi32(x, _mm256_set1_epi32(1 << (MadFracBits - MadSampleBits)));
+    x = _mm256_min_epi32(_mm256_max_epi32(x, _mm256_set1_epi32(-MadOne)), _mm256_set1_epi32(MadOne - 1));
+    x = _mm256_slli_epi32(_mm256_srai_epi32(x, MadFracBits + 1 - MadSampleBits), 32 - MadSampleBits);
+    if (!amplify)
+    {
+        return x;
+    }
+
+    __m256 y = _mm256_floor_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(x), gain));
+    y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(-Int32MaxFloat - 128.0f)), _mm256_set1_ps(Int32MaxFloat));
+    return _mm256_cvttps_epi32(y);
+}
+
+__attribute__((target("avx2"))) static void ConvertFixedAVX2(const int32_t *RESTRICT left, const int32_t *RESTRICT right, int32_t *RESTRICT out, size_t frames, uint32_t channels, float gain) noexcept
+{
+    const bool amplify = gain != 1.0f;
+    const __m256 g = _mm256_set1_ps(gain);
+
+    size_t f = 0;
+    if (channels == 2)
+    {
+        for (; f + 8 <= frames; f += 8)
+        {
+            __m256i l = FixedToInt24AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + f)), amplify, g);
+            __m256i r = FixedToInt24AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(right + f)), amplify, g);
+            // unpack works within 128 bit lanes, restore the order of the lanes afterwards
+            __m256i a = _mm256_unpacklo_epi32(l, r);
+            __m256i b = _mm256_unpackhi_epi32(l, r);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + f * 2), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + f * 2 + 8), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+    }
+    else
+    {
+        for (; f + 8 <= frames; f += 8)
+        {
+            __m256i l = FixedToInt24AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(left + f)), amplify, g);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + f), l);
+        }
+    }
+    ConvertFixedScalar(left + f, right + f, out + f * channels, frames - f, channels, gain);
+}
+
+template<typename T>
+__attribute__((target("avx2"))) static void InterleaveAVX2(const T *const *planes, T *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    if (channels != 2)
+    {
+        InterleaveScalar(planes, out, frames, channels);
+        return;
+    }
+
+    constexpr size_t N = sizeof(__m256i) / sizeof(T);
+
+    size_t f = 0;
+    for (; f + N <= frames; f += N)
+    {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(planes[0] + f));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(planes[1] + f));
+        // unpack works within 128 bit lanes, restore the order of the lanes afterwards
+        __m256i a, b;
+        if constexpr (sizeof(T) == 2)
+        {
+            a = _mm256_unpacklo_epi16(l, r);
+            b = _mm256_unpackhi_epi16(l, r);
+        }
+        else
+        {
+            a = _mm256_unpacklo_epi32(l, r);
+            b = _mm256_unpackhi_epi32(l, r);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + f * 2), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + f * 2 + N), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+
+    const T *rest[2] = {planes[0] + f, planes[1] + f};
+    InterleaveScalar(rest, out + f * 2, frames - f, channels);
+}
+#endif // MIX_HAVE_X86
+
+
+//
+// Runtime dispatch
+//
+static bool IsaSupported(MixIsa isa) noexcept
+{
+    switch (isa)
+    {
+        case MixIsa::Scalar:
+            return true;
+#ifdef MIX_HAVE_X86
+        case MixIsa::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case MixIsa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+static MixIsa DetectIsa() noexcept
+{
+#ifdef MIX_HAVE_X86
+    __builtin_cpu_init();
+#endif
+    for (MixIsa isa : {MixIsa::AVX2, MixIsa::SSE2})
+    {
+        if (IsaSupported(isa))
+        {
+            return isa;
+        }
+    }
+    return MixIsa::Scalar;
+}
+
+static MixIsa currentIsa = DetectIsa();
+
+MixIsa MixGetIsa() noexcept
+{
+    return currentIsa;
+}
+
+bool MixSetIsa(MixIsa isa) noexcept
+{
+    if (!IsaSupported(isa))
+    {
+        return false;
+    }
+
+    currentIsa = isa;
+    return true;
+}
+
+#ifdef MIX_HAVE_X86
+#define MIX_DISPATCH(FUNC, ...)          \
+    switch (currentIsa)                  \
+    {                                    \
+        case MixIsa::AVX2:               \
+            FUNC##AVX2(__VA_ARGS__);     \
+            break;                       \
+        case MixIsa::SSE2:               \
+            FUNC##SSE2(__VA_ARGS__);     \
+            break;                       \
+        default:                         \
+            FUNC##Scalar(__VA_ARGS__);   \
+            break;                       \
+    }
+#else
+#define MIX_DISPATCH(FUNC, ...) FUNC##Scalar(__VA_ARGS__);
+#endif
+
+void MixLoad(const int16_t *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    MIX_DISPATCH(Load, in, acc, items)
+}
+
+void MixLoad(const float *RESTRICT in, float *RESTRICT acc, size_t items) noexcept
+{
+    // nothing to vectorize, just a copy
+    LoadScalar(in, acc, items);
+}
+
+void MixLoad(const int32_t *RESTRICT in, double *RESTRICT acc, size_t items) noexcept
+{
+    MIX_DISPATCH(Load, in, acc, items)
+}
+
+void MixStore(const float *RESTRICT acc, float *RESTRICT out, size_t items, float gain) noexcept
+{
+    MIX_DISPATCH(Store, acc, out, items, gain)
+}
+
+void MixStore(const float *RESTRICT acc, int16_t *RESTRICT out, size_t items, float gain) noexcept
+{
+    MIX_DISPATCH(Store, acc, out, items, gain)
+}
+
+void MixStore(const double *RESTRICT acc, int32_t *RESTRICT out, size_t items, double gain) noexcept
+{
+    MIX_DISPATCH(Store, acc, out, items, gain)
+}
+
+void MixStore(const double *RESTRICT acc, float *RESTRICT out, size_t items, double gain) noexcept
+{
+    MIX_DISPATCH(Store, acc, out, items, gain)
+}
+
+void MixConvert(const int16_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    MIX_DISPATCH(Convert, in, out, items, scale)
+}
+
+void MixConvert(const int32_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept
+{
+    MIX_DISPATCH(Convert, in, out, items, scale)
+}
+
+void MixConvertFixed(const int32_t *RESTRICT left, const int32_t *RESTRICT right, int32_t *RESTRICT out, size_t frames, uint32_t channels, float gain) noexcept
+{
+    MIX_DISPATCH(ConvertFixed, left, right, out, frames, channels, gain)
+}
+
+void MixInterleave(const int16_t *const *planes, int16_t *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    MIX_DISPATCH(Interleave, planes, out, frames, channels)
+}
+
+void MixInterleave(const int32_t *const *planes, int32_t *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    MIX_DISPATCH(Interleave, planes, out, frames, channels)
+}
+
+void MixInterleave(const float *const *planes, float *RESTRICT out, size_t frames, uint32_t channels) noexcept
+{
+    MIX_DISPATCH(Interleave, planes, out, frames, channels)
+}
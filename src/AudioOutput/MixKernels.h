@@ -0,0 +1,93 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+  * vectorized building blocks used by IAudioOutput::Mix()
+  *
+  * mixing is done in two stages:
+  *  1. all unmuted voices of the input PCM are summed up in an intermediate buffer of type MixAcc_t<TIN>
+  *  2. that buffer gets amplified, clipped and converted to the sample format of the output
+  *
+  * MixLoad() and MixStore() are dispatched at runtime to the fastest implementation the CPU supports
+  */
+
+// type of the intermediate buffer used for mixing TIN, i.e. float unless float doesnt have enough precision
+template<typename TIN>
+struct MixAcc
+{
+    using type = float;
+};
+
+template<>
+struct MixAcc<int32_t>
+{
+    using type = double;
+};
+
+template<typename TIN>
+using MixAcc_t = typename MixAcc<TIN>::type;
+
+
+enum class MixIsa : uint8_t
+{
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// returns the instruction set currently used by MixLoad() and MixStore()
+MixIsa MixGetIsa() noexcept;
+
+// forces the use of the given instruction set, if supported by the CPU; used for testing and benchmarking
+// returns false if the CPU doesnt support it, leaving the currently used one unchanged
+bool MixSetIsa(MixIsa isa) noexcept;
+
+// number of items mixed at once by IAudioOutput::Mix(), determines the size of the intermediate buffer on the stack
+constexpr size_t MixBlockItems = 2048;
+
+/**
+ * converts @p items samples to the intermediate mixing format: acc[i] = in[i]
+ */
+void MixLoad(const int16_t *RESTRICT in, float *RESTRICT acc, size_t items) noexcept;
+void MixLoad(const float *RESTRICT in, float *RESTRICT acc, size_t items) noexcept;
+void MixLoad(const int32_t *RESTRICT in, double *RESTRICT acc, size_t items) noexcept;
+
+/**
+ * amplifies, clips and converts @p items mixed samples to the output format: out[i] = clip(acc[i] * gain)
+ *
+ * floating point output is clipped to [-1.0, 1.0], integer output to the range of the integer type and rounded to nearest
+ */
+void MixStore(const float *RESTRICT acc, float *RESTRICT out, size_t items, float gain) noexcept;
+void MixStore(const float *RESTRICT acc, int16_t *RESTRICT out, size_t items, float gain) noexcept;
+void MixStore(const double *RESTRICT acc, int32_t *RESTRICT out, size_t items, double gain) noexcept;
+void MixStore(const double *RESTRICT acc, float *RESTRICT out, size_t items, double gain) noexcept;
+
+/**
+ * converts @p items integer samples straight to float without clipping: out[i] = in[i] * scale
+ *
+ * used if the pcm doesnt need to be mixed at all, but the audio driver requires floats
+ */
+void MixConvert(const int16_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept;
+void MixConvert(const int32_t *RESTRICT in, float *RESTRICT out, size_t items, float scale) noexcept;
+
+/**
+ * converts @p frames samples of one (@p right == @p left) or two channels in the fixed point format of libmad (28 fractional bits)
+ * to interleaved int32 PCM of @p channels (1 or 2) channels, holding 24 significant bits like minimad does: rounded, clipped to
+ * [-1.0, 1.0) and shifted into the most significant bits. unless @p gain is 1.0, the result is amplified afterwards, rounding down.
+ *
+ * used by the LibMadWrapper to write the synthesized PCM straight to the buffer of a song
+ */
+void MixConvertFixed(const int32_t *RESTRICT left, const int32_t *RESTRICT right, int32_t *RESTRICT out, size_t frames, uint32_t channels, float gain) noexcept;
+
+/**
+ * interleaves @p frames samples of @p channels channels, each of them given as separate plane: out[f * channels + c] = planes[c][f]
+ *
+ * used by the FFMpegWrapper to write the planar output of decoders straight to the buffer of a song
+ */
+void MixInterleave(const int16_t *const *planes, int16_t *RESTRICT out, size_t frames, uint32_t channels) noexcept;
+void MixInterleave(const int32_t *const *planes, int32_t *RESTRICT out, size_t frames, uint32_t channels) noexcept;
+void MixInterleave(const float *const *planes, float *RESTRICT out, size_t frames, uint32_t channels) noexcept;
@@ -128,6 +128,8 @@ void PortAudioOutput::_init(SongFormat &format, bool)
         THROW_RUNTIME_ERROR("unable to open pcm (" << Pa_GetErrorText(err) << ")");
     }
 
+    this->periodSize = gConfig.FramesToRender;
+
     this->start();
 }
 
@@ -173,8 +175,7 @@ int PortAudioOutput::write(const T *buffer, frame_t frames)
         THROW_RUNTIME_ERROR("unable to write pcm since PortAudioOutput::init() has not been called yet or init failed");
     }
     
-    auto* procBuf = reinterpret_cast<T*>(processedBuffer.data());
-    this->Mix<T, T>(frames, buffer, this->currentFormat, procBuf);
+    const T *procBuf = this->Process<T>(frames, buffer);
 
     PaError err = Pa_WriteStream(d->handle, procBuf, frames);
     switch (err)
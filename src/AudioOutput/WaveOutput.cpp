@@ -350,6 +350,15 @@ void WaveOutput::close()
     this->framesWritten = 0;
 }
 
+bool WaveOutput::CanSpliceSongs() const noexcept
+{
+    return false;
+}
+
+bool WaveOutput::IsRealtime() const noexcept
+{
+    return false;
+}
 
 template<typename T>
 int WaveOutput::write(const T *buffer, frame_t frames)
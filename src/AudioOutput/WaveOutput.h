@@ -34,6 +34,11 @@ class WaveOutput : public IAudioOutput
 
     void close() override;
 
+    // each song is written separately
+    bool CanSpliceSongs() const noexcept override;
+
+    bool IsRealtime() const noexcept override;
+
     int write(const float *buffer, frame_t frames) override;
 
     int write(const int16_t *buffer, frame_t frames) override;
@@ -158,6 +158,16 @@ void ebur128Output::close()
     d->currentSong = nullptr;
 }
 
+bool ebur128Output::CanSpliceSongs() const noexcept
+{
+    return false;
+}
+
+bool ebur128Output::IsRealtime() const noexcept
+{
+    return false;
+}
+
 int ebur128Output::write(const float *buffer, frame_t frames)
 {
     std::lock_guard<std::recursive_mutex> lck(d->mtx);
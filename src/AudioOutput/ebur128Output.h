@@ -30,6 +30,11 @@ class ebur128Output : public IAudioOutput
 
     void close() override;
 
+    // each song is written separately
+    bool CanSpliceSongs() const noexcept override;
+
+    bool IsRealtime() const noexcept override;
+
     int write(const float *buffer, frame_t frames) override;
 
     int write(const int16_t *buffer, frame_t frames) override;
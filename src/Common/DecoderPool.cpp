@@ -0,0 +1,123 @@
+#include "DecoderPool.h"
+
+#include "AtomicWrite.h"
+#include "Config.h"
+#include "ThreadPriority.h"
+
+#include <algorithm>
+
+DecoderPool::DecoderPool(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        // leave at least one core for the playback and gui threads
+        threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        this->workers.emplace_back(&DecoderPool::workerLoop, this);
+    }
+
+    CLOG(LogLevel_t::Debug, "started " << threads << " decoder threads");
+}
+
+DecoderPool::~DecoderPool()
+{
+    {
+        std::lock_guard<std::mutex> lck(this->mtx);
+        this->shutdown = true;
+    }
+    this->cv.notify_all();
+
+    for (std::thread &t : this->workers)
+    {
+        t.join();
+    }
+}
+
+DecoderPool &DecoderPool::Singleton()
+{
+    // guaranteed to be destroyed
+    static DecoderPool instance(gConfig.DecoderThreads);
+
+    return instance;
+}
+
+size_t DecoderPool::size() const noexcept
+{
+    return this->workers.size();
+}
+
+std::future<void> DecoderPool::submit(const void *owner, std::function<void()> task)
+{
+    std::packaged_task<void()> wrapper([t = std::move(task)]() {
+        try
+        {
+            t();
+        }
+        catch (const std::exception &e)
+        {
+            CLOG(LogLevel_t::Error, "decoder task failed: " << e.what());
+        }
+    });
+    std::future<void> fut = wrapper.get_future();
+
+    {
+        std::lock_guard<std::mutex> lck(this->mtx);
+
+        OwnerQueue &q = this->queues[owner];
+        q.tasks.push_back(std::move(wrapper));
+
+        // if the owner is already waiting or being served, the task will be picked up later on
+        if (!q.running && q.tasks.size() == 1)
+        {
+            this->ready.push_back(owner);
+        }
+    }
+    this->cv.notify_one();
+
+    return fut;
+}
+
+void DecoderPool::workerLoop()
+{
+    ThreadPriority tp(gConfig.DecoderThreadPriority);
+
+    std::unique_lock<std::mutex> lck(this->mtx);
+    while (true)
+    {
+        this->cv.wait(lck, [this] { return this->shutdown || !this->ready.empty(); });
+
+        if (this->ready.empty())
+        {
+            // shutdown requested and nothing left to do
+            break;
+        }
+
+        const void *owner = this->ready.front();
+        this->ready.pop_front();
+
+        OwnerQueue &q = this->queues[owner];
+        std::packaged_task<void()> task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        q.running = true;
+
+        lck.unlock();
+        task();
+        lck.lock();
+
+        // references into std::map stay valid, as long as the element is not erased
+        q.running = false;
+        if (q.tasks.empty())
+        {
+            this->queues.erase(owner);
+        }
+        else
+        {
+            // give other owners a chance first
+            this->ready.push_back(owner);
+            this->cv.notify_one();
+        }
+    }
+}
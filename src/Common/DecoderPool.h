@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  * class DecoderPool
+  *
+  * a fixed number of worker threads shared by all songs, that asynchronously render PCM
+  *
+  * each owner (usually a Song) has its own task queue. tasks of the same owner are executed
+  * one after another in the order they have been submitted, never concurrently. different owners
+  * are served in a round-robin fashion, so a song that renders a lot cannot starve the others.
+  *
+  * the number of threads and their priority is determined by gConfig.DecoderThreads and
+  * gConfig.DecoderThreadPriority when the pool is used for the first time
+  */
+
+class DecoderPool
+{
+    public:
+    // no copy
+    DecoderPool(const DecoderPool &) = delete;
+    // no assign
+    DecoderPool &operator=(const DecoderPool &) = delete;
+
+    ~DecoderPool();
+
+    // returns the process-wide pool
+    static DecoderPool &Singleton();
+
+    /**
+     * enqueues a task to the queue of the given owner
+     *
+     * exceptions thrown by the task will be logged and are not propagated to the returned future
+     *
+     * @param owner identifies the queue, the task is enqueued in
+     * @param task the work to be done
+     *
+     * @return a future that becomes ready once the task has been executed
+     */
+    std::future<void> submit(const void *owner, std::function<void()> task);
+
+    /**
+     * @return the number of worker threads
+     */
+    size_t size() const noexcept;
+
+    private:
+    DecoderPool(unsigned int threads);
+
+    struct OwnerQueue
+    {
+        std::deque<std::packaged_task<void()>> tasks;
+
+        // whether a worker is currently executing a task of this owner
+        bool running = false;
+    };
+
+    void workerLoop();
+
+    std::map<const void *, OwnerQueue> queues;
+
+    // owners that have pending tasks and are not being served at the moment, in the order they will be served
+    std::deque<const void *> ready;
+
+    std::vector<std::thread> workers;
+
+    bool shutdown = false;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+};
@@ -2,8 +2,12 @@
 #pragma once
 
 
-#include <map>
+#include <algorithm>
+#include <atomic>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 
 /** @brief a helper class for realizing C# like events
@@ -39,70 +43,216 @@
  * someOtherEvent -= someObject;
  * someOtherEvent -= this;
  * @endcode
+ *
+ * the subscribers are kept in an immutable array, that gets replaced as a whole when subscribing or unsubscribing (copy-on-write).
+ * thus firing an event doesnt allocate, never waits for anyone (un)subscribing and callbacks are free to (un)subscribe from within.
+ * firing is still serialized though: a subscriber is never called by two threads at the same time.
+ * once operator-= returns, the subscriber removed wont be called anymore, not even by a dispatch running on another thread
+ * (it waits for them to finish), thus it may be destroyed right away. unless called from within a callback of the same event,
+ * which cannot wait for its own dispatch.
+ * operator() takes the arguments by reference, but every subscriber receives its own copy of each argument that is declared
+ * by value in Args. declare expensive ones as const reference in Args to pass them on without copying.
  */
+
+// the dispatches running on the current thread, innermost first, to tell whether operator-= is called from within a callback
+struct EventDispatch
+{
+    const void *event;
+    const EventDispatch *outer;
+};
+
+inline const EventDispatch *&CurrentEventDispatch() noexcept
+{
+    static thread_local const EventDispatch *current = nullptr;
+    return current;
+}
+
 template<typename... Args>
 class Event
 {
-    std::map<void *, void (*)(void *, Args...)> callbacks;
+    using Callback = void (*)(void *, Args...);
+    using Subscribers = std::vector<std::pair<void *, Callback>>;
 
     public:
-    Event<Args...> &operator+=(std::pair<void *, void (*)(void *, Args...)>);
-    Event<Args...> &operator-=(std::pair<void *, void (*)(void *, Args...)>);
+    Event() = default;
+    ~Event();
+
+    // no copy
+    Event(const Event &) = delete;
+    // no assign
+    Event &operator=(const Event &) = delete;
+
+    Event<Args...> &operator+=(std::pair<void *, Callback>);
+    Event<Args...> &operator-=(std::pair<void *, Callback>);
     Event<Args...> &operator-=(void *obj);
 
-    Event<Args...> &operator()(Args... args);
+    Event<Args...> &operator()(const Args &... args);
 
     private:
+    // the array currently used for firing, never modified once published
+    std::atomic<const Subscribers *> subscribers{new Subscribers()};
+
+    // number of threads currently firing this event, counted separately for both values of this->epoch at the time they started
+    std::atomic<unsigned int> firing[2] = {{0}, {0}};
+    std::atomic<unsigned int> epoch{0};
+
+    // arrays that have been replaced, but might still be used by a thread firing the event
+    std::vector<const Subscribers *> retired;
+
+    // serializes subscribing and unsubscribing, never held while waiting for dispatches
     mutable std::mutex mtx;
+
+    // serializes waiting for dispatches, as the epoch must not be flipped by two threads at the same time
+    std::mutex graceMtx;
+
+    // serializes firing, recursive as a callback may fire the same event again
+    std::recursive_mutex fireMtx;
+
+    void publish(Subscribers *newSubscribers, std::unique_lock<std::mutex> &lock, bool removed);
+    bool isFiringOnThisThread() const noexcept;
+    void waitForDispatches() noexcept;
 };
 
 template<typename... Args>
-Event<Args...> &Event<Args...>::operator+=(std::pair<void *, void (*)(void *, Args...)> t)
+Event<Args...>::~Event()
 {
-    std::lock_guard<std::mutex> lock(this->mtx);
+    delete this->subscribers.load();
+    for (const Subscribers *r : this->retired)
+    {
+        delete r;
+    }
+}
 
-    this->callbacks[t.first] = t.second;
+template<typename... Args>
+void Event<Args...>::publish(Subscribers *newSubscribers, std::unique_lock<std::mutex> &lock, bool removed)
+{
+    // a thread starting to fire from now on will see the new array
+    const Subscribers *old = this->subscribers.exchange(newSubscribers);
 
-    return *this;
+    if (removed && !this->isFiringOnThisThread())
+    {
+        // make sure noone is calling a subscriber removed anymore, this also means noone is using the old array anymore.
+        // dont hold this->mtx meanwhile, a callback running on another thread may (un)subscribe as well
+        lock.unlock();
+        this->waitForDispatches();
+        delete old;
+        return;
+    }
+
+    this->retired.push_back(old);
+    if (this->firing[0] != 0 || this->firing[1] != 0)
+    {
+        // someone might still be using the old arrays, keep them until we come along the next time
+        return;
+    }
+
+    for (const Subscribers *r : this->retired)
+    {
+        delete r;
+    }
+    this->retired.clear();
+}
+
+template<typename... Args>
+bool Event<Args...>::isFiringOnThisThread() const noexcept
+{
+    for (const EventDispatch *d = CurrentEventDispatch(); d != nullptr; d = d->outer)
+    {
+        if (d->event == this)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * waits until all dispatches that started before have finished, while letting new ones start
+ *
+ * like RCU does it, the epoch is flipped twice, each time waiting for the dispatches counted for the previous one. a dispatch
+ * that fetched the epoch before a flip, but incremented its counter only after we checked it, fetches the new array anyway.
+ */
+template<typename... Args>
+void Event<Args...>::waitForDispatches() noexcept
+{
+    std::lock_guard<std::mutex> lock(this->graceMtx);
+    for (int i = 0; i < 2; i++)
+    {
+        const unsigned int previous = this->epoch.fetch_xor(1);
+        while (this->firing[previous] != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
 }
 
 template<typename... Args>
-Event<Args...> &Event<Args...>::operator-=(std::pair<void *, void (*)(void *, Args...)> t)
+Event<Args...> &Event<Args...>::operator+=(std::pair<void *, Callback> t)
 {
-    std::lock_guard<std::mutex> lock(this->mtx);
+    std::unique_lock<std::mutex> lock(this->mtx);
 
-    void *obj = t.first;
+    Subscribers *copy = new Subscribers(*this->subscribers.load());
 
-    typename std::map<void *, void (*)(void *, Args...)>::iterator it = this->callbacks.find(obj);
-    if (it != this->callbacks.end() && it->second == t.second)
+    auto it = std::find_if(copy->begin(), copy->end(), [&t](const std::pair<void *, Callback> &s) { return s.first == t.first; });
+    if (it != copy->end())
+    {
+        it->second = t.second;
+    }
+    else
     {
-        this->callbacks.erase(it);
+        copy->push_back(t);
     }
 
+    this->publish(copy, lock, false);
+
+    return *this;
+}
+
+template<typename... Args>
+Event<Args...> &Event<Args...>::operator-=(std::pair<void *, Callback> t)
+{
+    std::unique_lock<std::mutex> lock(this->mtx);
+
+    Subscribers *copy = new Subscribers(*this->subscribers.load());
+    copy->erase(std::remove(copy->begin(), copy->end(), t), copy->end());
+
+    this->publish(copy, lock, true);
+
     return *this;
 }
 
 template<typename... Args>
 Event<Args...> &Event<Args...>::operator-=(void *obj)
 {
-    std::lock_guard<std::mutex> lock(this->mtx);
+    std::unique_lock<std::mutex> lock(this->mtx);
+
+    Subscribers *copy = new Subscribers(*this->subscribers.load());
+    copy->erase(std::remove_if(copy->begin(), copy->end(), [obj](const std::pair<void *, Callback> &s) { return s.first == obj; }), copy->end());
 
-    this->callbacks.erase(obj);
+    this->publish(copy, lock, true);
 
     return *this;
 }
 
 template<typename... Args>
-Event<Args...> &Event<Args...>::operator()(Args... args)
+Event<Args...> &Event<Args...>::operator()(const Args &... args)
 {
-    std::lock_guard<std::mutex> lock(this->mtx);
+    std::lock_guard<std::recursive_mutex> lock(this->fireMtx);
 
-    typename std::map<void *, void (*)(void *, Args...)>::iterator it;
+    // announce that we are firing before fetching the array, so it wont be deleted while we are using it
+    const unsigned int epoch = this->epoch.load();
+    this->firing[epoch]++;
+    EventDispatch dispatch{this, CurrentEventDispatch()};
+    CurrentEventDispatch() = &dispatch;
 
-    for (it = this->callbacks.begin(); it != this->callbacks.end(); it++)
+    const Subscribers *subs = this->subscribers.load();
+    for (const std::pair<void *, Callback> &s : *subs)
     {
-        it->second(it->first, args...);
+        s.second(s.first, args...);
     }
 
+    CurrentEventDispatch() = dispatch.outer;
+    this->firing[epoch]--;
+
     return *this;
 }
@@ -0,0 +1,105 @@
+#include "LoopPlan.h"
+
+#include "CommonExceptions.h"
+
+#include <algorithm>
+
+
+void LoopPlan::compile(const core::tree<loop_t> &loopTree)
+{
+    this->plan.clear();
+
+    const loop_t &root = *loopTree;
+    this->compile(loopTree, root.start, root.stop);
+}
+
+void LoopPlan::compile(const core::tree<loop_t> &node, frame_t start, frame_t stop)
+{
+    // play the subloops in the order they start
+    std::vector<const core::tree<loop_t> *> children;
+    for (core::tree<loop_t>::iterator it = node.begin(); it != node.end(); ++it)
+    {
+        children.push_back(it.tree_ptr());
+    }
+    std::sort(children.begin(), children.end(), [](const core::tree<loop_t> *a, const core::tree<loop_t> *b) { return (**a).start < (**b).start; });
+
+    frame_t pos = start;
+    for (const core::tree<loop_t> *child : children)
+    {
+        const loop_t &sub = **child;
+        if (sub.start < pos || sub.stop > stop)
+        {
+            // Should never happen, unless there are illegal loop points
+            throw LoopTreeConstructionException();
+        }
+
+        // the part before the subloop
+        if (pos < sub.start)
+        {
+            this->plan.push_back({pos, sub.start, NoLoop, 0});
+        }
+
+        const size_t loopStart = this->plan.size();
+        this->compile(*child, sub.start, sub.stop);
+
+        // let the last segment of the subloop jump back to its first one. if that segment already closes
+        // a loop ending at the same frame, add an empty one, so that both loops are played properly
+        if (this->plan.size() == loopStart || this->plan.back().loopBack != NoLoop)
+        {
+            this->plan.push_back({sub.stop, sub.stop, NoLoop, 0});
+        }
+        this->plan.back().loopBack = loopStart;
+        this->plan.back().count = sub.count;
+
+        pos = sub.stop;
+    }
+
+    // the rest after the last subloop
+    if (pos < stop)
+    {
+        this->plan.push_back({pos, stop, NoLoop, 0});
+    }
+}
+
+const std::vector<LoopPlan::Segment> &LoopPlan::segments() const noexcept
+{
+    return this->plan;
+}
+
+bool LoopPlan::empty() const noexcept
+{
+    return this->plan.empty();
+}
+
+void LoopPlan::seek(Cursor &cursor, frame_t frame) const
+{
+    cursor.played.assign(this->plan.size(), 0);
+
+    // segments are sorted by stop, find the first one that hasnt been played completely at frame
+    auto it = std::upper_bound(this->plan.begin(), this->plan.end(), frame, [](frame_t f, const Segment &s) { return f < s.stop; });
+    cursor.segment = it - this->plan.begin();
+}
+
+frame_t LoopPlan::advance(Cursor &cursor, bool useLoops, int overridingCount) const noexcept
+{
+    const size_t current = cursor.segment;
+    const Segment &s = this->plan[current];
+
+    if (useLoops && s.loopBack != NoLoop)
+    {
+        const uint32_t count = overridingCount >= 0 ? static_cast<uint32_t>(overridingCount) : s.count;
+        uint32_t &played = cursor.played[current];
+
+        if (count == 0 || ++played < count)
+        {
+            cursor.segment = s.loopBack;
+            return this->plan[s.loopBack].start;
+        }
+
+        // the loop is done, reset it in case an outer loop plays it once again
+        played = 0;
+    }
+
+    cursor.segment = current + 1;
+    return cursor.segment < this->plan.size() ? this->plan[cursor.segment].start : s.stop;
+}
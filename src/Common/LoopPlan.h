@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// tree.h relies on size_t being declared
+#include "tree.h"
+#include "types.h"
+
+/**
+  * class LoopPlan
+  *
+  * a loop tree (see Song::loopTree) compiled to a flat list of segments, that can be played back by simply
+  * advancing a cursor, rather than walking the tree for every chunk of pcm
+  *
+  * each segment covers the frames [start, stop). played one after another without taking any loop, all segments
+  * together cover the whole song exactly once. a segment that closes a loop additionally refers to the segment
+  * the loop starts with, and tells how often the loop is played in total.
+  *
+  * example: for a song of N frames, containing the loop ([3,10],5) which in turn contains ([5,7],2), the plan looks like:
+  *
+  *   #0 [0,3)
+  *   #1 [3,5)
+  *   #2 [5,7)   -> #2, 2 times
+  *   #3 [7,10)  -> #1, 5 times
+  *   #4 [10,N)
+  */
+class LoopPlan
+{
+    public:
+    static constexpr size_t NoLoop = std::numeric_limits<size_t>::max();
+
+    struct Segment
+    {
+        frame_t start = 0;
+
+        // this frame will not be played anymore
+        frame_t stop = 0;
+
+        // index of the segment to jump back to, once this one has been played, or NoLoop
+        size_t loopBack = NoLoop;
+
+        // how many times the loop closed by this segment is being played, zero indicates playing forever
+        uint32_t count = 0;
+    };
+
+    // the state of playing a plan
+    struct Cursor
+    {
+        // index of the segment currently being played
+        size_t segment = 0;
+
+        // for every segment: how many times its loop has been played so far
+        std::vector<uint32_t> played;
+    };
+
+    /**
+     * rebuilds the plan from the given loop tree, whose root has to cover the whole song
+     */
+    void compile(const core::tree<loop_t> &loopTree);
+
+    const std::vector<Segment> &segments() const noexcept;
+
+    /**
+     * @return true if there are no segments, i.e. compile() has not been called yet
+     */
+    bool empty() const noexcept;
+
+    /**
+     * resets @p cursor to the segment containing @p frame, forgetting about any loops played so far
+     *
+     * if @p frame is beyond the end of the plan, @p cursor will point past the last segment
+     */
+    void seek(Cursor &cursor, frame_t frame) const;
+
+    /**
+     * moves @p cursor to the segment to be played after the current one has been played completely
+     *
+     * @param cursor the cursor to advance, must point to a valid segment
+     * @param useLoops if false, loops are ignored and the segments are played in order
+     * @param overridingCount if not negative, overrides the count of every loop
+     *
+     * @return the frame playback has to continue from, i.e. the start of the segment @p cursor now points to, or
+     * the end of the song if the plan has been played completely
+     */
+    frame_t advance(Cursor &cursor, bool useLoops, int overridingCount) const noexcept;
+
+    private:
+    std::vector<Segment> plan;
+
+    void compile(const core::tree<loop_t> &node, frame_t start, frame_t stop);
+};
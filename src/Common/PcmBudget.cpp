@@ -0,0 +1,203 @@
+#include "PcmBudget.h"
+
+#include "AtomicWrite.h"
+#include "Config.h"
+#include "Song.h"
+
+#include <algorithm>
+
+PcmBudget::PcmBudget(size_t limit)
+: limit(limit)
+{
+}
+
+PcmBudget &PcmBudget::Singleton()
+{
+    // guaranteed to be destroyed
+    static PcmBudget instance(static_cast<size_t>(gConfig.PcmBudgetSize) * 1024 * 1024);
+
+    return instance;
+}
+
+/**
+ * blocks while @p song (or any song if nullptr) is being evicted by another thread
+ */
+void PcmBudget::waitForEviction(std::unique_lock<std::mutex> &lck, const Song *song)
+{
+    const std::thread::id me = std::this_thread::get_id();
+    this->cv.wait(lck, [this, song, me] {
+        return this->evicting == nullptr || this->evictor == me || (song != nullptr && this->evicting != song);
+    });
+}
+
+/**
+ * evicts the least recently used songs, except @p keep, until @p bytesNeeded fit into the budget or nothing is left to evict
+ */
+void PcmBudget::evictUntil(std::unique_lock<std::mutex> &lck, size_t bytesNeeded, const Song *keep)
+{
+    while (this->used + bytesNeeded > this->limit)
+    {
+        auto it = std::find_if(this->retained.begin(), this->retained.end(), [keep](const Song *s) { return s != keep; });
+        if (it == this->retained.end())
+        {
+            return;
+        }
+
+        Song *victim = *it;
+        this->retained.erase(it);
+
+        auto r = this->reserved.find(victim);
+        if (r != this->reserved.end())
+        {
+            this->used -= r->second;
+            this->reserved.erase(r);
+        }
+        this->evictions++;
+
+        // releasing the buffer may take a while (and calls back this->release()), so dont block everyone else meanwhile
+        this->evicting = victim;
+        this->evictor = std::this_thread::get_id();
+        lck.unlock();
+
+        CLOG(LogLevel_t::Debug, "evicting PCM of \"" << victim->Filename << "\"");
+        victim->releaseBuffer();
+
+        lck.lock();
+        this->evicting = nullptr;
+        this->cv.notify_all();
+    }
+}
+
+bool PcmBudget::tryReserve(const Song *owner, size_t bytes) noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->waitForEviction(lck, nullptr);
+
+    this->evictUntil(lck, bytes, owner);
+    if (this->used + bytes > this->limit)
+    {
+        return false;
+    }
+
+    this->reserved[owner] += bytes;
+    this->used += bytes;
+    return true;
+}
+
+void PcmBudget::reserve(const Song *owner, size_t bytes) noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->waitForEviction(lck, nullptr);
+
+    this->reserved[owner] += bytes;
+    this->used += bytes;
+
+    this->evictUntil(lck, 0, owner);
+}
+
+void PcmBudget::unreserve(const Song *owner, size_t bytes) noexcept
+{
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    auto r = this->reserved.find(owner);
+    if (r == this->reserved.end())
+    {
+        return;
+    }
+
+    bytes = std::min(bytes, r->second);
+    r->second -= bytes;
+    this->used -= bytes;
+    if (r->second == 0)
+    {
+        this->reserved.erase(r);
+    }
+}
+
+void PcmBudget::release(const Song *owner) noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    // if owner is being evicted by another thread, it must not free its buffers concurrently
+    this->waitForEviction(lck, owner);
+
+    this->retained.remove(const_cast<Song *>(owner));
+
+    auto r = this->reserved.find(owner);
+    if (r != this->reserved.end())
+    {
+        this->used -= r->second;
+        this->reserved.erase(r);
+    }
+}
+
+void PcmBudget::retain(Song *song) noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->waitForEviction(lck, nullptr);
+
+    if (this->reserved.count(song) == 0)
+    {
+        // nothing to keep
+        return;
+    }
+
+    this->retained.remove(song);
+    this->retained.push_back(song);
+
+    // the budget might have been exceeded by buffers that were needed anyway
+    this->evictUntil(lck, 0, nullptr);
+
+    CLOG(LogLevel_t::Debug, "retaining PCM of " << this->retained.size() << " songs, " << this->used / (1024 * 1024) << " of " << this->limit / (1024 * 1024) << " MiB used, " << this->hits << " hits, " << this->misses << " misses");
+}
+
+bool PcmBudget::reuse(Song *song) noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->waitForEviction(lck, song);
+
+    auto it = std::find(this->retained.begin(), this->retained.end(), song);
+    if (it == this->retained.end())
+    {
+        this->misses++;
+        return false;
+    }
+
+    this->retained.erase(it);
+    this->hits++;
+    return true;
+}
+
+size_t PcmBudget::evictRetained() noexcept
+{
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->waitForEviction(lck, nullptr);
+
+    // more than the whole budget never fits, so everything retained is evicted
+    const uint64_t before = this->evictions;
+    this->evictUntil(lck, this->limit + 1, nullptr);
+
+    return static_cast<size_t>(this->evictions - before);
+}
+
+PcmBudget::Stats PcmBudget::getStats() const noexcept
+{
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    Stats s{};
+    s.limit = this->limit;
+    s.used = this->used;
+    for (const Song *song : this->retained)
+    {
+        auto r = this->reserved.find(song);
+        if (r != this->reserved.end())
+        {
+            s.retained += r->second;
+        }
+    }
+    s.retainedSongs = this->retained.size();
+    s.hits = this->hits;
+    s.misses = this->misses;
+    s.evictions = this->evictions;
+
+    return s;
+}
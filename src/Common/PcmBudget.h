@@ -0,0 +1,132 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+
+class Song;
+
+/**
+  * class PcmBudget
+  *
+  * accounts the memory occupied by the PCM buffers of all songs of the process against a common budget
+  *
+  * songs reserve memory before allocating their PCM buffers and release it once they free them. buffers that are
+  * optional (e.g. the whole song, if it could be streamed as well) are only allocated, if they fit into the budget.
+  *
+  * songs that are not played anymore, but hold their completely decoded PCM, may be retained instead of being released.
+  * they are kept until either they are played again or the memory is needed by other songs, in which case the least
+  * recently used songs are evicted first, by calling Song::releaseBuffer().
+  *
+  * all methods are thread-safe
+  */
+
+class PcmBudget
+{
+    public:
+    struct Stats
+    {
+        // the budget in bytes
+        size_t limit;
+
+        // bytes currently reserved by all songs, including retained ones
+        size_t used;
+
+        // bytes held by retained songs
+        size_t retained;
+
+        size_t retainedSongs;
+
+        // number of songs about to be played, whose PCM has (hits) or has not (misses) been retained
+        uint64_t hits;
+        uint64_t misses;
+
+        // number of retained songs released to make room for others
+        uint64_t evictions;
+    };
+
+    PcmBudget(size_t limit);
+
+    // no copy
+    PcmBudget(const PcmBudget &) = delete;
+    // no assign
+    PcmBudget &operator=(const PcmBudget &) = delete;
+
+    // returns the process-wide budget of gConfig.PcmBudgetSize
+    static PcmBudget &Singleton();
+
+    /**
+     * reserves @p bytes for an optional buffer of @p owner, evicting retained songs if necessary
+     *
+     * @return false if the buffer doesnt fit into the budget, in which case nothing is reserved
+     */
+    bool tryReserve(const Song *owner, size_t bytes) noexcept;
+
+    /**
+     * reserves @p bytes for a buffer of @p owner, that is needed anyway, even if it exceeds the budget
+     */
+    void reserve(const Song *owner, size_t bytes) noexcept;
+
+    /**
+     * returns @p bytes previously reserved by @p owner
+     */
+    void unreserve(const Song *owner, size_t bytes) noexcept;
+
+    /**
+     * returns all bytes reserved by @p owner, because it has freed all its buffers
+     *
+     * must be called by Song::releaseBuffer(), before freeing anything
+     */
+    void release(const Song *owner) noexcept;
+
+    /**
+     * keeps the PCM of @p song, that is not played anymore, until the memory is needed for other songs
+     *
+     * @p song must hold its completely decoded PCM, see Song::isBufferComplete()
+     */
+    void retain(Song *song) noexcept;
+
+    /**
+     * to be called before @p song is played again, to make sure it is not evicted while being played
+     *
+     * @return true if the song's PCM has been retained, i.e. it doesnt need to be decoded again
+     */
+    bool reuse(Song *song) noexcept;
+
+    /**
+     * releases all retained songs, e.g. because the system runs out of memory
+     *
+     * @return the number of songs released
+     */
+    size_t evictRetained() noexcept;
+
+    Stats getStats() const noexcept;
+
+    private:
+    const size_t limit;
+
+    // bytes reserved per song
+    std::map<const Song *, size_t> reserved;
+    size_t used = 0;
+
+    // retained songs, the least recently used one first
+    std::list<Song *> retained;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // the song currently being evicted and the thread doing so; there is only ever one eviction at a time
+    const Song *evicting = nullptr;
+    std::thread::id evictor;
+
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+
+    void waitForEviction(std::unique_lock<std::mutex> &lck, const Song *song);
+    void evictUntil(std::unique_lock<std::mutex> &lck, size_t bytesNeeded, const Song *keep);
+};
@@ -0,0 +1,350 @@
+#include "PcmCache.h"
+
+#include "AtomicWrite.h"
+#include "Common.h"
+#include "Config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+#ifdef _POSIX_C_SOURCE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h> // _POSIX_MAPPED_FILES
+#endif
+
+namespace fs = std::filesystem;
+
+#if defined(_POSIX_C_SOURCE) && _POSIX_MAPPED_FILES && _POSIX_C_SOURCE >= 200112L
+#define PCMCACHE_AVAILABLE 1
+#else
+#define PCMCACHE_AVAILABLE 0
+#endif
+
+static constexpr const char *EntrySuffix = ".pcm";
+
+// temporary files of entries not committed for that long have been left behind by a crashed or killed process
+static constexpr std::chrono::hours TmpFileGracePeriod{1};
+
+// @return true for the temporary files created by PcmCache::create(), i.e. "<entry>.pcm.XXXXXX"
+static bool isTmpFile(const fs::path &path)
+{
+    return path.stem().extension() == EntrySuffix;
+}
+
+// 64 bit FNV-1a
+static constexpr uint64_t FnvOffset = 14695981039346656037ULL;
+static constexpr uint64_t FnvPrime = 1099511628211ULL;
+
+static uint64_t fnv1a(const void *buf, size_t len, uint64_t hash = FnvOffset) noexcept
+{
+    const unsigned char *p = static_cast<const unsigned char *>(buf);
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+static std::string toHex(uint64_t hash)
+{
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+PcmCache::PcmCache(std::string dir, size_t maxBytes)
+: dir(std::move(dir)), maxBytes(maxBytes)
+{
+    std::error_code ec;
+    fs::create_directories(this->dir, ec);
+    if (ec)
+    {
+        CLOG(LogLevel_t::Warning, "failed to create PCM cache directory '" << this->dir << "': " << ec.message());
+    }
+
+    this->removeStaleTmpFiles();
+}
+
+PcmCache &PcmCache::Singleton()
+{
+    // guaranteed to be destroyed
+    static PcmCache instance(myHomeDir() + "/" + Config::UserDir + "/pcmcache", static_cast<size_t>(gConfig.PcmCacheSize) * 1024 * 1024);
+
+    return instance;
+}
+
+std::string PcmCache::hashFile(const std::string &path) noexcept
+{
+    try
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            return "";
+        }
+
+        uint64_t hash = FnvOffset;
+        std::vector<char> buf(1 << 16);
+        while (in)
+        {
+            in.read(buf.data(), buf.size());
+            hash = fnv1a(buf.data(), static_cast<size_t>(in.gcount()), hash);
+        }
+
+        return in.bad() ? "" : toHex(hash);
+    }
+    catch (const std::exception &)
+    {
+        return "";
+    }
+}
+
+std::string PcmCache::entryFile(const std::string &key) const
+{
+    const unsigned int version = Version;
+    uint64_t hash = fnv1a(&version, sizeof(version));
+    hash = fnv1a(key.data(), key.size(), hash);
+
+    return this->dir + "/" + toHex(hash) + EntrySuffix;
+}
+
+void *PcmCache::open(const std::string &key, size_t bytes) noexcept
+{
+#if PCMCACHE_AVAILABLE
+    if (bytes == 0)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    const std::string file = this->entryFile(key);
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+
+    void *pcm = nullptr;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == bytes)
+    {
+        pcm = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (pcm == MAP_FAILED)
+        {
+            pcm = nullptr;
+        }
+        else
+        {
+            // mark the entry as recently used
+            futimens(fd, nullptr);
+        }
+    }
+    else
+    {
+        CLOG(LogLevel_t::Warning, "ignoring PCM cache entry '" << file << "' of unexpected size");
+    }
+    ::close(fd);
+
+    return pcm;
+#else
+    (void)key;
+    (void)bytes;
+    return nullptr;
+#endif
+}
+
+void *PcmCache::create(const std::string &key, size_t bytes, std::string &tmpFile) noexcept
+{
+#if PCMCACHE_AVAILABLE
+    // dont bother if the entry would be evicted immediately anyway
+    if (bytes == 0 || bytes > this->maxBytes)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    std::string templ = this->entryFile(key) + ".XXXXXX";
+    int fd = mkstemp(templ.data());
+    if (fd == -1)
+    {
+        CLOG(LogLevel_t::Debug, "failed to create PCM cache entry: " << strerror(errno));
+        return nullptr;
+    }
+
+    void *pcm = nullptr;
+    int err = posix_fallocate(fd, 0, bytes);
+    if (err == 0)
+    {
+        pcm = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (pcm == MAP_FAILED)
+        {
+            err = errno;
+            pcm = nullptr;
+        }
+    }
+    ::close(fd);
+
+    if (pcm == nullptr)
+    {
+        CLOG(LogLevel_t::Debug, "failed to allocate PCM cache entry of " << bytes << " bytes: " << strerror(err));
+        unlink(templ.c_str());
+        return nullptr;
+    }
+
+    tmpFile = std::move(templ);
+    return pcm;
+#else
+    (void)key;
+    (void)bytes;
+    (void)tmpFile;
+    return nullptr;
+#endif
+}
+
+void PcmCache::commit(const std::string &key, const std::string &tmpFile) noexcept
+{
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    std::error_code ec;
+    fs::rename(tmpFile, this->entryFile(key), ec);
+    if (ec)
+    {
+        CLOG(LogLevel_t::Warning, "failed to commit PCM cache entry '" << tmpFile << "': " << ec.message());
+        fs::remove(tmpFile, ec);
+        return;
+    }
+
+    this->evict();
+}
+
+void PcmCache::discard(const std::string &tmpFile) noexcept
+{
+    std::error_code ec;
+    fs::remove(tmpFile, ec);
+}
+
+size_t PcmCache::size() const noexcept
+{
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    size_t total = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(this->dir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() == EntrySuffix || isTmpFile(it->path()))
+        {
+            std::error_code ec2;
+            const uintmax_t bytes = it->file_size(ec2);
+            total += ec2 ? 0 : bytes;
+        }
+    }
+    return total;
+}
+
+void PcmCache::removeStaleTmpFiles() noexcept
+{
+    try
+    {
+        const fs::file_time_type Now = fs::file_time_type::clock::now();
+
+        std::error_code ec;
+        for (fs::directory_iterator it(this->dir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code ec2;
+            if (!isTmpFile(it->path()) || Now - it->last_write_time(ec2) < TmpFileGracePeriod || ec2)
+            {
+                continue;
+            }
+
+            if (fs::remove(it->path(), ec2))
+            {
+                CLOG(LogLevel_t::Debug, "removed stale PCM cache entry " << it->path().filename());
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        CLOG(LogLevel_t::Warning, "failed to remove stale PCM cache entries: " << e.what());
+    }
+}
+
+void PcmCache::evict() noexcept
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uintmax_t size;
+    };
+
+    try
+    {
+        std::vector<Entry> entries;
+        size_t total = 0;
+
+        std::error_code ec;
+        for (fs::directory_iterator it(this->dir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::error_code ec2;
+            if (isTmpFile(it->path()))
+            {
+                // entries being created occupy their space already, but cannot be evicted
+                const uintmax_t bytes = it->file_size(ec2);
+                total += ec2 ? 0 : bytes;
+                continue;
+            }
+            if (it->path().extension() != EntrySuffix)
+            {
+                continue;
+            }
+
+            Entry e{it->path(), it->last_write_time(ec2), it->file_size(ec2)};
+            if (!ec2)
+            {
+                total += e.size;
+                entries.push_back(std::move(e));
+            }
+        }
+
+        if (total <= this->maxBytes)
+        {
+            return;
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.lastUsed < b.lastUsed; });
+
+        // songs that are currently being played keep their mapping, even if their file is removed
+        for (const Entry &e : entries)
+        {
+            if (total <= this->maxBytes)
+            {
+                break;
+            }
+
+            if (fs::remove(e.path, ec))
+            {
+                total -= e.size;
+                CLOG(LogLevel_t::Debug, "evicted PCM cache entry " << e.path.filename());
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        CLOG(LogLevel_t::Warning, "failed to evict PCM cache entries: " << e.what());
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+/**
+  * class PcmCache
+  *
+  * keeps decoded PCM of songs on disk, so that formats which are expensive to decode (emulated or synthesized ones)
+  * dont have to be decoded again, each time they are played
+  *
+  * entries are addressed by a key, which has to describe everything the PCM depends on (content of the file, wrapper,
+  * settings, ...). each entry is a plain file holding the raw PCM, that is memory mapped when being used, thus it
+  * doesnt occupy any anonymous memory.
+  *
+  * new entries are written by memory mapping a temporary file and rendering directly into it. once rendering has
+  * completed, the entry is committed and becomes visible for subsequent lookups. if the cache exceeds its size
+  * limit, least recently used entries are evicted. temporary files left behind by a previous process are removed
+  * when the cache is constructed.
+  *
+  * all methods are thread-safe
+  */
+
+class PcmCache
+{
+    public:
+    // bump this whenever the PCM rendered by any wrapper changes, so that outdated entries are not used anymore
+    static constexpr unsigned int Version = 1;
+
+    /**
+     * @param dir the directory holding the cache entries, it is created if necessary
+     * @param maxBytes the size limit of the cache
+     */
+    PcmCache(std::string dir, size_t maxBytes);
+
+    // no copy
+    PcmCache(const PcmCache &) = delete;
+    // no assign
+    PcmCache &operator=(const PcmCache &) = delete;
+
+    // returns the process-wide cache, located in the user's ANMP directory and limited to gConfig.PcmCacheSize
+    static PcmCache &Singleton();
+
+    /**
+     * @return a hash of the content of the given file, an empty string if the file cannot be read
+     */
+    static std::string hashFile(const std::string &path) noexcept;
+
+    /**
+     * maps the entry for @p key read-only
+     *
+     * @return the PCM, to be released with munmap(), or nullptr if there is no entry of exactly @p bytes
+     */
+    void *open(const std::string &key, size_t bytes) noexcept;
+
+    /**
+     * creates a new, not yet visible entry for @p key and maps it writable
+     *
+     * @param tmpFile receives the name of the temporary file backing the mapping, to be passed to commit() or discard()
+     *
+     * @return the PCM buffer to be rendered into, to be released with munmap(), or nullptr if the entry couldnt be created
+     */
+    void *create(const std::string &key, size_t bytes, std::string &tmpFile) noexcept;
+
+    /**
+     * makes an entry created by create() visible, once its PCM has been rendered completely
+     */
+    void commit(const std::string &key, const std::string &tmpFile) noexcept;
+
+    /**
+     * throws away an entry created by create(), e.g. because rendering has been aborted
+     */
+    void discard(const std::string &tmpFile) noexcept;
+
+    /**
+     * @return the number of bytes currently occupied by the committed entries and the ones being created
+     */
+    size_t size() const noexcept;
+
+    private:
+    const std::string dir;
+    const size_t maxBytes;
+
+    mutable std::mutex mtx;
+
+    std::string entryFile(const std::string &key) const;
+
+    // removes the least recently used entries until the cache fits into maxBytes again
+    void evict() noexcept;
+
+    // removes the temporary files of entries that have never been committed nor discarded, e.g. because ANMP crashed while rendering
+    void removeStaleTmpFiles() noexcept;
+};
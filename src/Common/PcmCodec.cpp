@@ -0,0 +1,300 @@
+#include "PcmCodec.h"
+
+#include <cstring>
+
+// maps samples to unsigned integers of the same size, such that the order of the samples is preserved
+template<typename T>
+struct PcmOrdered;
+
+template<>
+struct PcmOrdered<uint8_t>
+{
+    using type = uint8_t;
+    static type to(uint8_t s)
+    {
+        return s;
+    }
+    static uint8_t from(type u)
+    {
+        return u;
+    }
+};
+
+template<>
+struct PcmOrdered<int16_t>
+{
+    using type = uint16_t;
+    static type to(int16_t s)
+    {
+        return static_cast<type>(s);
+    }
+    static int16_t from(type u)
+    {
+        return static_cast<int16_t>(u);
+    }
+};
+
+template<>
+struct PcmOrdered<int32_t>
+{
+    using type = uint32_t;
+    static type to(int32_t s)
+    {
+        return static_cast<type>(s);
+    }
+    static int32_t from(type u)
+    {
+        return static_cast<int32_t>(u);
+    }
+};
+
+// libsndfile hands out either ints or floats here, but mostly ints, so treat them as such
+template<>
+struct PcmOrdered<sndfile_sample_t>
+{
+    using type = uint32_t;
+    static type to(sndfile_sample_t s)
+    {
+        return static_cast<type>(s.i);
+    }
+    static sndfile_sample_t from(type u)
+    {
+        sndfile_sample_t s;
+        s.i = static_cast<int32_t>(u);
+        return s;
+    }
+};
+
+// IEEE floats compare like sign-magnitude integers: flipping all bits but the sign of negative ones turns them into two's complement
+template<typename F, typename U>
+struct PcmOrderedFloat
+{
+    static_assert(sizeof(F) == sizeof(U), "unexpected size of floating point type");
+
+    using type = U;
+    static constexpr U Magnitude = static_cast<U>(~U(0)) >> 1;
+
+    static type to(F s)
+    {
+        U u;
+        std::memcpy(&u, &s, sizeof(u));
+        return u ^ ((U(0) - (u >> (sizeof(U) * 8 - 1))) & Magnitude);
+    }
+    static F from(type u)
+    {
+        u ^= (U(0) - (u >> (sizeof(U) * 8 - 1))) & Magnitude;
+        F s;
+        std::memcpy(&s, &u, sizeof(s));
+        return s;
+    }
+};
+
+template<>
+struct PcmOrdered<float> : PcmOrderedFloat<float, uint32_t>
+{
+};
+
+template<>
+struct PcmOrdered<double> : PcmOrderedFloat<double, uint64_t>
+{
+};
+
+
+// maps signed differences to unsigned ones, such that small magnitudes result in small values: 0, -1, 1, -2, 2, ...
+template<typename U>
+static inline U ZigZag(U d)
+{
+    return static_cast<U>(static_cast<U>(d << 1) ^ static_cast<U>(U(0) - U(d >> (sizeof(U) * 8 - 1))));
+}
+
+template<typename U>
+static inline U UnZigZag(U z)
+{
+    return static_cast<U>(static_cast<U>(z >> 1) ^ static_cast<U>(U(0) - U(z & 1)));
+}
+
+// shifts the two's complement @p d to the right, keeping its sign
+template<typename U>
+static inline U ShiftRight(U d, unsigned shift)
+{
+    constexpr unsigned Bits = sizeof(U) * 8;
+    const U sign = static_cast<U>(U(0) - U(d >> (Bits - 1)));
+    // shifting in two steps, because shifting by Bits is undefined
+    return static_cast<U>(U(d >> shift) | U(U(sign << (Bits - 1 - shift)) << 1));
+}
+
+// writes @p width (at most 32) bits of @p value, least significant bit first
+static inline void PutBits(uint8_t *&p, uint64_t &acc, unsigned &bits, uint64_t value, unsigned width)
+{
+    acc |= value << bits;
+    bits += width;
+    while (bits >= 8)
+    {
+        *p++ = static_cast<uint8_t>(acc);
+        acc >>= 8;
+        bits -= 8;
+    }
+}
+
+// reads @p width (at most 32) bits
+static inline uint64_t GetBits(const uint8_t *&p, uint64_t &acc, unsigned &bits, unsigned width)
+{
+    while (bits < width)
+    {
+        acc |= static_cast<uint64_t>(*p++) << bits;
+        bits += 8;
+    }
+    const uint64_t value = acc & ((uint64_t(1) << width) - 1);
+    acc >>= width;
+    bits -= width;
+    return value;
+}
+
+template<typename T>
+void PcmEncodeBlock(const T *in, uint32_t channels, frame_t frames, std::vector<uint8_t> &out)
+{
+    using U = typename PcmOrdered<T>::type;
+    constexpr unsigned Bits = sizeof(U) * 8;
+
+    if (frames <= 0)
+    {
+        return;
+    }
+
+    std::vector<U> deltas(frames);
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        const U first = PcmOrdered<T>::to(in[c]);
+        U prev = first;
+        U all = 0;
+        for (frame_t f = 1; f < frames; f++)
+        {
+            const U cur = PcmOrdered<T>::to(in[f * channels + c]);
+            deltas[f] = static_cast<U>(cur - prev);
+            all |= deltas[f];
+            prev = cur;
+        }
+
+        // the least significant bits may be zero in all samples, e.g. when the decoder has less precision than the sample format
+        unsigned shift = 0;
+        while (shift < Bits - 1 && all != 0 && ((all >> shift) & 1) == 0)
+        {
+            shift++;
+        }
+
+        all = 0;
+        for (frame_t f = 1; f < frames; f++)
+        {
+            deltas[f] = ZigZag<U>(ShiftRight<U>(deltas[f], shift));
+            all |= deltas[f];
+        }
+
+        unsigned width = 0;
+        while (width < Bits && (all >> width) != 0)
+        {
+            width++;
+        }
+
+        const size_t pos = out.size();
+        out.resize(pos + 2 + sizeof(U) + (static_cast<size_t>(frames - 1) * width + 7) / 8);
+        uint8_t *p = out.data() + pos;
+
+        *p++ = static_cast<uint8_t>(width);
+        *p++ = static_cast<uint8_t>(shift);
+        std::memcpy(p, &first, sizeof(U));
+        p += sizeof(U);
+
+        if (width == 0)
+        {
+            // constant signal, e.g. silence
+            continue;
+        }
+
+        uint64_t acc = 0;
+        unsigned bits = 0;
+        for (frame_t f = 1; f < frames; f++)
+        {
+            if (width > 32)
+            {
+                PutBits(p, acc, bits, static_cast<uint64_t>(deltas[f]) & 0xFFFFFFFF, 32);
+                PutBits(p, acc, bits, static_cast<uint64_t>(deltas[f]) >> 32, width - 32);
+            }
+            else
+            {
+                PutBits(p, acc, bits, deltas[f], width);
+            }
+        }
+        if (bits > 0)
+        {
+            *p++ = static_cast<uint8_t>(acc);
+        }
+    }
+}
+
+template<typename T>
+size_t PcmDecodeBlock(const uint8_t *in, uint32_t channels, frame_t frames, T *out) noexcept
+{
+    using U = typename PcmOrdered<T>::type;
+
+    const uint8_t *p = in;
+    if (frames <= 0)
+    {
+        return 0;
+    }
+
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        const unsigned width = *p++;
+        const unsigned shift = *p++;
+        U prev;
+        std::memcpy(&prev, p, sizeof(U));
+        p += sizeof(U);
+
+        T *o = out + c;
+        *o = PcmOrdered<T>::from(prev);
+        o += channels;
+
+        if (width == 0)
+        {
+            const T s = PcmOrdered<T>::from(prev);
+            for (frame_t f = 1; f < frames; f++, o += channels)
+            {
+                *o = s;
+            }
+            continue;
+        }
+
+        uint64_t acc = 0;
+        unsigned bits = 0;
+        for (frame_t f = 1; f < frames; f++, o += channels)
+        {
+            uint64_t z;
+            if (width > 32)
+            {
+                z = GetBits(p, acc, bits, 32);
+                z |= GetBits(p, acc, bits, width - 32) << 32;
+            }
+            else
+            {
+                z = GetBits(p, acc, bits, width);
+            }
+            prev = static_cast<U>(prev + static_cast<U>(UnZigZag<U>(static_cast<U>(z)) << shift));
+            *o = PcmOrdered<T>::from(prev);
+        }
+        // the remaining bits of the last byte are padding
+    }
+
+    return static_cast<size_t>(p - in);
+}
+
+
+#define PCMCODEC_INSTANTIATE(T)                                                                          \
+    template void PcmEncodeBlock<T>(const T *in, uint32_t channels, frame_t frames, std::vector<uint8_t> &out); \
+    template size_t PcmDecodeBlock<T>(const uint8_t *in, uint32_t channels, frame_t frames, T *out) noexcept;
+
+PCMCODEC_INSTANTIATE(uint8_t)
+PCMCODEC_INSTANTIATE(int16_t)
+PCMCODEC_INSTANTIATE(int32_t)
+PCMCODEC_INSTANTIATE(float)
+PCMCODEC_INSTANTIATE(double)
+PCMCODEC_INSTANTIATE(sndfile_sample_t)
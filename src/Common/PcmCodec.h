@@ -0,0 +1,36 @@
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+  * a fast lossless codec for interleaved PCM, used to keep the whole song in memory at a fraction of its size
+  *
+  * PCM is split into blocks of PcmBlockFrames frames, that are encoded independently of each other, so that any
+  * block can be decoded without touching the ones before. within a block each channel is stored as its first
+  * sample followed by the differences of consecutive samples, bit-packed with the width of the biggest difference
+  * (after stripping the least significant bits, that are zero in all of them).
+  *
+  * floating point samples are mapped to integers of the same order before, so that small changes of the signal
+  * still result in small differences. the codec is lossless for every sample format, incl. NaNs and denormals.
+  */
+
+// number of frames per block
+constexpr frame_t PcmBlockFrames = 4096;
+
+/**
+ * encodes @p frames frames (at most PcmBlockFrames) of @p channels interleaved items and appends them to @p out
+ */
+template<typename T>
+void PcmEncodeBlock(const T *in, uint32_t channels, frame_t frames, std::vector<uint8_t> &out);
+
+/**
+ * decodes a block previously encoded by PcmEncodeBlock() with the same @p channels and @p frames to @p out
+ *
+ * @return the number of bytes of @p in consumed
+ */
+template<typename T>
+size_t PcmDecodeBlock(const uint8_t *in, uint32_t channels, frame_t frames, T *out) noexcept;
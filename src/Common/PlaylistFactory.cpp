@@ -309,7 +309,8 @@ bool PlaylistFactory::addSong(std::vector<Song*> &playlist, const std::string& f
 
 #ifdef USE_LIBSND
         // most common file types (WAVE, FLAC, Sun / NeXT AU, OGG VORBIS, AIFF, etc.)
-        PlaylistFactory::tryWith<LibSNDWrapper>(pcm, filePath, offset, len);
+        // files of at most 16 bits are stored as int16, which takes half the memory
+        PlaylistFactory::tryWith(pcm, filePath, [&]() { return OpenLibSNDWrapper(filePath, offset, len); });
 #endif
 
 #ifdef USE_LIBGME
@@ -336,7 +337,8 @@ bool PlaylistFactory::addSong(std::vector<Song*> &playlist, const std::string& f
 
 #ifdef USE_FFMPEG
         // OPUS, videofiles, etc.
-        PlaylistFactory::tryWith<FFMpegWrapper>(pcm, filePath, offset, len);
+        // stored in the sample format the codec decodes to, int16 for anything else
+        PlaylistFactory::tryWith(pcm, filePath, [&]() { return OpenFFMpegWrapper(filePath, offset, len); });
 #endif
 
 // !!! libmad always has to be last !!!
@@ -404,12 +406,17 @@ bool PlaylistFactory::addSong(std::vector<Song*> &playlist, const std::string& f
 
 template<typename T>
 void PlaylistFactory::tryWith(Song *(&pcm), const std::string &filePath, Nullable<size_t> offset, Nullable<size_t> len)
+{
+    PlaylistFactory::tryWith(pcm, filePath, [&]() -> Song * { return new T(filePath, offset, len); });
+}
+
+void PlaylistFactory::tryWith(Song *(&pcm), const std::string &filePath, const std::function<Song *()> &create)
 {
     if (pcm == nullptr)
     {
         try
         {
-            pcm = new T(filePath, offset, len);
+            pcm = create();
             pcm->open();
 
             if (pcm->getFrames() <= 0)
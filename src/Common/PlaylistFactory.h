@@ -3,6 +3,7 @@
 
 #include "Nullable.h"
 #include "SongInfo.h"
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -50,6 +51,9 @@ private:
 
     template<typename T>
     static void tryWith(Song *(&pcm), const std::string &filePath, Nullable<size_t> offset, Nullable<size_t> len);
+
+    // like tryWith<T>(), for wrappers that have to look into the file to find out which class to instantiate
+    static void tryWith(Song *(&pcm), const std::string &filePath, const std::function<Song *()> &create);
 };
 
 
@@ -0,0 +1,287 @@
+#include "RenderPolicy.h"
+
+#include "AtomicWrite.h"
+#include "Config.h"
+#include "PcmBudget.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+// below that, the system is about to run out of memory, regardless of what PSI says
+static constexpr size_t MinAvailable = 64 * 1024 * 1024;
+
+RenderPolicy::RenderPolicy(std::string root)
+: root(std::move(root))
+{
+    this->stats.someAvg10 = -1;
+    this->stats.fullAvg10 = -1;
+    this->stats.available = SIZE_MAX;
+}
+
+RenderPolicy &RenderPolicy::Singleton()
+{
+    // guaranteed to be destroyed
+    static RenderPolicy instance("");
+
+    return instance;
+}
+
+const char *RenderPolicy::ToString(Mode mode) noexcept
+{
+    switch (mode)
+    {
+        case Mode::WholeSong:
+            return "whole song";
+        case Mode::LoopRegions:
+            return "streamed, loops in memory";
+        case Mode::Streaming:
+            return "streamed";
+    }
+    return "";
+}
+
+const char *RenderPolicy::ToString(Pressure pressure) noexcept
+{
+    switch (pressure)
+    {
+        case Pressure::None:
+            return "none";
+        case Pressure::Some:
+            return "some";
+        case Pressure::High:
+            return "high";
+    }
+    return "";
+}
+
+// reads a single number from @p file, returns false if it doesnt hold one (e.g. "max")
+static bool readNumber(const std::string &file, uint64_t &value) noexcept
+{
+    std::ifstream in(file);
+    std::string word;
+    if (!(in >> word) || word.empty() || !std::all_of(word.begin(), word.end(), [](char c) { return c >= '0' && c <= '9'; }))
+    {
+        return false;
+    }
+
+    try
+    {
+        value = std::stoull(word);
+    }
+    catch (const std::exception &e)
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @return the bytes that may be allocated, until the memory limit of the cgroup ANMP runs in (or any of its parents) is hit
+ */
+size_t RenderPolicy::readCgroupHeadroom() const noexcept
+{
+    size_t headroom = SIZE_MAX;
+
+    std::ifstream in(this->root + "/proc/self/cgroup");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // hierarchy-ID:controller-list:cgroup-path
+        const size_t first = line.find(':');
+        const size_t second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos)
+        {
+            continue;
+        }
+        const std::string id = line.substr(0, first);
+        const std::string controllers = line.substr(first + 1, second - first - 1);
+        std::string path = line.substr(second + 1);
+
+        std::string base, limitFile, usageFile;
+        if (id == "0" && controllers.empty())
+        {
+            base = this->root + "/sys/fs/cgroup";
+            limitFile = "/memory.max";
+            usageFile = "/memory.current";
+        }
+        else if (("," + controllers + ",").find(",memory,") != std::string::npos)
+        {
+            base = this->root + "/sys/fs/cgroup/memory";
+            limitFile = "/memory.limit_in_bytes";
+            usageFile = "/memory.usage_in_bytes";
+        }
+        else
+        {
+            continue;
+        }
+
+        // the limit of any parent applies as well
+        while (!path.empty())
+        {
+            const std::string dir = base + (path == "/" ? "" : path);
+            uint64_t limit, usage;
+            if (readNumber(dir + limitFile, limit) && readNumber(dir + usageFile, usage))
+            {
+                headroom = std::min<size_t>(headroom, limit > usage ? limit - usage : 0);
+            }
+
+            if (path == "/")
+            {
+                break;
+            }
+            const size_t slash = path.rfind('/');
+            path = (slash == 0 || slash == std::string::npos) ? "/" : path.substr(0, slash);
+        }
+    }
+
+    return headroom;
+}
+
+void RenderPolicy::read() noexcept
+{
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    this->stats.someAvg10 = this->stats.fullAvg10 = -1;
+    std::ifstream psi(this->root + "/proc/pressure/memory");
+    std::string line;
+    while (std::getline(psi, line))
+    {
+        std::istringstream ss(line);
+        std::string kind, field;
+        ss >> kind;
+        while (ss >> field)
+        {
+            if (field.compare(0, 6, "avg10=") == 0)
+            {
+                const double avg10 = std::strtod(field.c_str() + 6, nullptr);
+                (kind == "full" ? this->stats.fullAvg10 : this->stats.someAvg10) = avg10;
+            }
+        }
+    }
+
+    // MemAvailable:    1234567 kB
+    size_t available = SIZE_MAX;
+    std::ifstream meminfo(this->root + "/proc/meminfo");
+    while (std::getline(meminfo, line))
+    {
+        if (line.compare(0, 13, "MemAvailable:") == 0)
+        {
+            available = static_cast<size_t>(std::strtoull(line.c_str() + 13, nullptr, 10)) * 1024;
+            break;
+        }
+    }
+    this->stats.available = std::min(available, this->readCgroupHeadroom());
+
+    const double threshold = gConfig.MemoryPressureThreshold;
+    if (this->stats.someAvg10 >= threshold || this->stats.fullAvg10 >= threshold / 10 || this->stats.available < MinAvailable)
+    {
+        this->stats.pressure = Pressure::High;
+    }
+    else if (this->stats.someAvg10 >= threshold / 10)
+    {
+        this->stats.pressure = Pressure::Some;
+    }
+    else
+    {
+        this->stats.pressure = Pressure::None;
+    }
+}
+
+RenderPolicy::Pressure RenderPolicy::poll() noexcept
+{
+    if (!gConfig.useMemoryPressure)
+    {
+        return Pressure::None;
+    }
+
+    std::unique_lock<std::mutex> lck(this->mtx);
+
+    const auto now = std::chrono::steady_clock::now();
+    if (this->haveRead && now - this->lastRead < std::chrono::seconds(1))
+    {
+        return this->stats.pressure;
+    }
+
+    const Pressure before = this->stats.pressure;
+    const bool hadRead = this->haveRead;
+    this->read();
+    this->lastRead = now;
+    this->haveRead = true;
+
+    const Pressure pressure = this->stats.pressure;
+    this->current = pressure;
+    if (hadRead && pressure != before)
+    {
+        CLOG(LogLevel_t::Info, "memory pressure " << ToString(pressure) << " (some avg10 " << this->stats.someAvg10 << " %, full avg10 " << this->stats.fullAvg10 << " %, " << this->stats.available / (1024 * 1024) << " MiB available)");
+    }
+
+    if (hadRead && pressure > before)
+    {
+        this->stats.downgrades++;
+        lck.unlock();
+
+        // songs not being played are the first ones to go
+        const size_t evicted = PcmBudget::Singleton().evictRetained();
+        if (evicted != 0)
+        {
+            CLOG(LogLevel_t::Info, "released the PCM of " << evicted << " recently played songs due to memory pressure");
+        }
+    }
+
+    return pressure;
+}
+
+RenderPolicy::Pressure RenderPolicy::pressure() const noexcept
+{
+    if (!gConfig.useMemoryPressure)
+    {
+        return Pressure::None;
+    }
+
+    return this->current;
+}
+
+RenderPolicy::Mode RenderPolicy::decide(size_t songBytes, size_t loopBytes) noexcept
+{
+    if (!gConfig.useMemoryPressure)
+    {
+        return Mode::WholeSong;
+    }
+
+    const Pressure pressure = this->poll();
+
+    std::lock_guard<std::mutex> lck(this->mtx);
+
+    // dont use more than a fraction of what is left, there are other songs and applications as well
+    const size_t available = this->stats.available;
+    const size_t affordable = (pressure == Pressure::None) ? available / 2 : available / 8;
+
+    Mode mode;
+    if (pressure == Pressure::High)
+    {
+        mode = Mode::Streaming;
+    }
+    else if (songBytes <= affordable)
+    {
+        mode = Mode::WholeSong;
+    }
+    else if (loopBytes <= affordable)
+    {
+        mode = Mode::LoopRegions;
+    }
+    else
+    {
+        mode = Mode::Streaming;
+    }
+
+    this->stats.decisions[static_cast<int>(mode)]++;
+    return mode;
+}
+
+RenderPolicy::Stats RenderPolicy::getStats() const noexcept
+{
+    std::lock_guard<std::mutex> lck(this->mtx);
+    return this->stats;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+  * class RenderPolicy
+  *
+  * decides how much of a song's PCM is held in memory, depending on how much memory is left on the system
+  *
+  * allocating a buffer for the whole song rarely fails, long before that the system starts swapping. thus the policy looks at
+  * the memory pressure reported by Linux' PSI (/proc/pressure/memory), the memory available (/proc/meminfo) and the limits
+  * of the cgroup ANMP runs in. under pressure, songs are streamed through a ring buffer (possibly keeping their loops in
+  * memory) and songs retained by the PcmBudget are released.
+  *
+  * all methods are thread-safe. reading the files is left to the notification thread of the Player, the playback thread only
+  * looks at what has been read by then through pressure()
+  */
+
+class RenderPolicy
+{
+    public:
+    enum class Mode : uint8_t
+    {
+        // the whole song is held in memory
+        WholeSong,
+        // the song is streamed through a ring buffer, only its loops are held in memory
+        LoopRegions,
+        // the song is streamed through a ring buffer
+        Streaming
+    };
+
+    enum class Pressure : uint8_t
+    {
+        None,
+        // some tasks are stalled on memory now and then
+        Some,
+        // the system is thrashing
+        High
+    };
+
+    struct Stats
+    {
+        Pressure pressure;
+
+        // share of time in % some resp. all tasks were stalled on memory within the last 10 seconds, negative if unknown
+        double someAvg10;
+        double fullAvg10;
+
+        // bytes that may be allocated without causing pressure, SIZE_MAX if unknown
+        size_t available;
+
+        // number of songs rendered in each mode
+        uint64_t decisions[3];
+
+        // number of times the pressure rose, causing retained songs to be released
+        uint64_t downgrades;
+    };
+
+    /**
+     * @param root prefixed to all paths being read, allows testing with fake /proc and /sys
+     */
+    RenderPolicy(std::string root);
+
+    // no copy
+    RenderPolicy(const RenderPolicy &) = delete;
+    // no assign
+    RenderPolicy &operator=(const RenderPolicy &) = delete;
+
+    // returns the policy of the system ANMP runs on
+    static RenderPolicy &Singleton();
+
+    static const char *ToString(Mode mode) noexcept;
+    static const char *ToString(Pressure pressure) noexcept;
+
+    /**
+     * @param songBytes size of the PCM of the whole song
+     * @param loopBytes size of the PCM of the song's loops, that would be held in memory if streamed
+     *
+     * @return how to render the song
+     */
+    Mode decide(size_t songBytes, size_t loopBytes) noexcept;
+
+    /**
+     * reads the memory pressure again, if it hasnt been read within the last second. if the pressure rose, all songs
+     * retained by the PcmBudget are released
+     *
+     * @return the current memory pressure
+     */
+    Pressure poll() noexcept;
+
+    /**
+     * @return the memory pressure as of the last call to poll(), without reading it again nor locking, thus safe to be
+     * called from the playback thread
+     */
+    Pressure pressure() const noexcept;
+
+    Stats getStats() const noexcept;
+
+    private:
+    const std::string root;
+
+    Stats stats{};
+    // this->stats.pressure, for pressure()
+    std::atomic<Pressure> current{Pressure::None};
+    std::chrono::steady_clock::time_point lastRead;
+    bool haveRead = false;
+
+    mutable std::mutex mtx;
+
+    void read() noexcept;
+    size_t readCgroupHeadroom() const noexcept;
+};
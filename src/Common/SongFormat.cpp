@@ -65,9 +65,18 @@ void SongFormat::ConfigureVoices(const uint16_t nChannels, const uint16_t defaul
  */
 int SongFormat::getBitrate() const
 {
-    int rate = this->SampleRate * this->Channels();
+    const uint32_t frameSize = this->getFrameSize();
+    if (frameSize == 0)
+    {
+        return -1;
+    }
 
-    int width;
+    return this->SampleRate * frameSize;
+}
+
+uint32_t SongFormat::getFrameSize() const noexcept
+{
+    uint32_t width;
     switch (this->SampleFormat)
     {
         case SampleFormat_t::int16:
@@ -85,10 +94,10 @@ int SongFormat::getBitrate() const
             width = 8 / 8;
             break;
         default:
-            return -1;
+            return 0;
     }
 
-    return rate * width;
+    return this->Channels() * width;
 }
 
 bool SongFormat::IsValid() const
@@ -41,6 +41,11 @@ struct SongFormat
      */
     int getBitrate() const;
 
+    /**
+     * returns the number of bytes a single frame occupies, or zero if the sample format is unknown
+     */
+    uint32_t getFrameSize() const noexcept;
+
     /**
      * whether this instance holds valid data
      */
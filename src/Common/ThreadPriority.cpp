@@ -36,6 +36,13 @@ ThreadPriority::ThreadPriority(Priority p) : d(std::make_unique<Impl>())
                 }
             }
             break;
+        case Priority::Low:
+            newSch.sched_priority = 0;
+            if (pthread_setschedparam(pthread_self(), SCHED_BATCH | SCHED_RESET_ON_FORK, &newSch))
+            {
+                CLOG(LogLevel_t::Info, "Failed to setschedparam SCHED_BATCH: " << std::strerror(errno));
+            }
+            break;
         default:
             break;
     }
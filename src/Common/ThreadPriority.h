@@ -9,7 +9,9 @@
 
 enum class Priority
 {
-    High
+    High,
+    Normal, // leave the priority as inherited
+    Low
 };
 
 class ThreadPriority
@@ -4,10 +4,12 @@
 #include "Common.h"
 #include "CommonExceptions.h"
 #include "Config.h"
+#include "PcmCache.h"
 
 #include <psf2fs.h>
 #include <psflib.h>
 
+#include <algorithm>
 #include <cstring> // memset
 
 using namespace std;
@@ -56,8 +58,13 @@ void AopsfWrapper::open()
         return;
     }
 
+    // let stdio_fopen() know about us, so that it records which files are loaded
+    this->loadedFiles.clear();
+    psf_file_callbacks callbacks = stdio_callbacks;
+    callbacks.context = this;
+
     this->psfVersion = psf_load(this->Filename.c_str(),
-                                &stdio_callbacks,
+                                &callbacks,
                                 0, // psf files might have version 1 or 2, we dont know, so probe for version with 0
                                 nullptr,
                                 nullptr,
@@ -92,7 +99,7 @@ void AopsfWrapper::open()
         // we ask psflib to load that file using OUR loader method
 
         int ret = psf_load(this->Filename.c_str(),
-                           &stdio_callbacks,
+                           &callbacks,
                            this->psfVersion,
                            &AopsfWrapper::psf_loader, // callback function to call on loading this psf file
                            this, // context, i.e. pointer to the struct we place the psf file in
@@ -122,7 +129,7 @@ void AopsfWrapper::open()
         }
 
         int ret = psf_load(this->Filename.c_str(),
-                           &stdio_callbacks,
+                           &callbacks,
                            this->psfVersion,
                            ::psf2fs_load_callback, // callback function provided by psf2fs
                            this->psf2fs, // context
@@ -203,6 +210,28 @@ frame_t AopsfWrapper::getFrames() const
     }
 }
 
+std::string AopsfWrapper::getCacheParams() const
+{
+    if (!gConfig.PcmCachePsf)
+    {
+        return "";
+    }
+
+    // besides the settings, the PCM depends on any lib the file refers to
+    std::string params = "psf";
+    for (const std::string &file : this->loadedFiles)
+    {
+        const std::string hash = PcmCache::hashFile(file);
+        if (hash.empty())
+        {
+            return "";
+        }
+        params += '|' + hash;
+    }
+
+    return params;
+}
+
 void AopsfWrapper::buildMetadata() noexcept
 {
     // noting to do here, everything is done in psf_info()
@@ -212,6 +241,12 @@ void AopsfWrapper::buildMetadata() noexcept
 
 void *AopsfWrapper::stdio_fopen(void *ctx, const char *path)
 {
+    AopsfWrapper *pthis = static_cast<AopsfWrapper *>(ctx);
+    if (pthis != nullptr && std::find(pthis->loadedFiles.begin(), pthis->loadedFiles.end(), path) == pthis->loadedFiles.end())
+    {
+        pthis->loadedFiles.emplace_back(path);
+    }
+
     return fopen(path, "rb");
 }
 
@@ -35,7 +35,13 @@ class AopsfWrapper : public StandardWrapper<int16_t>
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
 
+    protected:
+    std::string getCacheParams() const override;
+
     private:
+    // all files loaded by psflib, i.e. the file itself and its libs
+    std::vector<std::string> loadedFiles;
+
     int psfVersion = 0;
 
     // length in ms to fade
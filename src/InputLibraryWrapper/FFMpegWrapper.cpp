@@ -4,7 +4,10 @@
 #include "Common.h"
 #include "CommonExceptions.h"
 #include "Config.h"
+#include "MixKernels.h"
+#include "ThreadPriority.h"
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
 
@@ -15,33 +18,41 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
-FFMpegWrapper::FFMpegWrapper(std::string filename)
-: StandardWrapper(std::move(filename))
-{
-    this->Format.SampleFormat = SampleFormat_t::int16;
-}
+// the sample formats of ffmpeg, that are stored as SAMPLEFORMAT without conversion, interleaved resp. planar
+template<typename SAMPLEFORMAT>
+struct AVTarget;
 
-FFMpegWrapper::FFMpegWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len)
-: StandardWrapper(std::move(filename), offset, len)
+template<>
+struct AVTarget<int16_t>
 {
-    this->Format.SampleFormat = SampleFormat_t::int16;
-}
+    static constexpr AVSampleFormat Packed = AV_SAMPLE_FMT_S16;
+    static constexpr AVSampleFormat Planar = AV_SAMPLE_FMT_S16P;
+    static constexpr SampleFormat_t Format = SampleFormat_t::int16;
+};
 
-FFMpegWrapper::~FFMpegWrapper()
+template<>
+struct AVTarget<int32_t>
 {
-    this->releaseBuffer();
-    this->close();
-}
+    static constexpr AVSampleFormat Packed = AV_SAMPLE_FMT_S32;
+    static constexpr AVSampleFormat Planar = AV_SAMPLE_FMT_S32P;
+    static constexpr SampleFormat_t Format = SampleFormat_t::int32;
+};
 
-
-void FFMpegWrapper::open()
+template<>
+struct AVTarget<float>
+{
+    static constexpr AVSampleFormat Packed = AV_SAMPLE_FMT_FLT;
+    static constexpr AVSampleFormat Planar = AV_SAMPLE_FMT_FLTP;
+    static constexpr SampleFormat_t Format = SampleFormat_t::float32;
+};
+
+/**
+ * Opens @p filename and gathers the information about its streams.
+ *
+ * @return the context, to be closed by avformat_close_input()
+ */
+static AVFormatContext *OpenInput(const std::string &filename)
 {
-    // avoid multiple calls to open()
-    if (this->handle != nullptr)
-    {
-        return;
-    }
-
     // This registers all available file formats and codecs with the
     // library so they will be used automatically when a file with the
     // corresponding format/codec is opened. Note that you only need to
@@ -54,14 +65,99 @@ void FFMpegWrapper::open()
     // The last three parameters specify the file format, buffer size and
     // format parameters. By simply specifying nullptr or 0 we ask libavformat
     // to auto-detect the format and use a default buffer size.
-    if (avformat_open_input(&this->handle, this->Filename.c_str(), nullptr, nullptr) != 0)
+    AVFormatContext *handle = nullptr;
+    if (avformat_open_input(&handle, filename.c_str(), nullptr, nullptr) != 0)
+    {
+        THROW_RUNTIME_ERROR("Failed to open file " << filename);
+    }
+
+    if (avformat_find_stream_info(handle, nullptr) < 0)
+    {
+        avformat_close_input(&handle);
+        THROW_RUNTIME_ERROR("Faild to gather stream info(s) from file " << filename);
+    }
+
+    return handle;
+}
+
+Song *OpenFFMpegWrapper(const std::string &filename, Nullable<size_t> offset, Nullable<size_t> len)
+{
+    AVFormatContext *handle = OpenInput(filename);
+
+    // the wrapper takes over the context, so the file is opened only once
+    Song *song = nullptr;
+    try
+    {
+        const int stream = av_find_best_stream(handle, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+        const AVSampleFormat format = stream < 0 ? AV_SAMPLE_FMT_NONE : static_cast<AVSampleFormat>(handle->streams[stream]->codecpar->format);
+        switch (av_get_packed_sample_fmt(format))
+        {
+            case AV_SAMPLE_FMT_S32:
+                [[fallthrough]];
+            case AV_SAMPLE_FMT_S64:
+                song = new FFMpegWrapper<int32_t>(filename, offset, len, handle);
+                break;
+            case AV_SAMPLE_FMT_FLT:
+                [[fallthrough]];
+            case AV_SAMPLE_FMT_DBL:
+                song = new FFMpegWrapper<float>(filename, offset, len, handle);
+                break;
+            default:
+                // u8, s16 or unknown
+                song = new FFMpegWrapper<int16_t>(filename, offset, len, handle);
+                break;
+        }
+    }
+    catch (const std::bad_alloc &e)
+    {
+        avformat_close_input(&handle);
+        throw;
+    }
+
+    return song;
+}
+
+template<typename SAMPLEFORMAT>
+FFMpegWrapper<SAMPLEFORMAT>::FFMpegWrapper(std::string filename)
+: StandardWrapper<SAMPLEFORMAT>(std::move(filename))
+{
+    this->Format.SampleFormat = AVTarget<SAMPLEFORMAT>::Format;
+}
+
+template<typename SAMPLEFORMAT>
+FFMpegWrapper<SAMPLEFORMAT>::FFMpegWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len)
+: StandardWrapper<SAMPLEFORMAT>(std::move(filename), offset, len)
+{
+    this->Format.SampleFormat = AVTarget<SAMPLEFORMAT>::Format;
+}
+
+template<typename SAMPLEFORMAT>
+FFMpegWrapper<SAMPLEFORMAT>::FFMpegWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len, AVFormatContext *handle)
+: FFMpegWrapper(std::move(filename), offset, len)
+{
+    this->handle = handle;
+}
+
+template<typename SAMPLEFORMAT>
+FFMpegWrapper<SAMPLEFORMAT>::~FFMpegWrapper()
+{
+    this->releaseBuffer();
+    this->close();
+}
+
+
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::open()
+{
+    // avoid multiple calls to open()
+    if (this->codecCtx != nullptr)
     {
-        THROW_RUNTIME_ERROR("Failed to open file " << this->Filename);
+        return;
     }
 
-    if (avformat_find_stream_info(this->handle, nullptr) < 0)
+    if (this->handle == nullptr)
     {
-        THROW_RUNTIME_ERROR("Faild to gather stream info(s) from file " << this->Filename);
+        this->handle = OpenInput(this->Filename);
     }
 
     // The file may contain more than on stream. Each stream can be a
@@ -111,6 +207,10 @@ void FFMpegWrapper::open()
     av_codec_set_pkt_timebase(this->codecCtx, audioStream->time_base);
 #endif
 
+    // let the codec decode frames or slices in parallel, if it supports that
+    this->codecCtx->thread_count = gConfig.FFMpegDecoderThreads;
+    this->codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     // Open the codec found suitable for this stream in the last step
     if (avcodec_open2(this->codecCtx, decoder, nullptr) < 0)
     {
@@ -148,26 +248,15 @@ void FFMpegWrapper::open()
         THROW_RUNTIME_ERROR("FFMpeg doesnt specify duration for this file."); // either this, or there is some other weird way of getting the duration, which is not implemented
     }
 
+    // in case the frames need to be converted by swr
     if (pCodecPar->channel_layout == 0)
     {
         pCodecPar->channel_layout = av_get_default_channel_layout(pCodecPar->channels);
     }
 
-    // Set up SWR context once you've got codec information
-    if ((this->swr = swr_alloc()) == nullptr)
-    {
-        THROW_RUNTIME_ERROR("Cannot alloc swr.");
-    }
-    av_opt_set_int(this->swr, "in_channel_layout", pCodecPar->channel_layout, 0);
-    av_opt_set_int(this->swr, "out_channel_layout", pCodecPar->channel_layout, 0);
-    av_opt_set_int(this->swr, "in_sample_rate", pCodecPar->sample_rate, 0);
-    av_opt_set_int(this->swr, "out_sample_rate", pCodecPar->sample_rate, 0);
-    av_opt_set_sample_fmt(this->swr, "in_sample_fmt", static_cast<AVSampleFormat>(pCodecPar->format), 0);
-    av_opt_set_sample_fmt(this->swr, "out_sample_fmt", AV_SAMPLE_FMT_S16, 0);
-
-    if ((swr_init(this->swr)) != 0)
+    if (av_get_packed_sample_fmt(this->codecCtx->sample_fmt) != av_get_packed_sample_fmt(AVTarget<SAMPLEFORMAT>::Packed))
     {
-        THROW_RUNTIME_ERROR("Cannot init swr.");
+        CLOG(LogLevel_t::Debug, "\"" << this->Filename << "\" is decoded to " << av_get_sample_fmt_name(this->codecCtx->sample_fmt) << ", converting to " << av_get_sample_fmt_name(AVTarget<SAMPLEFORMAT>::Packed));
     }
 
     /* initialize packet, set data to nullptr, let the demuxer fill it */
@@ -184,23 +273,121 @@ void FFMpegWrapper::open()
     }
 }
 
-void FFMpegWrapper::close() noexcept
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::close() noexcept
 {
+    this->joinDemuxer();
+
+    if (this->framesDecoded > 0 && this->codecCtx != nullptr)
+    {
+        std::chrono::duration<double> elapsed = this->decodeTime;
+        double duration = static_cast<double>(this->framesDecoded) / this->Format.SampleRate;
+        CLOG(LogLevel_t::Info, "decoded \"" << this->Filename << "\" at " << duration / elapsed.count() << "x realtime (" << this->codecCtx->thread_count << " decoder threads, " << gConfig.FFMpegReadAheadPackets << " packets read ahead)");
+    }
+    this->decodeTime = {};
+    this->framesDecoded = 0;
+
     if (this->swr != nullptr)
     {
         swr_free(&this->swr);
         this->swr = nullptr;
     }
 
+    this->swrFormat = -1;
+
     this->tmpSwrBuf.clear();
     this->tmpSwrBuf.shrink_to_fit();
+    this->swrBuf.clear();
+    this->swrBuf.shrink_to_fit();
     av_frame_free(&this->frame);
     av_packet_free(&this->packet);
     avcodec_free_context(&this->codecCtx);
     avformat_close_input(&this->handle);
 }
 
-int FFMpegWrapper::decode_packet(int16_t *(&pcm), int &framesToDo)
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::setupSwr(int inFormat)
+{
+    if (this->swr != nullptr && this->swrFormat == inFormat)
+    {
+        return;
+    }
+    swr_free(&this->swr);
+    this->swrFormat = -1;
+
+    const AVCodecParameters *pCodecPar = this->handle->streams[this->audioStreamID]->codecpar;
+
+    // Set up SWR context once you've got codec information
+    if ((this->swr = swr_alloc()) == nullptr)
+    {
+        THROW_RUNTIME_ERROR("Cannot alloc swr.");
+    }
+    av_opt_set_int(this->swr, "in_channel_layout", pCodecPar->channel_layout, 0);
+    av_opt_set_int(this->swr, "out_channel_layout", pCodecPar->channel_layout, 0);
+    av_opt_set_int(this->swr, "in_sample_rate", pCodecPar->sample_rate, 0);
+    av_opt_set_int(this->swr, "out_sample_rate", pCodecPar->sample_rate, 0);
+    av_opt_set_sample_fmt(this->swr, "in_sample_fmt", static_cast<AVSampleFormat>(inFormat), 0);
+    av_opt_set_sample_fmt(this->swr, "out_sample_fmt", AVTarget<SAMPLEFORMAT>::Packed, 0);
+
+    if ((swr_init(this->swr)) != 0)
+    {
+        THROW_RUNTIME_ERROR("Cannot init swr.");
+    }
+    this->swrFormat = inFormat;
+}
+
+/**
+ * writes the PCM of this->frame interleaved and in the sample format of the song: the first @p framesToSkip frames are dropped,
+ * the following @p framesToPcm frames go to @p pcm, all the rest to @p remainder
+ */
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::convertFrame(int framesToSkip, SAMPLEFORMAT *pcm, int framesToPcm, SAMPLEFORMAT *remainder)
+{
+    const int channels = this->frame->channels;
+    const int framesToRemainder = this->frame->nb_samples - framesToSkip - framesToPcm;
+    const int format = this->frame->format;
+
+    if (format == AVTarget<SAMPLEFORMAT>::Planar)
+    {
+        this->planes.resize(channels);
+        for (int c = 0; c < channels; c++)
+        {
+            this->planes[c] = reinterpret_cast<const SAMPLEFORMAT *>(this->frame->extended_data[c]) + framesToSkip;
+        }
+        MixInterleave(this->planes.data(), pcm, framesToPcm, channels);
+
+        for (int c = 0; c < channels; c++)
+        {
+            this->planes[c] += framesToPcm;
+        }
+        MixInterleave(this->planes.data(), remainder, framesToRemainder, channels);
+        return;
+    }
+
+    const SAMPLEFORMAT *interleaved;
+    if (format == AVTarget<SAMPLEFORMAT>::Packed)
+    {
+        // already what we need
+        interleaved = reinterpret_cast<const SAMPLEFORMAT *>(this->frame->extended_data[0]);
+    }
+    else
+    {
+        this->setupSwr(format);
+
+        this->swrBuf.resize(this->frame->nb_samples * channels);
+        SAMPLEFORMAT *outbuf = this->swrBuf.data();
+        swr_convert(this->swr, reinterpret_cast<uint8_t **>(&outbuf), this->frame->nb_samples, const_cast<const uint8_t **>(this->frame->extended_data), this->frame->nb_samples);
+        interleaved = outbuf;
+    }
+
+    interleaved += framesToSkip * channels;
+    std::memcpy(pcm, interleaved, framesToPcm * channels * sizeof(SAMPLEFORMAT));
+    interleaved += framesToPcm * channels;
+    std::memcpy(remainder, interleaved, framesToRemainder * channels * sizeof(SAMPLEFORMAT));
+}
+
+template<typename SAMPLEFORMAT>
+int FFMpegWrapper<SAMPLEFORMAT>::decode_packet(SAMPLEFORMAT *(&pcm), int &framesToDo)
 {
     char errstr[AV_ERROR_MAX_STRING_SIZE];
     int decoded = 0, ret;
@@ -259,42 +446,52 @@ int FFMpegWrapper::decode_packet(int16_t *(&pcm), int &framesToDo)
             //                 for (ch = 0; ch < this->handle->streams[this->audioStreamID]->codec->channels; ch++)
             //                     fwrite(frame->data[ch] + data_size*i, 1, data_size, outfile);
 
+            // number of frames at the beginning of this->frame to be dropped, because they are before the frame we seeked to
+            int framesToSkip = 0;
+            if (this->seekTarget >= 0)
+            {
+                const int64_t pts = this->frame->best_effort_timestamp;
+                if (pts == AV_NOPTS_VALUE)
+                {
+                    // cant tell where we are, live with the inaccuracy
+                    CLOG(LogLevel_t::Debug, "decoded frame has no timestamp, seeking might be inaccurate");
+                    this->seekTarget = -1;
+                }
+                else
+                {
+                    const AVStream *audioStream = this->handle->streams[this->audioStreamID];
+                    const int64_t startTime = audioStream->start_time != AV_NOPTS_VALUE ? audioStream->start_time : 0;
+                    const frame_t frameStart = av_rescale_q(pts - startTime, audioStream->time_base, AVRational{1, this->codecCtx->sample_rate});
+
+                    if (this->seekTarget >= frameStart + this->frame->nb_samples)
+                    {
+                        // this frame is entirely before the frame we seeked to
+                        continue;
+                    }
+
+                    framesToSkip = std::max<frame_t>(0, this->seekTarget - frameStart);
+                    this->seekTarget = -1;
+                }
+            }
+
             /* Some audio decoders decode only part of the packet, and have to be
              * called again with the remainder of the packet data.
              * Sample: fate-suite/lossless-audio/luckynight-partial.shn
              * Also, some decoders might over-read the packet. */
-            decoded += this->frame->nb_samples;
-
-            if (this->frame->nb_samples > framesToDo)
-            {
-                size_t oldNoOfItems = this->tmpSwrBuf.size();
-                // not enough space left in the master PCM buffer, render to tmp buffer
-                this->tmpSwrBuf.resize(oldNoOfItems + this->frame->nb_samples * this->frame->channels);
-
-                auto *inbuf = this->tmpSwrBuf.data() + oldNoOfItems;
-                swr_convert(this->swr, reinterpret_cast<uint8_t **>(&inbuf), this->frame->nb_samples, const_cast<const uint8_t **>(this->frame->extended_data), this->frame->nb_samples);
-
-                // and copy over frames, if there is any space left in the master PCM buffer
-                if (framesToDo > 0)
-                {
-                    frame_t itemsToCopy = framesToDo * this->frame->channels;
+            const int framesDecoded = this->frame->nb_samples - framesToSkip;
+            decoded += framesDecoded;
 
-                    std::memcpy(pcm, this->tmpSwrBuf.data(), itemsToCopy * sizeof(*pcm));
-                    this->tmpSwrBuf.erase(this->tmpSwrBuf.begin(), this->tmpSwrBuf.begin() + itemsToCopy);
+            // as many frames as there is space left for go straight to the master PCM buffer, the rest to the tmp buffer
+            const int framesToPcm = std::min(std::max(framesToDo, 0), framesDecoded);
+            const size_t oldNoOfItems = this->tmpSwrBuf.size();
+            this->tmpSwrBuf.resize(oldNoOfItems + (framesDecoded - framesToPcm) * this->frame->channels);
 
-                    pcm += itemsToCopy;
-                    this->framesAlreadyRendered += framesToDo;
-                }
-            }
-            else
-            {
-                swr_convert(this->swr, reinterpret_cast<uint8_t **>(&pcm), this->frame->nb_samples, const_cast<const uint8_t **>(this->frame->extended_data), this->frame->nb_samples);
+            this->convertFrame(framesToSkip, pcm, framesToPcm, this->tmpSwrBuf.data() + oldNoOfItems);
 
-                pcm += this->frame->nb_samples * this->frame->channels;
-                this->framesAlreadyRendered += this->frame->nb_samples;
-            }
+            pcm += framesToPcm * this->frame->channels;
+            this->framesAlreadyRendered += framesToPcm;
 
-            framesToDo -= this->frame->nb_samples; // could go negative here, i.e. no space left in master PCM buffer
+            framesToDo -= framesDecoded; // could go negative here, i.e. no space left in master PCM buffer
         }
     }
     else
@@ -305,12 +502,131 @@ int FFMpegWrapper::decode_packet(int16_t *(&pcm), int &framesToDo)
     return decoded;
 }
 
-void FFMpegWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender)
+/**
+ * reads packets of the audio stream to this->readAhead, until told to stop or the end of file or an I/O error is reached
+ */
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::demux() noexcept
 {
+    ThreadPriority tp(gConfig.DecoderThreadPriority);
+
+    AVPacket *packet = nullptr;
+    std::unique_lock<std::mutex> lck(this->demuxMtx);
+    while (true)
+    {
+        this->demuxCv.wait(lck, [this] { return this->stopDemuxer || this->readAhead.size() < this->readAheadLimit; });
+        if (this->stopDemuxer)
+        {
+            break;
+        }
+        lck.unlock();
+
+        int ret = AVERROR(ENOMEM);
+        bool finished = true;
+        if (packet != nullptr || (packet = av_packet_alloc()) != nullptr)
+        {
+            ret = av_read_frame(this->handle, packet);
+            finished = ret < 0 && (ret == AVERROR_EOF || avio_feof(this->handle->pb) || (this->handle->pb != nullptr && this->handle->pb->error));
+        }
+
+        lck.lock();
+        if (ret >= 0 && packet->stream_index == this->audioStreamID)
+        {
+            this->readAhead.push_back(packet);
+            packet = nullptr;
+        }
+        else if (finished)
+        {
+            this->demuxError = ret;
+            this->demuxCv.notify_all();
+            break;
+        }
+        else
+        {
+            // some other stream (or a legitimate error), dont care
+            av_packet_unref(packet);
+            continue;
+        }
+        this->demuxCv.notify_all();
+    }
+    lck.unlock();
+
+    av_packet_free(&packet);
+}
+
+/**
+ * stops this->demuxer (if running) and drops all packets read ahead, so that reading continues at the current
+ * position of this->handle
+ */
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::joinDemuxer() noexcept
+{
+    if (this->demuxer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lck(this->demuxMtx);
+            this->stopDemuxer = true;
+        }
+        this->demuxCv.notify_all();
+        this->demuxer.join();
+    }
+
+    for (AVPacket *p : this->readAhead)
+    {
+        av_packet_free(&p);
+    }
+    this->readAhead.clear();
+    this->demuxError = 0;
+    this->stopDemuxer = false;
+}
+
+/**
+ * reads the next packet to this->packet, taking it from the ones read ahead, if enabled
+ *
+ * @return what av_read_frame() returned for it
+ */
+template<typename SAMPLEFORMAT>
+int FFMpegWrapper<SAMPLEFORMAT>::readPacket()
+{
+    if (gConfig.FFMpegReadAheadPackets == 0 && !this->demuxer.joinable())
+    {
+        return av_read_frame(this->handle, this->packet);
+    }
+
+    if (!this->demuxer.joinable())
+    {
+        // gConfig.FFMpegReadAheadPackets may be changed by the user at any time, the demuxer sticks to the limit it has been started with
+        this->readAheadLimit = gConfig.FFMpegReadAheadPackets;
+        this->demuxer = std::thread(&FFMpegWrapper::demux, this);
+    }
+
+    std::unique_lock<std::mutex> lck(this->demuxMtx);
+    this->demuxCv.wait(lck, [this] { return !this->readAhead.empty() || this->demuxError != 0 || this->stopDemuxer; });
+    if (this->readAhead.empty())
+    {
+        // the demuxer has finished or is being stopped, no need to notify it
+        return this->demuxError != 0 ? this->demuxError : AVERROR_EXIT;
+    }
+
+    AVPacket *next = this->readAhead.front();
+    this->readAhead.pop_front();
+    lck.unlock();
+    this->demuxCv.notify_all();
+
+    av_packet_move_ref(this->packet, next);
+    av_packet_free(&next);
+    return 0;
+}
+
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const frame_t framesRenderedBefore = this->framesAlreadyRendered;
+
     int framesToDo = framesToRender = std::min(framesToRender, this->getFrames() - this->framesAlreadyRendered);
 
-    // int16 because we told swr to convert everything to int16
-    int16_t *pcm = static_cast<int16_t *>(bufferToFill);
+    SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(bufferToFill);
 
     // anything already cached in the temp buffer?
     frame_t itemsToCopy = std::min<frame_t>(this->tmpSwrBuf.size(), Channels * framesToDo);
@@ -328,10 +644,10 @@ void FFMpegWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
     bool finished = false;
     while (!this->stopFillBuffer &&
            framesToDo > 0 &&
-           pcm < static_cast<int16_t *>(bufferToFill) + this->count)
+           pcm < static_cast<SAMPLEFORMAT *>(bufferToFill) + this->count)
     {
         /* Read one audio frame from the input file into a temporary packet. */
-        int ret = av_read_frame(this->handle, this->packet);
+        int ret = this->readPacket();
         if (ret < 0)
         {
             if (ret == AVERROR_EOF || avio_feof(this->handle->pb))
@@ -363,17 +679,53 @@ void FFMpegWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
         av_packet_unref(this->packet);
     }
 
-    this->doAudioNormalization(static_cast<int16_t *>(bufferToFill), framesToRender);
+    this->doAudioNormalization(static_cast<SAMPLEFORMAT *>(bufferToFill), framesToRender);
+
+    this->decodeTime += std::chrono::steady_clock::now() - start;
+    this->framesDecoded += this->framesAlreadyRendered - framesRenderedBefore;
+}
+
+template<typename SAMPLEFORMAT>
+bool FFMpegWrapper<SAMPLEFORMAT>::isSeekable() const noexcept
+{
+    return this->handle != nullptr && this->handle->pb != nullptr && (this->handle->pb->seekable & AVIO_SEEKABLE_NORMAL);
 }
 
-frame_t FFMpegWrapper::getFrames() const
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::seekDecoder(frame_t frame)
+{
+    const AVStream *audioStream = this->handle->streams[this->audioStreamID];
+    const int64_t startTime = audioStream->start_time != AV_NOPTS_VALUE ? audioStream->start_time : 0;
+    const int64_t ts = startTime + av_rescale_q(frame, AVRational{1, this->codecCtx->sample_rate}, audioStream->time_base);
+
+    // the packets read ahead are of no use anymore
+    this->joinDemuxer();
+
+    // seek to the closest keyframe before the requested frame, we will decode up to it
+    int ret = av_seek_frame(this->handle, this->audioStreamID, ts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0)
+    {
+        char errstr[AV_ERROR_MAX_STRING_SIZE];
+        av_strerror(ret, errstr, sizeof(errstr));
+        THROW_RUNTIME_ERROR("av_seek_frame() failed for file \"" << this->Filename << "\": " << errstr);
+    }
+
+    // drop everything the decoder has buffered so far, this also resets it after it has been flushed at the end of file
+    avcodec_flush_buffers(this->codecCtx);
+    this->tmpSwrBuf.clear();
+    this->seekTarget = frame;
+}
+
+template<typename SAMPLEFORMAT>
+frame_t FFMpegWrapper<SAMPLEFORMAT>::getFrames() const
 {
     frame_t totalFrames = this->fileLen.hasValue ? msToFrames(this->fileLen.Value, this->Format.SampleRate) : 0;
 
     return totalFrames;
 }
 
-void FFMpegWrapper::buildMetadata() noexcept
+template<typename SAMPLEFORMAT>
+void FFMpegWrapper<SAMPLEFORMAT>::buildMetadata() noexcept
 {
     AVDictionaryEntry *tag = nullptr;
 
@@ -425,3 +777,7 @@ void FFMpegWrapper::buildMetadata() noexcept
         this->Metadata.Comment = tag->value;
     }
 }
+
+template class FFMpegWrapper<int16_t>;
+template class FFMpegWrapper<int32_t>;
+template class FFMpegWrapper<float>;
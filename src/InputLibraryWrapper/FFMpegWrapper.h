@@ -3,6 +3,12 @@
 
 #include "StandardWrapper.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 struct AVFormatContext;
 struct SwrContext;
 struct AVCodecContext;
@@ -10,7 +16,21 @@ struct AVFrame;
 struct AVPacket;
 
 
-class FFMpegWrapper : public StandardWrapper<int16_t>
+/**
+  * class FFMpegWrapper
+  *
+  * Wrapper for ffmpeg, for supporting innumerable streamed audio formats
+  *
+  * the PCM is stored in the sample format the codec decodes to (see OpenFFMpegWrapper()), i.e. FFMpegWrapper<float>
+  * plays files decoded to float or double, FFMpegWrapper<int32_t> those decoded to int32 or int64 and FFMpegWrapper<int16_t> everything else.
+  * decoded frames already in that format are copied (if interleaved) or interleaved straight into the buffer of the song,
+  * only other formats are converted by libswresample.
+  *
+  * packets are read from the file by a separate thread (see gConfig.FFMpegReadAheadPackets), while the ones before are
+  * being decoded, possibly by multiple threads of the codec itself (see gConfig.FFMpegDecoderThreads)
+  */
+template<typename SAMPLEFORMAT>
+class FFMpegWrapper : public StandardWrapper<SAMPLEFORMAT>
 {
     public:
     // Constructors/Destructors
@@ -22,6 +42,11 @@ class FFMpegWrapper : public StandardWrapper<int16_t>
      */
     FFMpegWrapper(std::string filename);
     FFMpegWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len);
+
+    /**
+     * takes over @p handle, which has been opened for @p filename and whose stream info has been found already, see OpenFFMpegWrapper()
+     */
+    FFMpegWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len, AVFormatContext *handle);
     void initAttr();
 
     // forbid copying
@@ -40,8 +65,13 @@ class FFMpegWrapper : public StandardWrapper<int16_t>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
 
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     AVFormatContext *handle = nullptr;
     SwrContext *swr = nullptr;
@@ -52,11 +82,55 @@ class FFMpegWrapper : public StandardWrapper<int16_t>
     AVFrame *frame = nullptr;
     //data packet read from the stream
     AVPacket *packet = nullptr;
-    std::vector<int16_t> tmpSwrBuf;
+    // frames decoded, but not fitting into the buffer passed to render() anymore
+    std::vector<SAMPLEFORMAT> tmpSwrBuf;
+    // the whole last frame, in case it had to be converted by swr
+    std::vector<SAMPLEFORMAT> swrBuf;
+    // sample format swr has been set up for
+    int swrFormat = -1;
+    // the channels of the last frame, if they are stored in separate planes
+    std::vector<const SAMPLEFORMAT *> planes;
 
     int audioStreamID = -1;
 
-    int decode_packet(int16_t *(&pcm), int &framesToDo);
+    // after seeking, the demuxer usually ends up somewhat before the requested frame; decoded frames
+    // before this one are dropped. negative if we are not seeking.
+    frame_t seekTarget = -1;
+
+    // packets of the audio stream read ahead by this->demuxer, at most readAheadLimit, i.e. gConfig.FFMpegReadAheadPackets when the demuxer was started
+    std::deque<AVPacket *> readAhead;
+    size_t readAheadLimit = 0;
+    // what av_read_frame() returned, once the demuxer has stopped reading because of the end of file or an I/O error
+    int demuxError = 0;
+    bool stopDemuxer = false;
+    std::mutex demuxMtx;
+    std::condition_variable demuxCv;
+    std::thread demuxer;
+
+    // time spent in this->render() and frames rendered therein, reported once the file is closed
+    std::chrono::steady_clock::duration decodeTime{};
+    frame_t framesDecoded = 0;
+
+    int decode_packet(SAMPLEFORMAT *(&pcm), int &framesToDo);
+    int readPacket();
+    void demux() noexcept;
+    void joinDemuxer() noexcept;
+    void convertFrame(int framesToSkip, SAMPLEFORMAT *pcm, int framesToPcm, SAMPLEFORMAT *remainder);
+    void setupSwr(int inFormat);
 };
 
+/**
+ * opens @p filename by ffmpeg and creates the wrapper storing the PCM in the sample format the codec of its first audio stream
+ * decodes to: FFMpegWrapper<int32_t> for 32 and 64 bit integers, FFMpegWrapper<float> for floats and doubles (64 bit samples
+ * being narrowed by libswresample) and FFMpegWrapper<int16_t> for anything else. the file is opened only once, i.e. the
+ * wrapper continues with what has been found out here when being open()ed
+ *
+ * @exceptions throws runtime_error if ffmpeg cannot open @p filename
+ */
+Song *OpenFFMpegWrapper(const std::string &filename, Nullable<size_t> offset, Nullable<size_t> len);
+
+extern template class FFMpegWrapper<int16_t>;
+extern template class FFMpegWrapper<int32_t>;
+extern template class FFMpegWrapper<float>;
+
 #endif // FFMPEGWRAPPER_H
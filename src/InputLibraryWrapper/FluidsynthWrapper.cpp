@@ -10,6 +10,8 @@
 #include <chrono>
 #include <thread> // std::this_thread::sleep_for
 #include <algorithm>
+#include <filesystem>
+#include <sstream>
 
 
 FluidsynthWrapper::FluidsynthWrapper() : lastRenderNotesWithoutPreset(gConfig.FluidsynthRenderNotesWithoutPreset), midiChannelHasNoteOn(NMidiChannels), midiChannelHasProgram(NMidiChannels)
@@ -180,6 +182,7 @@ void FluidsynthWrapper::setupSynth(const Nullable<string>& suggestedSf2)
     {
         THROW_RUNTIME_ERROR("Specified soundfont seems to be invalid or not supported: \"" << soundfont.Value << "\"");
     }
+    this->cachedSf2File = soundfont.Value;
 
     constexpr int CBFD_FILTERFC_CC = 34;
     constexpr int CBFD_FILTERQ_CC = 33;
@@ -394,7 +397,8 @@ void FluidsynthWrapper::setupMixdownBuffer()
     int channels = audVoices * ChanPerV;
     
     // allocate one single sample buffer
-    this->sampleBuffer.resize(gConfig.FramesToRender * channels);
+    this->mixdownFrames = gConfig.FramesToRender;
+    this->sampleBuffer.resize(this->mixdownFrames * channels);
     
     // array of buffers used to setup channel mapping
     this->dry.resize(channels);
@@ -404,7 +408,7 @@ void FluidsynthWrapper::setupMixdownBuffer()
     for(int i=0; i<channels; i++)
     {
         // if the corresponding MIDI channel has sound, assign a pointer to sample buffer, otherwise assign null so that this audio channel is not rendered
-        this->dry[i] = (audVoices==1 || this->midiChannelHasNoteOn[i/ChanPerV]) ? &this->sampleBuffer.data()[i * gConfig.FramesToRender] : nullptr;
+        this->dry[i] = (audVoices==1 || this->midiChannelHasNoteOn[i/ChanPerV]) ? &this->sampleBuffer.data()[i * this->mixdownFrames] : nullptr;
     }
     
     for(int i=0; i<fxVoices; i++)
@@ -528,6 +532,28 @@ bool FluidsynthWrapper::GetReverbActive()
     return b != 0;
 }
 
+std::string FluidsynthWrapper::GetCacheParams() const
+{
+    // soundfonts are way too big for hashing their content each time a song is opened, so rely on their size and mtime
+    std::error_code sizeErr, timeErr;
+    const auto sf2Size = std::filesystem::file_size(this->cachedSf2File, sizeErr);
+    const auto sf2Time = std::filesystem::last_write_time(this->cachedSf2File, timeErr);
+    if (sizeErr || timeErr)
+    {
+        return "";
+    }
+
+    std::stringstream ss;
+    ss << this->cachedSf2File << '|' << sf2Size << '|' << sf2Time.time_since_epoch().count() << '|'
+       << gConfig.FluidsynthEnableReverb << gConfig.FluidsynthEnableChorus << gConfig.FluidsynthMultiChannel << '|'
+       << gConfig.FluidsynthRoomSize << '|' << gConfig.FluidsynthDamping << '|' << gConfig.FluidsynthWidth << '|' << gConfig.FluidsynthLevel << '|'
+       << gConfig.FluidsynthFilterQ << '|' << gConfig.FluidsynthFilterFC << '|' << gConfig.FluidsynthGain << '|'
+       << gConfig.FluidsynthBankSelect << '|' << gConfig.FluidsynthChannel9IsDrum << gConfig.FluidsynthRenderNotesWithoutPreset << '|'
+       << this->cachedSampleRate;
+
+    return ss.str();
+}
+
 unsigned int FluidsynthWrapper::GetSampleRate()
 {
     return this->cachedSampleRate;
@@ -918,6 +944,14 @@ void FluidsynthWrapper::Render(float *bufferToFill, frame_t framesToRender)
     // see „synth.audio-channels“ and „synth.effects-channels“ settings respectively
     int audVoices = this->GetAudioVoices();
     int channels = std::min(audVoices, this->GetActiveMidiChannels()) * ChanPerV;
+
+    // the mixdown buffer has been set up when opening the song, gConfig.FramesToRender might have changed since then
+    while (framesToRender > this->mixdownFrames)
+    {
+        this->Render(bufferToFill, this->mixdownFrames);
+        bufferToFill += this->mixdownFrames * channels;
+        framesToRender -= this->mixdownFrames;
+    }
     
     float **dry = this->dry.data(), **fx = this->fx.data();
     
@@ -48,6 +48,9 @@ class FluidsynthWrapper
     static constexpr int GetChannelsPerVoice();
     static double GetTempoScale(unsigned int uspqn, unsigned int ppqn);
 
+    // describes the settings and the soundfont the synthesized PCM depends on, see StandardWrapper::getCacheParams()
+    std::string GetCacheParams() const;
+
     void AddEvent(smf_event_t *event, double offset = 0.0);
     void AddEvent(fluid_event_t *event, uint32_t tick);
     void ScheduleLoop(MidiLoopInfo *loopInfo);
@@ -99,11 +102,17 @@ class FluidsynthWrapper
 
     int cachedSf2Id = -1;
 
+    // path to the soundfont loaded as cachedSf2Id
+    std::string cachedSf2File;
+
     bool lastRenderNotesWithoutPreset;
 
     // temporary sample mixdown buffer used by fluid_synth_process
     std::vector<float> sampleBuffer;
 
+    // number of frames each audio channel within sampleBuffer can hold
+    frame_t mixdownFrames = 0;
+
     // pointer to small buffers within sampleBuffer of dry and effects audio
     std::vector<float*> dry, fx;
 
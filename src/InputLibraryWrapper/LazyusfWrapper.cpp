@@ -4,10 +4,12 @@
 #include "Common.h"
 #include "CommonExceptions.h"
 #include "Config.h"
+#include "PcmCache.h"
 
 #include <psflib.h>
 #include <usf.h>
 
+#include <algorithm>
 #include <utility>
 
 using namespace std;
@@ -56,11 +58,16 @@ void LazyusfWrapper::open()
         return;
     }
 
+    // let stdio_fopen() know about us, so that it records which files are loaded
+    this->loadedFiles.clear();
+    psf_file_callbacks callbacks = stdio_callbacks;
+    callbacks.context = this;
+
     this->usfHandle = new unsigned char[usf_get_state_size()];
     usf_clear(this->usfHandle);
 
     if (psf_load(this->Filename.c_str(),
-                 &stdio_callbacks,
+                 &callbacks,
                  0x21, // usf files are psf files with version 0x21
                  &LazyusfWrapper::usf_loader, // callback function to call on loading this usf file
                  this->usfHandle, // context, i.e. pointer to the struct we place the usf file in
@@ -123,6 +130,28 @@ frame_t LazyusfWrapper::getFrames() const
     }
 }
 
+std::string LazyusfWrapper::getCacheParams() const
+{
+    if (!gConfig.PcmCacheUsf)
+    {
+        return "";
+    }
+
+    // besides the settings, the PCM depends on any lib the file refers to
+    std::string params = "hle=" + std::to_string(gConfig.useHle);
+    for (const std::string &file : this->loadedFiles)
+    {
+        const std::string hash = PcmCache::hashFile(file);
+        if (hash.empty())
+        {
+            return "";
+        }
+        params += '|' + hash;
+    }
+
+    return params;
+}
+
 void LazyusfWrapper::buildMetadata() noexcept
 {
     // noting to do here, everything is done in usf_info()
@@ -132,6 +161,12 @@ void LazyusfWrapper::buildMetadata() noexcept
 
 void *LazyusfWrapper::stdio_fopen(void *ctx, const char *path)
 {
+    LazyusfWrapper *pthis = static_cast<LazyusfWrapper *>(ctx);
+    if (pthis != nullptr && std::find(pthis->loadedFiles.begin(), pthis->loadedFiles.end(), path) == pthis->loadedFiles.end())
+    {
+        pthis->loadedFiles.emplace_back(path);
+    }
+
     return fopen(path, "rb");
 }
 
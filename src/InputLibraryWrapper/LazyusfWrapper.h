@@ -34,7 +34,13 @@ class LazyusfWrapper : public StandardWrapper<int16_t>
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
 
+    protected:
+    std::string getCacheParams() const override;
+
     private:
+    // all files loaded by psflib, i.e. the file itself and its libs
+    std::vector<std::string> loadedFiles;
+
     // set by usf_info
     unsigned int enable_compare = 0;
     // set by usf_info
@@ -213,6 +213,22 @@ void LibGMEWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
     STANDARDWRAPPER_RENDER(int16_t, gme_play(this->handle, framesToDoNow * Channels, pcm))
 }
 
+bool LibGMEWrapper::isSeekable() const noexcept
+{
+    return this->handle != nullptr;
+}
+
+void LibGMEWrapper::seekDecoder(frame_t frame)
+{
+    // gme seeks by emulating everything up to the requested position, thus backward seeks are as expensive as restarting the track
+    // seek by samples rather than milliseconds, so that the decoder continues exactly at the requested frame
+    gme_err_t msg = gme_seek_samples(this->handle, static_cast<int>(frame * this->Format.Channels()));
+    if (msg)
+    {
+        THROW_RUNTIME_ERROR("libgme failed to seek in file \"" << this->Filename << "\" with message: " << msg);
+    }
+}
+
 frame_t LibGMEWrapper::getFrames() const
 {
     return msToFrames(this->fileLen.Value, this->Format.SampleRate);
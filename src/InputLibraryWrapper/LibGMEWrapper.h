@@ -37,8 +37,13 @@ class LibGMEWrapper : public StandardWrapper<int16_t>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
 
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     Music_Emu *handle = nullptr;
     gme_info_t *info = nullptr;
@@ -4,6 +4,8 @@
 #include "Config.h"
 
 #include "AtomicWrite.h"
+#include "DecoderPool.h"
+#include "MixKernels.h"
 
 #include <chrono>
 #include <thread> // std::this_thread::sleep_for
@@ -11,8 +13,10 @@
 #include <id3tag.h>
 #include <mad.h>
 
+#include <algorithm> // upper_bound
 #include <cmath> // floor
 #include <cstring> // strerror
+#include <fcntl.h>
 #include <utility>
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -39,28 +43,289 @@ void LibMadWrapper::initAttr()
 
 LibMadWrapper::~LibMadWrapper()
 {
+    this->stopScan();
     this->releaseBuffer();
     this->close();
 }
 
 int LibMadWrapper::findValidHeader(struct mad_header &header)
 {
-    int ret;
+    return LibMadWrapper::nextHeader(*this->stream, header) ? 0 : -1;
+}
 
-    while ((ret = mad_header_decode(&header, this->stream)) != 0 && MAD_RECOVERABLE(this->stream->error))
+/**
+ * Decodes the header of the next mpeg frame of @p stream, skipping ID3 tags and garbage in between.
+ *
+ * @return false if there is none
+ */
+bool LibMadWrapper::nextHeader(struct mad_stream &stream, struct mad_header &header) noexcept
+{
+    while (mad_header_decode(&header, &stream) != 0)
     {
-        if (this->stream->error == MAD_ERROR_LOSTSYNC)
+        if (!MAD_RECOVERABLE(stream.error))
+        {
+            return false;
+        }
+
+        if (stream.error == MAD_ERROR_LOSTSYNC)
         {
-            long tagsize = id3_tag_query(this->stream->this_frame, this->stream->bufend - this->stream->this_frame);
+            long tagsize = id3_tag_query(stream.this_frame, stream.bufend - stream.this_frame);
             if (tagsize > 0)
             {
-                mad_stream_skip(this->stream, tagsize);
-                continue;
+                mad_stream_skip(&stream, tagsize);
             }
         }
     }
 
-    return ret;
+    return true;
+}
+
+static uint32_t readBigEndian32(const unsigned char *p) noexcept
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static uint32_t readLittleEndian32(const unsigned char *p) noexcept
+{
+    return (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[0];
+}
+
+/**
+ * @param frame points to the header of the first mpeg frame
+ * @param len number of bytes readable at @p frame
+ *
+ * @return the number of mpeg frames stored in the Xing/Info or VBRI header of @p frame (excluding @p frame itself), 0 if there is none
+ */
+size_t LibMadWrapper::countTaggedFrames(const unsigned char *frame, size_t len, const struct mad_header &header) noexcept
+{
+    if (header.layer != MAD_LAYER_III)
+    {
+        return 0;
+    }
+
+    // the Xing/Info header follows the side information, whose size depends on mpeg version and channel mode
+    const bool Mpeg1 = (header.flags & MAD_FLAG_LSF_EXT) == 0;
+    const bool Mono = header.mode == MAD_MODE_SINGLE_CHANNEL;
+    const size_t Xing = 4 + ((header.flags & MAD_FLAG_PROTECTION) ? 2 : 0) + (Mpeg1 ? (Mono ? 17 : 32) : (Mono ? 9 : 17));
+    if (Xing + 12 <= len && (memcmp(frame + Xing, "Xing", 4) == 0 || memcmp(frame + Xing, "Info", 4) == 0))
+    {
+        constexpr uint32_t FramesFlag = 0x1;
+        const uint32_t Flags = readBigEndian32(frame + Xing + 4);
+        return (Flags & FramesFlag) ? readBigEndian32(frame + Xing + 8) : 0;
+    }
+
+    // the VBRI header of the Fraunhofer encoder always is at the same place: "VBRI", version, delay, quality, bytes, frames
+    constexpr size_t Vbri = 4 + 32;
+    if (Vbri + 18 <= len && memcmp(frame + Vbri, "VBRI", 4) == 0)
+    {
+        return readBigEndian32(frame + Vbri + 14);
+    }
+
+    return 0;
+}
+
+/**
+ * @return the number of bytes from the first mpeg frame at @p firstFrame to the end of the mpeg data, i.e. excluding ID3v1 and APE tags at the end of the file
+ */
+size_t LibMadWrapper::countAudioBytes(size_t firstFrame) const noexcept
+{
+    size_t end = this->mpeglen;
+
+    constexpr size_t Id3v1Size = 128;
+    if (end >= firstFrame + Id3v1Size && memcmp(this->mpegbuf + end - Id3v1Size, "TAG", 3) == 0)
+    {
+        end -= Id3v1Size;
+    }
+
+    constexpr size_t ApeFooterSize = 32;
+    if (end >= firstFrame + ApeFooterSize && memcmp(this->mpegbuf + end - ApeFooterSize, "APETAGEX", 8) == 0)
+    {
+        // the size stored in the footer includes the footer, but not the optional header
+        const unsigned char *footer = this->mpegbuf + end - ApeFooterSize;
+        const size_t TagSize = readLittleEndian32(footer + 12) + ((readLittleEndian32(footer + 20) & 0x80000000u) ? ApeFooterSize : 0);
+        if (TagSize <= end - firstFrame)
+        {
+            end -= TagSize;
+        }
+    }
+
+    return end - firstFrame;
+}
+
+/**
+ * Decodes the headers of all mpeg frames of @p s, building s.table.
+ *
+ * @return false if stopped via s.stop
+ */
+bool LibMadWrapper::scanFrames(FrameScan &s)
+{
+    while (!s.stop.load(std::memory_order_relaxed) && LibMadWrapper::nextHeader(s.stream, s.header))
+    {
+        // sanity checks, the first two headers may contain garbage (see open())
+        if (s.count >= 2)
+        {
+            if (s.channels != MAD_NCHANNELS(&s.header))
+            {
+                CLOG(LogLevel_t::Warning, "channelcount varies (now: " << MAD_NCHANNELS(&s.header) << ") within File \"" << this->Filename << ")\"");
+
+                if (!gConfig.MadPermissive)
+                {
+                    THROW_RUNTIME_ERROR("invalid mp3: channelcount varies");
+                }
+            }
+
+            if (s.sampleRate != s.header.samplerate)
+            {
+                CLOG(LogLevel_t::Warning, "samplerate varies (now: " << s.header.samplerate << ") within File \"" << this->Filename << ")\"");
+
+                if (!gConfig.MadPermissive)
+                {
+                    THROW_RUNTIME_ERROR("invalid mp3: samplerate varies");
+                }
+            }
+        }
+
+        if (s.count % SeekTableSpacing == 0)
+        {
+            s.table.push_back({s.frames, static_cast<size_t>(s.stream.this_frame - s.buf)});
+        }
+        s.count++;
+        s.frames += 32 * MAD_NSBSAMPLES(&s.header);
+    }
+
+    return !s.stop;
+}
+
+/**
+ * Replaces the seek table by the one of the completed scan @p s.
+ */
+void LibMadWrapper::completeSeekTable(FrameScan &s)
+{
+    std::lock_guard<std::mutex> lck(this->seekTableMtx);
+    this->seekTable = std::move(s.table);
+    this->seekTable.shrink_to_fit();
+    this->seekTableFrames = s.count;
+    this->seekTableEnd = {s.frames, s.len};
+    this->scannedFrames = s.frames;
+    this->seekTableComplete = true;
+}
+
+/**
+ * Decodes the header of every mpeg frame of this->mpegbuf right away.
+ */
+void LibMadWrapper::scanAllFrames()
+{
+    FrameScan s;
+    s.buf = this->mpegbuf;
+    s.len = this->mpeglen;
+    s.channels = this->Format.Channels();
+    s.sampleRate = this->Format.SampleRate;
+
+    mad_stream_init(&s.stream);
+    mad_stream_buffer(&s.stream, s.buf, s.len);
+    mad_header_init(&s.header);
+
+    try
+    {
+        this->scanFrames(s);
+    }
+    catch (const std::exception &e)
+    {
+        mad_header_finish(&s.header);
+        mad_stream_finish(&s.stream);
+        throw;
+    }
+    mad_header_finish(&s.header);
+    mad_stream_finish(&s.stream);
+
+    this->completeSeekTable(s);
+}
+
+/**
+ * Starts decoding the header of every mpeg frame in the background, if not done already.
+ */
+void LibMadWrapper::startScan()
+{
+    if (!gConfig.MadScanFrames || this->seekTableComplete || this->scan != nullptr)
+    {
+        return;
+    }
+
+    int fd = ::open(this->Filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    const size_t Len = getFileSize(fd);
+    void *buf = mmap(nullptr, Len, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (buf == MAP_FAILED)
+    {
+        return;
+    }
+    madvise(buf, Len, MADV_SEQUENTIAL);
+
+    auto s = std::make_unique<FrameScan>();
+    s->buf = static_cast<unsigned char *>(buf);
+    s->len = Len;
+    s->channels = this->Format.Channels();
+    s->sampleRate = this->Format.SampleRate;
+    mad_stream_init(&s->stream);
+    mad_stream_buffer(&s->stream, s->buf, s->len);
+    mad_header_init(&s->header);
+
+    FrameScan *scan = s.get();
+    this->scan = std::move(s);
+
+    // queued separately from the rendering of this song, so that it doesnt delay it
+    this->scan->future = DecoderPool::Singleton().submit(scan, [this, scan, Estimated = this->numFrames]() {
+        bool complete = false;
+        try
+        {
+            complete = this->scanFrames(*scan);
+        }
+        catch (const std::exception &e)
+        {
+            CLOG(LogLevel_t::Warning, "cannot determine the exact length of File \"" << this->Filename << "\": " << e.what());
+        }
+
+        mad_header_finish(&scan->header);
+        mad_stream_finish(&scan->stream);
+        munmap(scan->buf, scan->len);
+        scan->buf = nullptr;
+
+        if (!complete)
+        {
+            return;
+        }
+
+        if (scan->frames != Estimated)
+        {
+            // the song has been rendered for the estimated length already, the exact one is taken when opening it the next time
+            CLOG(LogLevel_t::Info, "File \"" << this->Filename << "\" is actually " << scan->frames << " frames long, rather than " << Estimated << " as estimated");
+        }
+        this->completeSeekTable(*scan);
+    });
+}
+
+void LibMadWrapper::stopScan() noexcept
+{
+    if (this->scan == nullptr)
+    {
+        return;
+    }
+
+    this->scan->stop = true;
+    WAIT(this->scan->future);
+    this->scan.reset();
+}
+
+void LibMadWrapper::fillBuffer()
+{
+    // only songs about to be played are scanned, rather than every file added to the playlist
+    this->startScan();
+
+    StandardWrapper::fillBuffer();
 }
 
 void LibMadWrapper::open()
@@ -92,8 +357,8 @@ void LibMadWrapper::open()
     mad_stream_buffer(this->stream, this->mpegbuf, this->mpeglen);
 
     // we want to know how many pcm frames there are decoded in this file
-    // therefore decode header of every mpeg frame
-    // pretty expensive, so only to this once
+    // decoding the header of every mpeg frame is pretty expensive for long files, so estimate it from the first ones
+    // and let the exact scan confirm it in the background
     if (this->numFrames == 0)
     {
         struct mad_header header;
@@ -117,7 +382,12 @@ void LibMadWrapper::open()
 
         // no clue what this 32 does
         // stolen from mad_synth_frame() in synth.c
-        this->numFrames += 32 * MAD_NSBSAMPLES(&header);
+        const frame_t SamplesPerFrame = 32 * MAD_NSBSAMPLES(&header);
+        const size_t FirstOffset = static_cast<size_t>(this->stream->this_frame - this->mpegbuf);
+        const unsigned long FirstBitrate = header.bitrate;
+
+        // encoders usually put a Xing/Info or VBRI header into the first mpeg frame, telling the number of frames
+        const size_t TaggedFrames = LibMadWrapper::countTaggedFrames(this->stream->this_frame, this->stream->bufend - this->stream->this_frame, header);
 
         // try to find a second valid header
         ret = this->findValidHeader(header);
@@ -127,53 +397,32 @@ void LibMadWrapper::open()
             this->Format.VoiceChannels[0] = max<int>(MAD_NCHANNELS(&header), this->Format.VoiceChannels[0]);
             this->Format.SampleRate = header.samplerate;
             CLOG(LogLevel_t::Debug, "found a second valid header within File \"" << this->Filename << "\"\n\tchannels: " << MAD_NCHANNELS(&header) << "\nsrate: " << header.samplerate);
-
-            this->numFrames += 32 * MAD_NSBSAMPLES(&header);
-
-            // now lets go on and decode rest of file
-            while (1)
-            {
-                if (mad_header_decode(&header, this->stream) != 0)
-                {
-                    if (MAD_RECOVERABLE(this->stream->error))
-                    {
-                        continue;
-                    }
-                    else
-                    {
-                        break;
-                    }
-                }
-
-                // sanity checks
-                if (this->Format.Channels() != MAD_NCHANNELS(&header))
-                {
-                    CLOG(LogLevel_t::Warning, "channelcount varies (now: " << MAD_NCHANNELS(&header) << ") within File \"" << this->Filename << ")\"");
-
-                    if (!gConfig.MadPermissive)
-                    {
-                        THROW_RUNTIME_ERROR("invalid mp3: channelcount varies");
-                    }
-                }
-
-                if (this->Format.SampleRate != header.samplerate)
-                {
-                    CLOG(LogLevel_t::Warning, "samplerate varies (now: " << header.samplerate << ") within File \"" << this->Filename << ")\"");
-
-                    if (!gConfig.MadPermissive)
-                    {
-                        THROW_RUNTIME_ERROR("invalid mp3: samplerate varies");
-                    }
-                }
-
-                this->numFrames += 32 * MAD_NSBSAMPLES(&header);
-            }
         }
         else
         {
             CLOG(LogLevel_t::Warning, "only one valid header found, probably no valid mp3 File \"" << this->Filename << "\"");
         }
 
+        if (TaggedFrames != 0)
+        {
+            // the tag doesnt count the mpeg frame it is stored in, which libmad decodes to silence though
+            this->numFrames = (TaggedFrames + 1) * SamplesPerFrame;
+            CLOG(LogLevel_t::Debug, "taking the length of File \"" << this->Filename << "\" from its Xing/VBRI header: " << TaggedFrames << " mpeg frames");
+        }
+        else if (ret == 0 && FirstBitrate != 0 && header.bitrate == FirstBitrate)
+        {
+            // most probably a file of constant bitrate, the size of all frames is the same (apart from padding)
+            const double BytesPerFrame = SamplesPerFrame / 8.0 * FirstBitrate / this->Format.SampleRate;
+            this->numFrames = static_cast<frame_t>(std::llround(this->countAudioBytes(FirstOffset) / BytesPerFrame)) * SamplesPerFrame;
+            CLOG(LogLevel_t::Debug, "estimating the length of File \"" << this->Filename << "\" from its bitrate: " << FirstBitrate << " bit/s");
+        }
+        else
+        {
+            // variable bitrate without a tag, there is no way around decoding every header
+            this->scanAllFrames();
+            this->numFrames = this->scannedFrames;
+        }
+
         // somehow reset libmad stream
         mad_stream_finish(this->stream);
         mad_stream_init(this->stream);
@@ -182,6 +431,14 @@ void LibMadWrapper::open()
 
         mad_header_finish(&header);
     }
+    else if (this->seekTableComplete && this->scannedFrames != this->numFrames && this->data == nullptr)
+    {
+        // the background scan found the exact length, after the song had been rendered for the estimated one
+        // no PCM of that one is held anymore, so take the exact one and build the loop tree again
+        CLOG(LogLevel_t::Debug, "taking the scanned length of File \"" << this->Filename << "\": " << this->scannedFrames << " frames");
+        this->numFrames = this->scannedFrames;
+        this->buildLoopTree();
+    }
 
     this->frame.hasValue = true;
     mad_frame_init(&this->frame.Value);
@@ -231,28 +488,30 @@ void LibMadWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
     framesToRender = min(framesToRender, this->getFrames() - this->framesAlreadyRendered);
     int32_t *pcm = static_cast<int32_t *>(bufferToFill);
 
+    /* audio normalization */
+    const float absoluteGain = (numeric_limits<int32_t>::max()) / (numeric_limits<int32_t>::max() * this->gainCorrection);
+    const float gain = gConfig.useAudioNormalization ? absoluteGain : 1.0f;
+
     // the outer loop, used for decoding and synthesizing MPEG frames
     while (framesToRender > 0 && !this->stopFillBuffer)
     {
-        // write back tempbuffer, i.e. frames we've buffered from previous calls to libmad (required due to inelegant API of libmad, i.e. cant tell how many frames to render during one call)
-        const size_t itemsToCpy = min<size_t>(this->tempBuf.size(), framesToRender * Channels);
-        if (itemsToCpy > 0)
+        // write back the frames left over from the previous mpeg frame (required due to inelegant API of libmad, i.e. cant tell how many frames to render during one call)
+        if (this->remainderBegin != this->remainderEnd)
         {
-            memcpy(pcm, this->tempBuf.data(), itemsToCpy * sizeof(int32_t));
+            const frame_t framesCpyd = min<frame_t>((this->remainderEnd - this->remainderBegin) / Channels, framesToRender);
+            memcpy(pcm, this->remainder + this->remainderBegin, framesCpyd * Channels * sizeof(int32_t));
 
-            this->tempBuf.erase(this->tempBuf.begin(), this->tempBuf.begin() + itemsToCpy);
+            this->remainderBegin += framesCpyd * Channels;
+            if (this->remainderBegin == this->remainderEnd)
+            {
+                this->remainderBegin = this->remainderEnd = 0;
+            }
 
-            const size_t framesCpyd = itemsToCpy / Channels;
             framesToRender -= framesCpyd;
             this->framesAlreadyRendered += framesCpyd;
 
             // again: adjust position
-            pcm += itemsToCpy;
-        }
-
-        int framesToDoNow = (framesToRender / gConfig.FramesToRender) > 0 ? gConfig.FramesToRender : framesToRender % gConfig.FramesToRender;
-        if (framesToDoNow == 0)
-        {
+            pcm += framesCpyd * Channels;
             continue;
         }
 
@@ -269,10 +528,28 @@ void LibMadWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
                 }
             }
 
+            if (this->stream->error == MAD_ERROR_BUFLEN)
+            {
+                // end of file reached, though the estimated length says there are frames left; fill them with silence
+                CLOG(LogLevel_t::Debug, "File \"" << this->Filename << "\" ended " << framesToRender << " frames earlier than estimated");
+                memset(pcm, 0, framesToRender * Channels * sizeof(int32_t));
+                this->framesAlreadyRendered += framesToRender;
+                this->framesToDiscard = 0;
+                framesToRender = 0;
+                break;
+            }
+
             string errstr = mad_stream_errorstr(this->stream);
 
             if (MAD_RECOVERABLE(this->stream->error))
             {
+                if (this->framesToDiscard > 0 && this->stream->error == MAD_ERROR_BADDATAPTR)
+                {
+                    // expected when priming the bit reservoir after seeking, still account for the pcm frames this mpeg frame would have produced
+                    this->framesToDiscard -= min<frame_t>(this->framesToDiscard, 32 * MAD_NSBSAMPLES(&this->frame->header));
+                    continue;
+                }
+
                 errstr += " (recoverable)";
                 CLOG(LogLevel_t::Info, errstr);
                 continue;
@@ -294,72 +571,127 @@ void LibMadWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
         mad_fixed_t const *left_ch = this->synth->pcm.samples[0];
         mad_fixed_t const *right_ch = this->synth->pcm.samples[1];
 
-        unsigned int item = 0;
-        /* audio normalization */
-        const float absoluteGain = (numeric_limits<int32_t>::max()) / (numeric_limits<int32_t>::max() * this->gainCorrection);
-
-        for (;
-             !this->stopFillBuffer &&
-             framesToDoNow > 0 && // frames left during this loop
-             framesToRender > 0 && // frames left during this call
-             nsamples > 0; // frames left from libmad
-             framesToRender--, nsamples--, framesToDoNow--)
+        if (Channels == 2 && this->synth.Value.pcm.channels != 2)
         {
-            int32_t sample;
+            // what? only one channel in a stereo file? well then: pseudo stereo
+            right_ch = left_ch;
+            CLOG(LogLevel_t::Warning, "decoded only one channel, though this is a stereo file!");
+        }
 
-            /* output sample(s) in 24-bit signed little-endian PCM */
+        if (this->framesToDiscard > 0)
+        {
+            // we have seeked and are either still priming the decoder or this mpeg frame starts before the frame requested
+            const unsigned short skip = min<frame_t>(nsamples, this->framesToDiscard);
+            left_ch += skip;
+            right_ch += skip;
+            nsamples -= skip;
+            this->framesToDiscard -= skip;
+        }
 
-            sample = LibMadWrapper::toInt24Sample(*left_ch++);
-            sample = gConfig.useAudioNormalization ? floor(sample * absoluteGain) : sample;
-            pcm[item++] = sample;
+        // convert and interleave as many frames as fit straight into "bufferToFill" (i.e. "pcm")
+        const frame_t direct = min<frame_t>(nsamples, framesToRender);
+        MixConvertFixed(left_ch, right_ch, pcm, direct, Channels, gain);
+        pcm += direct * Channels;
+        framesToRender -= direct;
+        this->framesAlreadyRendered += direct;
 
-            if (Channels == 2) // our buffer is for 2 channels
-            {
-                if (this->synth.Value.pcm.channels == 2) // ...but did mad also decoded for 2 channels?
-                {
-                    sample = LibMadWrapper::toInt24Sample(*right_ch++);
-                    sample = gConfig.useAudioNormalization ? floor(sample * absoluteGain) : sample;
-                    pcm[item++] = sample;
-                }
-                else
-                {
-                    // what? only one channel in a stereo file? well then: pseudo stereo
-                    pcm[item++] = sample;
+        // "pcm" is full, temporarily save the rest of the frames from libmad
+        if (nsamples > direct)
+        {
+            MixConvertFixed(left_ch + direct, right_ch + direct, this->remainder, nsamples - direct, Channels, gain);
+            this->remainderBegin = 0;
+            this->remainderEnd = (nsamples - direct) * Channels;
+        }
+    }
+}
 
-                    CLOG(LogLevel_t::Warning, "decoded only one channel, though this is a stereo file!");
-                }
-            }
+bool LibMadWrapper::isSeekable() const noexcept
+{
+    return this->stream != nullptr;
+}
 
-            this->framesAlreadyRendered++;
+void LibMadWrapper::seekDecoder(frame_t frame)
+{
+    // layer III frames may use the main data of their predecessors (bit reservoir) and the synthesis filter depends on
+    // the previous frame as well, thus start decoding a few mpeg frames before the one containing the requested pcm frame
+    constexpr size_t PrimingFrames = 4;
+    // the most pcm frames a single mpeg frame may hold
+    constexpr frame_t MaxSamplesPerFrame = 1152;
+
+    // find the last mpeg frame known, that is far enough in front of the requested one
+    const frame_t WalkFrom = max<frame_t>(0, frame - static_cast<frame_t>(PrimingFrames) * MaxSamplesPerFrame);
+    MpegFrame from;
+    size_t number;
+    size_t tableFrames;
+    {
+        std::lock_guard<std::mutex> lck(this->seekTableMtx);
+        tableFrames = this->seekTableFrames;
+        if (WalkFrom >= this->seekTableEnd.pcmFrame)
+        {
+            from = this->seekTableEnd;
+            number = this->seekTableFrames;
         }
-        pcm += item /* % this->count*/;
-
-        // "bufferToFill" (i.e. "pcm") seems to be full, drain the rest pcm samples from libmad and temporarily save them
-        while (!this->stopFillBuffer && nsamples > 0)
+        else
         {
-            int32_t sample;
-
-            /* output sample(s) in 24-bit signed little-endian PCM */
-
-            sample = LibMadWrapper::toInt24Sample(*left_ch++);
-            this->tempBuf.push_back(gConfig.useAudioNormalization ? floor(sample * absoluteGain) : sample);
+            auto it = upper_bound(this->seekTable.begin(), this->seekTable.end(), WalkFrom, [](frame_t f, const MpegFrame &m) { return f < m.pcmFrame; });
+            size_t entry = std::distance(this->seekTable.begin(), it);
+            entry = entry > 0 ? entry - 1 : 0;
+            from = entry < this->seekTable.size() ? this->seekTable[entry] : MpegFrame{0, 0};
+            number = entry * SeekTableSpacing;
+        }
+    }
 
-            if (Channels == 2)
-            {
-                sample = LibMadWrapper::toInt24Sample(*right_ch++);
-                this->tempBuf.push_back(gConfig.useAudioNormalization ? floor(sample * absoluteGain) : sample);
-            }
+    // from there on, decode the headers up to the requested frame, remembering the last few mpeg frames for priming
+    struct mad_stream walk;
+    struct mad_header header;
+    mad_stream_init(&walk);
+    mad_stream_buffer(&walk, this->mpegbuf + from.offset, this->mpeglen - from.offset);
+    mad_header_init(&header);
+
+    MpegFrame history[PrimingFrames + 1];
+    size_t walked = 0;
+    vector<MpegFrame> newEntries;
+    MpegFrame next = from;
+    while (next.pcmFrame <= frame && LibMadWrapper::nextHeader(walk, header))
+    {
+        const MpegFrame current = {next.pcmFrame, static_cast<size_t>(walk.this_frame - this->mpegbuf)};
+        history[walked % (PrimingFrames + 1)] = current;
+        walked++;
 
-            /* DONT do this: this->framesAlreadyRendered++; since we use framesAlreadyRendered as offset for "bufferToFill"*/
-            nsamples--;
+        if (number >= tableFrames && number % SeekTableSpacing == 0)
+        {
+            newEntries.push_back(current);
         }
+        number++;
+
+        next = {current.pcmFrame + 32 * MAD_NSBSAMPLES(&header), static_cast<size_t>(walk.next_frame - this->mpegbuf)};
+    }
+    mad_header_finish(&header);
+    mad_stream_finish(&walk);
 
-        if (item > this->count)
+    // remember the mpeg frames walked through beyond the seek table, so that we dont need to walk them again
+    if (number > tableFrames)
+    {
+        std::lock_guard<std::mutex> lck(this->seekTableMtx);
+        if (this->seekTableFrames == tableFrames)
         {
-            CLOG(LogLevel_t::Error, "THIS SHOULD NEVER HAPPEN: read " << item << " items but only expected " << this->count << "\n");
-            break;
+            this->seekTable.insert(this->seekTable.end(), newEntries.begin(), newEntries.end());
+            this->seekTableFrames = number;
+            this->seekTableEnd = next;
         }
     }
+
+    const MpegFrame first = (walked == 0) ? from : history[(walked > PrimingFrames ? walked - PrimingFrames - 1 : 0) % (PrimingFrames + 1)];
+
+    // reset libmad, just as if we were starting at the beginning of the file
+    mad_stream_finish(this->stream);
+    mad_stream_init(this->stream);
+    mad_stream_buffer(this->stream, this->mpegbuf + first.offset, this->mpeglen - first.offset);
+    mad_frame_mute(&this->frame.Value);
+    mad_synth_mute(&this->synth.Value);
+
+    this->remainderBegin = this->remainderEnd = 0;
+    this->framesToDiscard = max<frame_t>(0, frame - first.pcmFrame);
 }
 
 frame_t LibMadWrapper::getFrames() const
@@ -495,36 +827,3 @@ string LibMadWrapper::id3_get_tag(struct id3_tag const *tag, char const *what)
 
     return string(printable);
 }
-
-/* FROM minimad.c
- *
- * The following utility routine performs simple rounding, clipping, and
- * scaling of MAD's high-resolution samples down to 24 bits. It does not
- * perform any dithering or noise shaping, which would be recommended to
- * obtain any exceptional audio quality. It is therefore not recommended to
- * use this routine if high-quality output is desired.
- */
-#define SAMPLE_SIZE 24
-int32_t LibMadWrapper::toInt24Sample(mad_fixed_t sample)
-{
-    /* round */
-    sample += (1L << (MAD_F_FRACBITS - SAMPLE_SIZE));
-
-    /* clip */
-    if (sample >= MAD_F_ONE)
-    {
-        sample = MAD_F_ONE - 1;
-    }
-    else if (sample < -MAD_F_ONE)
-    {
-        sample = -MAD_F_ONE;
-    }
-
-    /* quantize, i.e. cut the fractional bits we dont need anymore */
-    sample >>= (MAD_F_FRACBITS + 1 - SAMPLE_SIZE);
-
-    /* make sure the 24th bit becomes the msb */
-    sample <<= sizeof(mad_fixed_t) * 8 /*==32bits*/ - SAMPLE_SIZE;
-
-    return sample;
-}
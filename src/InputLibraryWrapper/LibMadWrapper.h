@@ -3,6 +3,11 @@
 
 #include "StandardWrapper.h"
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+
 #include <mad.h>
 
 
@@ -30,12 +35,19 @@ class LibMadWrapper : public StandardWrapper<int32_t>
 
     void close() noexcept override;
 
+    void fillBuffer() override;
+
     frame_t getFrames() const override;
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
 
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     FILE *infile = nullptr;
     unsigned char *mpegbuf = nullptr;
@@ -51,13 +63,84 @@ class LibMadWrapper : public StandardWrapper<int32_t>
     // and the member phase of synth is definitly reused
     Nullable<struct mad_synth> synth;
 
-    vector<int32_t> tempBuf;
+    // the frames of the last mpeg frame synthesized, that didnt fit into the buffer to fill anymore
+    // interleaved PCM, ready to be copied, the ones from remainderBegin on are still to be copied
+    int32_t remainder[2 * 1152];
+    size_t remainderBegin = 0;
+    size_t remainderEnd = 0;
 
+    // either exact or estimated from the first mpeg frames. doesnt change while the song holds any PCM, since the PCM buffer,
+    // the loop tree and the loop plan of the song depend on it. if the background scan finds a different length, it is taken
+    // when opening the file the next time without any PCM held
     frame_t numFrames = 0;
-    static signed int toInt24Sample(mad_fixed_t sample);
+
+    struct MpegFrame
+    {
+        // the first pcm frame decoded from this mpeg frame
+        frame_t pcmFrame;
+        // byte offset of its header within this->mpegbuf
+        size_t offset;
+    };
+
+    // number of mpeg frames between two entries of this->seekTable
+    static constexpr size_t SeekTableSpacing = 32;
+
+    // every SeekTableSpacing-th mpeg frame of the file, i.e. entry i is mpeg frame i * SeekTableSpacing
+    // it covers the first this->seekTableFrames mpeg frames, frames beyond are found by decoding the headers following this->seekTableEnd.
+    // kept when closing the file, so that seeking doesnt require scanning it again
+    vector<MpegFrame> seekTable;
+    size_t seekTableFrames = 0;
+    // the mpeg frame following the ones covered
+    MpegFrame seekTableEnd = {0, 0};
+    // seekDecoder() and the background scan may extend the table concurrently
+    mutable std::mutex seekTableMtx;
+
+    // whether the seek table covers the whole file, only then this->scannedFrames is valid
+    std::atomic<bool> seekTableComplete = {false};
+
+    // the number of pcm frames found by decoding the header of every mpeg frame
+    frame_t scannedFrames = 0;
+
+    // decodes the headers of all mpeg frames in the background, on a mapping of the file of its own, since this->mpegbuf
+    // is unmapped when closing
+    struct FrameScan
+    {
+        unsigned char *buf = nullptr;
+        size_t len = 0;
+
+        struct mad_stream stream;
+        struct mad_header header;
+
+        // format of the first mpeg frame
+        unsigned int channels = 0;
+        unsigned int sampleRate = 0;
+
+        // number of mpeg and pcm frames found so far
+        size_t count = 0;
+        frame_t frames = 0;
+        vector<MpegFrame> table;
+
+        std::atomic<bool> stop = {false};
+        std::future<void> future;
+    };
+    std::unique_ptr<FrameScan> scan;
+
+    // number of pcm frames still to be dropped after seeking, before we reach the requested frame
+    frame_t framesToDiscard = 0;
+
     static string id3_get_tag(struct id3_tag const *tag, char const *what);
 
     int findValidHeader(struct mad_header &header);
+    static bool nextHeader(struct mad_stream &stream, struct mad_header &header) noexcept;
+
+    static size_t countTaggedFrames(const unsigned char *frame, size_t len, const struct mad_header &header) noexcept;
+    size_t countAudioBytes(size_t firstFrame) const noexcept;
+
+    void scanAllFrames();
+    bool scanFrames(FrameScan &s);
+    void completeSeekTable(FrameScan &s);
+    void startScan();
+    void stopScan() noexcept;
 };
 
 #endif // LIBSNDWRAPPER_H
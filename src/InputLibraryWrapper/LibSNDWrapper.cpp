@@ -13,19 +13,85 @@
 #include <fstream>
 #include <regex>
 #include <array>
+#include <type_traits>
 
 
-LibSNDWrapper::LibSNDWrapper(std::string filename)
-: StandardWrapper(std::move(filename))
+/**
+ * @return true, if libsndfile's subformat @p format has samples of at most 16 bits
+ */
+static bool IsNarrowSubformat(int format) noexcept
 {
+    switch (format & SF_FORMAT_SUBMASK)
+    {
+        case SF_FORMAT_PCM_S8:
+        case SF_FORMAT_PCM_U8:
+        case SF_FORMAT_PCM_16:
+        case SF_FORMAT_ULAW:
+        case SF_FORMAT_ALAW:
+        case SF_FORMAT_IMA_ADPCM:
+        case SF_FORMAT_MS_ADPCM:
+        case SF_FORMAT_GSM610:
+        case SF_FORMAT_VOX_ADPCM:
+        case SF_FORMAT_G721_32:
+        case SF_FORMAT_G723_24:
+        case SF_FORMAT_G723_40:
+        case SF_FORMAT_DWVW_12:
+        case SF_FORMAT_DWVW_16:
+        case SF_FORMAT_DPCM_8:
+        case SF_FORMAT_DPCM_16:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Song *OpenLibSNDWrapper(const std::string &filename, Nullable<size_t> offset, Nullable<size_t> len)
+{
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+
+    SNDFILE *file = sf_open(filename.c_str(), SFM_READ, &info);
+    if (file == nullptr)
+    {
+        THROW_RUNTIME_ERROR(sf_strerror(nullptr) << " (in File \"" << filename << ")\"");
+    }
+
+    // the wrapper takes over the file, so it is opened only once
+    try
+    {
+        if (IsNarrowSubformat(info.format))
+        {
+            return new LibSNDWrapper<int16_t>(filename, offset, len, file, info);
+        }
+        return new LibSNDWrapper<sndfile_sample_t>(filename, offset, len, file, info);
+    }
+    catch (const std::bad_alloc &e)
+    {
+        sf_close(file);
+        throw;
+    }
 }
 
-LibSNDWrapper::LibSNDWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len)
-: StandardWrapper(std::move(filename), offset, len)
+template<typename SAMPLEFORMAT>
+LibSNDWrapper<SAMPLEFORMAT>::LibSNDWrapper(std::string filename)
+: StandardWrapper<SAMPLEFORMAT>(std::move(filename))
 {
 }
 
-void LibSNDWrapper::init()
+template<typename SAMPLEFORMAT>
+LibSNDWrapper<SAMPLEFORMAT>::LibSNDWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len)
+: StandardWrapper<SAMPLEFORMAT>(std::move(filename), offset, len)
+{
+}
+
+template<typename SAMPLEFORMAT>
+LibSNDWrapper<SAMPLEFORMAT>::LibSNDWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len, SNDFILE *file, const SF_INFO &info)
+: StandardWrapper<SAMPLEFORMAT>(std::move(filename), offset, len), sndfile(file), sfinfo(info)
+{
+}
+
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::init()
 {
     std::ifstream ifs(this->Filename, std::ios::binary);
     std::array<char, 1<<14> buf;
@@ -49,26 +115,32 @@ void LibSNDWrapper::init()
     }
 }
 
-LibSNDWrapper::~LibSNDWrapper()
+template<typename SAMPLEFORMAT>
+LibSNDWrapper<SAMPLEFORMAT>::~LibSNDWrapper()
 {
     this->releaseBuffer();
     this->close();
 }
 
 
-void LibSNDWrapper::open()
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::open()
 {
     // avoid multiple calls to open()
-    if (this->sndfile != nullptr)
+    if (this->isOpen)
     {
         return;
     }
 
-    memset(&sfinfo, 0, sizeof(sfinfo));
-    if ((this->sndfile = sf_open(this->Filename.c_str(), SFM_READ, &sfinfo)) == nullptr)
+    // unless the file has been opened by OpenLibSNDWrapper() already
+    if (this->sndfile == nullptr)
     {
-        THROW_RUNTIME_ERROR(sf_strerror(nullptr) << " (in File \"" << this->Filename << ")\"");
-    };
+        memset(&sfinfo, 0, sizeof(sfinfo));
+        if ((this->sndfile = sf_open(this->Filename.c_str(), SFM_READ, &sfinfo)) == nullptr)
+        {
+            THROW_RUNTIME_ERROR(sf_strerror(nullptr) << " (in File \"" << this->Filename << ")\"");
+        };
+    }
 
     if (sfinfo.channels < 1)
     {
@@ -81,6 +153,19 @@ void LibSNDWrapper::open()
     this->Format.ConfigureVoices(sfinfo.channels, 2);
     this->Format.SampleRate = sfinfo.samplerate;
 
+    this->isOpen = true;
+
+    if (std::is_same<SAMPLEFORMAT, int16_t>::value)
+    {
+        // 16 bits are enough to hold every sample losslessly, see OpenLibSNDWrapper()
+        if (!IsNarrowSubformat(this->sfinfo.format))
+        {
+            CLOG(LogLevel_t::Warning, "\"" << this->Filename << "\" holds samples of more than 16 bits, they will be truncated");
+        }
+        this->Format.SampleFormat = SampleFormat_t::int16;
+        return;
+    }
+
     // set scale factor for file containing floats as recommended by:
     // http://www.mega-nerd.com/libsndfile/api.html#note2
     switch (this->sfinfo.format & SF_FORMAT_SUBMASK)
@@ -98,16 +183,19 @@ void LibSNDWrapper::open()
     }
 }
 
-void LibSNDWrapper::close() noexcept
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::close() noexcept
 {
     if (this->sndfile != nullptr)
     {
         sf_close(this->sndfile);
         this->sndfile = nullptr;
     }
+    this->isOpen = false;
 }
 
-void LibSNDWrapper::fillBuffer()
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::fillBuffer()
 {
     if (this->data == nullptr)
     {
@@ -117,10 +205,11 @@ void LibSNDWrapper::fillBuffer()
         }
     }
 
-    StandardWrapper::fillBuffer();
+    StandardWrapper<SAMPLEFORMAT>::fillBuffer();
 }
 
-void LibSNDWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender)
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender)
 {
     // what we are doing below is nothing more than efficiently reading audio frames from libsndfile. it got a bit more complex due to
     //   - performance improvements (avoid unnecessary to int conversion if file contains floats)
@@ -130,9 +219,19 @@ void LibSNDWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
     constexpr bool haveInt64 = sizeof(int) == 8;
 
     static_assert(haveInt32 || haveInt64, "sizeof(int) is neither 4 nor 8 bits on your platform");
+    static_assert(sizeof(short) == sizeof(int16_t), "sizeof(short) is not 16 bits on your platform");
 
     const SampleFormat_t cachedFormat = this->Format.SampleFormat;
 
+    if (cachedFormat == SampleFormat_t::int16)
+    {
+        STANDARDWRAPPER_RENDER(
+        int16_t,
+        // samples of at most 16 bits, read shorts, regardless of the size of int
+        sf_read_short(this->sndfile, reinterpret_cast<short *>(pcm), framesToDoNow * Channels))
+        return;
+    }
+
     if (haveInt32)
     {
         // no extra work necessary here, as usual write directly to pcm buffer
@@ -184,7 +283,28 @@ void LibSNDWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels, f
     }
 }
 
-vector<loop_t> LibSNDWrapper::getLoopArray() const noexcept
+template<typename SAMPLEFORMAT>
+bool LibSNDWrapper<SAMPLEFORMAT>::isSeekable() const noexcept
+{
+    return this->sndfile != nullptr && this->sfinfo.seekable;
+}
+
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::seekDecoder(frame_t frame)
+{
+    if (this->fileOffset.hasValue)
+    {
+        frame += msToFrames(this->fileOffset.Value, this->Format.SampleRate);
+    }
+
+    if (sf_seek(this->sndfile, frame, SEEK_SET) < 0)
+    {
+        THROW_RUNTIME_ERROR(sf_strerror(this->sndfile) << " (seeking in File \"" << this->Filename << "\")");
+    }
+}
+
+template<typename SAMPLEFORMAT>
+vector<loop_t> LibSNDWrapper<SAMPLEFORMAT>::getLoopArray() const noexcept
 {
     std::vector<loop_t> res;
 
@@ -224,7 +344,8 @@ vector<loop_t> LibSNDWrapper::getLoopArray() const noexcept
     return res;
 }
 
-frame_t LibSNDWrapper::getFrames() const
+template<typename SAMPLEFORMAT>
+frame_t LibSNDWrapper<SAMPLEFORMAT>::getFrames() const
 {
     int framesAvail = this->sfinfo.frames;
 
@@ -248,7 +369,8 @@ frame_t LibSNDWrapper::getFrames() const
     return totalFrames;
 }
 
-void LibSNDWrapper::buildMetadata() noexcept
+template<typename SAMPLEFORMAT>
+void LibSNDWrapper<SAMPLEFORMAT>::buildMetadata() noexcept
 {
 #define READ_METADATA(name, id)                      \
     if (sf_get_string(this->sndfile, id) != nullptr) \
@@ -262,3 +384,7 @@ void LibSNDWrapper::buildMetadata() noexcept
     READ_METADATA(this->Metadata.Track, SF_STR_TRACKNUMBER);
     READ_METADATA(this->Metadata.Comment, SF_STR_COMMENT);
 }
+
+
+template class LibSNDWrapper<int16_t>;
+template class LibSNDWrapper<sndfile_sample_t>;
@@ -9,13 +9,22 @@
   * class LibSNDWrapper
   *
   * Wrapper for libsndfile, for supporting multiple common audio formats
+  *
+  * files holding samples of at most 16 bits (see OpenLibSNDWrapper()) are played by LibSNDWrapper<int16_t>,
+  * which stores them as int16, everything else by LibSNDWrapper<sndfile_sample_t>, storing either int32 or float
   */
-class LibSNDWrapper : public StandardWrapper<sndfile_sample_t>
+template<typename SAMPLEFORMAT>
+class LibSNDWrapper : public StandardWrapper<SAMPLEFORMAT>
 {
     public:
     LibSNDWrapper(std::string filename);
     LibSNDWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len);
 
+    /**
+     * takes over @p file, which has been opened for @p filename and described by @p info, see OpenLibSNDWrapper()
+     */
+    LibSNDWrapper(std::string filename, Nullable<size_t> offset, Nullable<size_t> len, SNDFILE *file, const SF_INFO &info);
+
     // forbid copying
     LibSNDWrapper(LibSNDWrapper const &) = delete;
     LibSNDWrapper &operator=(LibSNDWrapper const &) = delete;
@@ -36,14 +45,33 @@ class LibSNDWrapper : public StandardWrapper<sndfile_sample_t>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
 
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     void init();
     SNDFILE *sndfile = nullptr;
     SF_INFO sfinfo;
+    // whether this->open() has completed, this->sndfile may already be set by the constructor
+    bool isOpen = false;
     loop_t legacyLoop;
 
 };
 
+/**
+ * opens @p filename by libsndfile and creates the wrapper fitting its samples: LibSNDWrapper<int16_t> if they have at most 16 bits,
+ * i.e. can be stored as int16 without loss, else LibSNDWrapper<sndfile_sample_t>. the file is opened only once, i.e. the
+ * wrapper continues with the SF_INFO found here when being open()ed
+ *
+ * @exceptions throws runtime_error if libsndfile cannot open @p filename
+ */
+Song *OpenLibSNDWrapper(const std::string &filename, Nullable<size_t> offset, Nullable<size_t> len);
+
+extern template class LibSNDWrapper<int16_t>;
+extern template class LibSNDWrapper<sndfile_sample_t>;
+
 #endif // LIBSNDWRAPPER_H
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <cmath>
 #include <cstring>
+#include <sstream>
 #include <thread> // std::this_thread::sleep_for
 #include <utility>
 #include <fstream>
@@ -358,6 +359,27 @@ const MidiLoopInfo* MidiWrapper::getLongestMidiTrackLoop() const
     return max;
 }
 
+std::string MidiWrapper::getCacheParams() const
+{
+    if (!gConfig.PcmCacheMidi || this->synth == nullptr)
+    {
+        return "";
+    }
+
+    const std::string synthParams = this->synth->GetCacheParams();
+    if (synthParams.empty())
+    {
+        return "";
+    }
+
+    // loops may be unrolled into the synthesized PCM
+    std::stringstream ss;
+    ss << synthParams << '|' << this->lastUseLoopInfo << '|' << this->lastOverridingLoopCount << '|' << gConfig.RenderWholeSong
+       << '|' << +gConfig.MidiControllerLoopStart << '|' << +gConfig.MidiControllerLoopStop << '|' << +gConfig.MidiControllerLoopCount;
+
+    return ss.str();
+}
+
 vector<loop_t> MidiWrapper::getLoopArray() const noexcept
 {
     vector<loop_t> loopArr;
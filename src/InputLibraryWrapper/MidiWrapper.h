@@ -71,6 +71,9 @@ class MidiWrapper : public StandardWrapper<float>
 
     vector<loop_t> getLoopArray() const noexcept override;
 
+    protected:
+    std::string getCacheParams() const override;
+
     private:
     smf_t *smf = nullptr;
     FluidsynthWrapper *synth = nullptr;
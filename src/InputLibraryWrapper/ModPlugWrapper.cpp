@@ -5,8 +5,10 @@
 #include "CommonExceptions.h"
 #include "Config.h"
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
+#include <vector>
 #include <errno.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -141,6 +143,33 @@ void ModPlugWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels,
                            framesToDoNow = ret / (Channels * sizeof(int32_t));)
 }
 
+bool ModPlugWrapper::isSeekable() const noexcept
+{
+    return this->handle != nullptr;
+}
+
+void ModPlugWrapper::seekDecoder(frame_t frame)
+{
+    // ModPlug_Seek() only lands approximately at the requested position, since it guesses the pattern row from the
+    // milliseconds given. but it restarts exactly at the beginning, so rewind and decode forward, dropping the frames
+    // before the requested one
+    ModPlug_Seek(this->handle, 0);
+
+    const uint32_t Channels = this->Format.Channels();
+    std::vector<int32_t> scratch(gConfig.FramesToRender * Channels);
+    while (frame > 0 && !this->stopFillBuffer)
+    {
+        const frame_t FramesToDoNow = std::min<frame_t>(frame, gConfig.FramesToRender);
+        int ret = ModPlug_Read(this->handle, scratch.data(), FramesToDoNow * Channels * sizeof(int32_t));
+        if (ret <= 0)
+        {
+            // end of song reached
+            break;
+        }
+        frame -= ret / (Channels * sizeof(int32_t));
+    }
+}
+
 frame_t ModPlugWrapper::getFrames() const
 {
     return msToFrames(this->fileLen.Value, this->Format.SampleRate);
@@ -32,6 +32,11 @@ class ModPlugWrapper : public StandardWrapper<int32_t>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     static ModPlug_Settings settings;
 
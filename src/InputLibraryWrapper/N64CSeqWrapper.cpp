@@ -11,6 +11,7 @@
 #include <cmath>
 #include <cstring>
 #include <fstream>
+#include <sstream>
 #include <thread> // std::this_thread::sleep_for
 #include <utility>
 
@@ -853,6 +854,26 @@ frame_t N64CSeqWrapper::getFrames() const
     return (this->Format.Voices == 0) ? 0 : msToFrames(len, this->Format.SampleRate);
 }
 
+std::string N64CSeqWrapper::getCacheParams() const
+{
+    if (!gConfig.PcmCacheMidi || this->synth == nullptr)
+    {
+        return "";
+    }
+
+    const std::string synthParams = this->synth->GetCacheParams();
+    if (synthParams.empty())
+    {
+        return "";
+    }
+
+    // loops may be unrolled into the synthesized PCM
+    std::stringstream ss;
+    ss << synthParams << '|' << this->lastUseLoopInfo << '|' << this->lastOverridingLoopCount << '|' << gConfig.RenderWholeSong;
+
+    return ss.str();
+}
+
 vector<loop_t> N64CSeqWrapper::getLoopArray() const noexcept
 {
     vector<loop_t> loopArr;
@@ -171,6 +171,9 @@ class N64CSeqWrapper : public StandardWrapper<float>
 
     static void SequencerCallback(unsigned int time, fluid_event_t *e, fluid_sequencer_t *seq, void *data);
 
+    protected:
+    std::string getCacheParams() const override;
+
     private:
     std::vector<unsigned char> fileBuf;
     CSeqState seq;
@@ -76,6 +76,16 @@ void OpenMPTWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels,
                            })
 }
 
+bool OpenMPTWrapper::isSeekable() const noexcept
+{
+    return this->handle != nullptr;
+}
+
+void OpenMPTWrapper::seekDecoder(frame_t frame)
+{
+    this->handle->set_position_seconds(static_cast<double>(frame) / this->Format.SampleRate);
+}
+
 frame_t OpenMPTWrapper::getFrames() const
 {
     return msToFrames(this->fileLen.Value, this->Format.SampleRate);
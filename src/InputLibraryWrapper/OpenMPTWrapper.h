@@ -36,7 +36,12 @@ class OpenMPTWrapper : public StandardWrapper<float>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     openmpt::module *handle = nullptr;
 };
@@ -60,6 +60,8 @@ void Song::buildLoopTree()
         core::tree<loop_t> &subNode = findRootLoopNode(this->loopTree, *it);
         subNode.insert(*it);
     }
+
+    this->loopPlan.compile(this->loopTree);
 }
 
 /**
@@ -78,6 +80,64 @@ void Song::buildMetadata() noexcept
 {
 }
 
+/**
+  * default implementation, for songs not using a ring buffer
+  */
+void Song::setReadPosition(frame_t) noexcept
+{
+}
+
+/**
+  * default implementation, for decoders that can only decode linearly from the beginning
+  */
+bool Song::isSeekable() const noexcept
+{
+    return false;
+}
+
+/**
+  * default implementation, for songs not using a ring buffer
+  */
+void Song::seek(frame_t)
+{
+}
+
+/**
+  * default implementation, for songs that seek synchronously, if at all
+  */
+bool Song::isSeeking() const noexcept
+{
+    return false;
+}
+
+/**
+  * default implementation, for songs that dont keep any frames in memory besides this->data
+  */
+const pcm_t *Song::getResidentPcm(frame_t, size_t &, frame_t &) const noexcept
+{
+    return nullptr;
+}
+
+bool Song::hasResidentLoops() const noexcept
+{
+    return false;
+}
+
+bool Song::isFullyResident() const noexcept
+{
+    return false;
+}
+
+frame_t Song::makeResident(frame_t, frame_t frames)
+{
+    return frames;
+}
+
+bool Song::isBufferComplete()
+{
+    return false;
+}
+
 // should sort descendingly
 bool Song::myLoopSort(loop_t i, loop_t j)
 {
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 
+#include "LoopPlan.h"
 #include "Nullable.h"
 #include "SongFormat.h"
 #include "SongInfo.h"
@@ -59,8 +60,11 @@ class Song
     //--------------------------------------------------------------------
     // RAW PCM Buffer specific area
     //--------------------------------------------------------------------
-    // points to at least "gConfig.FramesToRender" freshly rendered PCM frames,
-    // but usually contains as many as "this->getFrames()" frames of PCM
+    // usually contains as many as "this->getFrames()" frames of PCM
+    //
+    // if it is not possible to hold the whole song in memory, this is a ring buffer holding
+    // count/Format.Channels() frames, where frame f is located at (f * Format.Channels()) % count.
+    // use getFramesRendered() and setReadPosition() to find out which frames are valid
     //
     // PCM will have its channels interleaved, i.e.:
     //    __________________________________________________________________
@@ -108,6 +112,9 @@ class Song
     */
     core::tree<loop_t> loopTree;
 
+    // this->loopTree compiled to a flat list of segments, as it is played by the Player
+    LoopPlan loopPlan;
+
     // holds metadata for this song e.g. title, interpret, album
     SongInfo Metadata;
 
@@ -137,6 +144,8 @@ class Song
      *
      * synchronous part: allocates the pcm buffer and fills it up to have enough for gConfig.PreRenderTime time of playback
      * asynchronous part: fills rest of pcm buffer
+     *
+     * if this->data is a ring buffer, subsequent calls must not block, they only make sure that rendering continues in the background
      */
     virtual void fillBuffer() = 0;
 
@@ -178,8 +187,93 @@ class Song
      */
     virtual frame_t getFramesRendered() const noexcept = 0;
 
+    /**
+     * tells the song that all frames before "frame" have been consumed, i.e. handed over to the audio driver
+     *
+     * if this->data is used as ring buffer, the space occupied by those frames may be reused for rendering
+     * subsequent frames
+     *
+     * function is thread-safe and lock-free
+     */
+    virtual void setReadPosition(frame_t frame) noexcept;
+
+    /**
+     * whether the underlying decoder is able to continue decoding at an arbitrary frame, see this->seek()
+     *
+     * only valid to call while the song is this->open()
+     */
+    virtual bool isSeekable() const noexcept;
+
+    /**
+     * if this->data is a ring buffer, makes the decoder continue rendering at "frame", i.e. the player may
+     * read PCM starting with "frame" once getFramesRendered() exceeds it
+     *
+     * only called if this->isSeekable(); must only be called by the thread consuming the PCM, i.e. the one
+     * calling fillBuffer() and setReadPosition(). if this->data holds the whole song, this is a no-op
+     *
+     * never blocks: unless "frame" has already been rendered, the decoder is repositioned in the background, see this->isSeeking()
+     *
+     * @exceptions throws runtime_error if the decoder failed to seek
+     */
+    virtual void seek(frame_t frame);
+
+    /**
+     * @return true, while the decoder is being repositioned in the background after a call to this->seek(). meanwhile
+     * getFramesRendered() doesnt exceed the frame seeked to
+     *
+     * function is thread-safe and lock-free
+     */
+    virtual bool isSeeking() const noexcept;
+
+    /**
+     * if this->data is a ring buffer, some frames (i.e. the loops of this song) may additionally be kept in memory
+     * once they have been decoded
+     *
+     * @param frame the frame requested
+     * @param itemOffset receives the offset of "frame" within the returned buffer, in items
+     * @param framesAvailable receives the number of frames available in the returned buffer, starting with "frame"
+     *
+     * @return the buffer holding "frame", nullptr if "frame" is not being kept in memory. if this->isFullyResident(), nullptr
+     * rather means "frame" is not available yet, e.g. because it is still being decompressed in the background
+     *
+     * function is thread-safe
+     */
+    virtual const pcm_t *getResidentPcm(frame_t frame, size_t &itemOffset, frame_t &framesAvailable) const noexcept;
+
+    /**
+     * @return true, if the loops of this->loopTree are kept in memory, see getResidentPcm(). in this case loops can be
+     * played even though this->data is a ring buffer and this song is not seekable
+     */
+    virtual bool hasResidentLoops() const noexcept;
+
+    /**
+     * @return true, if every frame of this song is available via getResidentPcm() once it has been decoded, although
+     * this->data doesnt hold the whole song (e.g. because it is kept compressed). such songs can be seeked and
+     * looped regardless of this->isSeekable()
+     */
+    virtual bool isFullyResident() const noexcept;
+
+    /**
+     * if this->data holds the whole song, parts of it may have been handed back to the OS meanwhile (see gConfig.useMadvFree).
+     * makes sure the frames starting at @p frame can be read from this->data, decoding them again in the background if necessary.
+     * never waits for the decoder, thus may be called from the playback thread
+     *
+     * @return the number of frames, at most @p frames, that can be read from this->data right now, 0 if the frame at @p frame
+     * is still being decoded again
+     */
+    virtual frame_t makeResident(frame_t frame, frame_t frames);
+
+    /**
+     * @return true, if this->data holds the whole song completely decoded and nothing is being rendered in the background anymore.
+     * such a buffer stays valid after this->close(), thus it may be retained by the PcmBudget, so that playing this song again
+     * doesnt require decoding it again
+     */
+    virtual bool isBufferComplete();
+
     /**
      * public helper method for building up the this->loopTree, by requesting looparrays via this->getLoopArray()
+     * 
+     * also compiles this->loopPlan from it
      */
     void buildLoopTree();
 
@@ -2,20 +2,36 @@
 
 #include "AtomicWrite.h"
 #include "Common.h"
+#include "CommonExceptions.h"
+#include "DecoderPool.h"
 #include "LoudnessFile.h"
+#include "PcmBudget.h"
+#include "PcmCache.h"
+#include "PcmCodec.h"
+#include "RenderPolicy.h"
 
-#include <utility> // std::swap
-#include <cstdio> // std::tmpfile
+#include <algorithm>
 #include <cstring>
+#include <sstream>
+#include <typeinfo>
 
 #ifdef _POSIX_C_SOURCE
 #include <unistd.h> // _POSIX_MAPPED_FILES
 #include <errno.h>
 #include <sys/mman.h>
-#include <fcntl.h> // posix_fallocate()
 #include <linux/version.h>
 #endif
 
+#if defined(_POSIX_C_SOURCE) && _POSIX_MAPPED_FILES && _POSIX_C_SOURCE >= 200112L && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
+#define STANDARDWRAPPER_MADV_FREE 1
+#endif
+
+// songs shorter than that many blocks are never kept compressed, the few bytes saved arent worth the effort
+constexpr frame_t CompressMinBlocks = 16;
+
+// granularity of pinning and freeing the pages of a song held in memory as a whole, see PagedPcm
+constexpr size_t PagedChunkBytes = 64 * 1024;
+
 template<typename SAMPLEFORMAT>
 StandardWrapper<SAMPLEFORMAT>::StandardWrapper(std::string filename)
 : Song(filename)
@@ -48,58 +64,28 @@ SAMPLEFORMAT* StandardWrapper<SAMPLEFORMAT>::allocPcmBuffer(size_t items) noexce
 
     size_t length = items * sizeof(SAMPLEFORMAT);
 
+    const int flags = MAP_ANONYMOUS | MAP_PRIVATE;
+
+    // Prefer to use mmap, because it ensures that the application always sees zero initialized
+    // memory. File backed mappings are only used for songs kept in the PcmCache, see fillBuffer()
+    void* data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED)
     {
-        int fd = -1;
-        int flags = MAP_ANONYMOUS | MAP_PRIVATE;
-        std::unique_ptr<std::FILE, decltype(&std::fclose)> tmp(nullptr, std::fclose);
-// uncomment to use a file backed mapping
-#if 0
-        tmp.reset(std::tmpfile());
-        if (tmp != nullptr)
-        {
-            fd = ::fileno(tmp.get());
-            int ret = ::posix_fallocate(fd, 0, length);
-            if (ret == 0)
-            {
-                flags = MAP_SHARED;
-            }
-            else
-            {
-                fd = -1;
-                CLOG(LogLevel_t::Debug, "posix_fallocate() failed: " << strerror(errno));
-            }
-        }
-        else
-        {
-            CLOG(LogLevel_t::Debug, "std::tmpfile() failed: " << strerror(errno));
-        }
-#endif
-        // Prefer to use mmap, because it ensures that the application always sees zero initialized
-        // memory. It also supports backing files, which however might shortening life of SSDs, thus
-        // it's disabled for now
-        void* data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, fd, 0);
-        if (data == MAP_FAILED)
+        CLOG(LogLevel_t::Debug, "MAP_HUGETLB failed, trying again without it: " << strerror(errno));
+        // try again without huge pages
+        data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+    }
+    if (data != MAP_FAILED)
+    {
+        if (::madvise(data, length, MADV_DONTDUMP) != 0)
         {
-            CLOG(LogLevel_t::Debug, "MAP_HUGETLB failed, trying again without it: " << strerror(errno));
-            // try again without huge pages
-            data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+            CLOG(LogLevel_t::Debug, "madvise(MADV_DONTDUMP) failed: " << strerror(errno));
         }
-        if (data != MAP_FAILED)
-        {
-            if (::madvise(data, length, MADV_DONTDUMP) != 0)
-            {
-                CLOG(LogLevel_t::Debug, "madvise(MADV_DONTDUMP) failed: " << strerror(errno));
-            }
 
-            this->backingFile = tmp.release();
-            return static_cast<SAMPLEFORMAT*>(data);
-        }
-        else
-        {
-            CLOG(LogLevel_t::Debug, "mmap() failed: " << strerror(errno));
-        }
-    } // tmp is being closed and will be deleted after closed
+        return static_cast<SAMPLEFORMAT*>(data);
+    }
 
+    CLOG(LogLevel_t::Debug, "mmap() failed: " << strerror(errno));
     return nullptr;
 #else
 
@@ -108,11 +94,32 @@ SAMPLEFORMAT* StandardWrapper<SAMPLEFORMAT>::allocPcmBuffer(size_t items) noexce
 #endif
 }
 
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::freePcmBuffer(SAMPLEFORMAT *buf, size_t items) noexcept
+{
+    if (buf == nullptr)
+    {
+        return;
+    }
+
+#if _POSIX_MAPPED_FILES && _POSIX_C_SOURCE >= 200112L
+    if (::munmap(buf, items * sizeof(SAMPLEFORMAT)) != 0)
+    {
+        CLOG(LogLevel_t::Error, "munmap() failed: " << strerror(errno));
+    }
+#else
+    delete[] buf;
+#endif
+}
+
 /**
  * @brief manages that Song::data holds new PCM
  *
  * this method trys to alloc a buffer that is big enough to hold the whole PCM of whatever audiofile in memory
- * if this fails it trys to allocate a buffer big enough to hold gConfig.FramesToRender frames and fills this with new PCM on each call
+ * if the song has been played before and its PCM is still in the PcmCache, that PCM is mapped instead, without decoding anything
+ * if gConfig.CompressWholeSong, the whole song is held in memory compressed instead, see getResidentPcm()
+ * if this fails it trys to allocate a ring buffer big enough to hold gConfig.RenderAheadTime of PCM, which is
+ * continuously filled on the decoder threads, while the player consumes it
  *
  * if even that allocation fails, an exception will be thrown
  */
@@ -122,12 +129,30 @@ void StandardWrapper<SAMPLEFORMAT>::fillBuffer()
     const auto Channels = this->Format.Channels();
     const auto TotalFrames = this->getFrames();
 
-    if (this->count == static_cast<size_t>(TotalFrames) * Channels)
+    if (this->compressed != nullptr)
+    {
+        if (this->compressed->frames == TotalFrames && this->count == static_cast<size_t>(PcmBlockFrames) * Channels)
+        {
+            // the song is being compressed in the background, the player gets it via getResidentPcm()
+            return;
+        }
+
+        // retained, but the song has changed meanwhile
+        this->releaseBuffer();
+    }
+    else if (this->ringFrames == 0 && this->count == static_cast<size_t>(TotalFrames) * Channels)
     {
         // Song::data already filled up with all the audiofile's PCM, nothing to do here (most likely case)
         return;
     }
-    else if (this->count == 0) // no buffer allocated?
+    else if (this->ringFrames == 0 && this->count != 0)
+    {
+        // the PCM has been retained since the song was played last time, but the song has changed meanwhile
+        // (e.g. because of a different loop count), thus it needs to be rendered again
+        this->releaseBuffer();
+    }
+
+    if (this->count == 0) // no buffer allocated?
     {
         if (!this->Format.IsValid())
         {
@@ -138,30 +163,145 @@ void StandardWrapper<SAMPLEFORMAT>::fillBuffer()
         // and releaseBuffer already waits for the render thread to finish... however it doesnt hurt
         WAIT(this->futureFillBuffer);
 
-        size_t itemsToAlloc = 0;
-        if (gConfig.RenderWholeSong)
+        size_t itemsToAlloc = TotalFrames * Channels;
+
+        // if the song has been played before, it doesnt need to be decoded at all, regardless of whether we should render the whole song
+        this->cacheKey = this->getCacheKey();
+        if (!this->cacheKey.empty())
+        {
+            void *cached = PcmCache::Singleton().open(this->cacheKey, itemsToAlloc * sizeof(SAMPLEFORMAT));
+            if (cached != nullptr)
+            {
+                CLOG(LogLevel_t::Debug, "Using cached PCM of \"" << this->Filename << "\"" << std::endl);
+                PcmBudget::Singleton().reserve(this, itemsToAlloc * sizeof(SAMPLEFORMAT));
+                this->data = cached;
+                this->count = itemsToAlloc;
+                this->framesAlreadyRendered = TotalFrames;
+                return;
+            }
+        }
+
+        // depending on the memory left, hold the whole song, only its loops or nothing at all in memory
+        size_t loopBytes = 0;
+        if (gConfig.RenderLoopsResident)
+        {
+            for (core::tree<loop_t>::iterator it = this->loopTree.begin(); it != this->loopTree.end(); ++it)
+            {
+                const loop_t &loop = *it;
+                loopBytes += static_cast<size_t>(loop.stop - loop.start) * Channels * sizeof(SAMPLEFORMAT);
+            }
+        }
+        const RenderPolicy::Mode mode = RenderPolicy::Singleton().decide(itemsToAlloc * sizeof(SAMPLEFORMAT), loopBytes);
+        const bool wholeSong = gConfig.RenderWholeSong && mode == RenderPolicy::Mode::WholeSong;
+        if (gConfig.RenderWholeSong && !wholeSong)
+        {
+            const RenderPolicy::Stats policy = RenderPolicy::Singleton().getStats();
+            CLOG(LogLevel_t::Info, "Memory pressure " << RenderPolicy::ToString(policy.pressure) << ", " << policy.available / (1024 * 1024) << " MiB available: \"" << this->Filename << "\" will be " << RenderPolicy::ToString(mode) << "." << std::endl);
+        }
+
+        if (wholeSong && gConfig.CompressWholeSong && this->allocCompressed(Channels, TotalFrames))
+        {
+            // compressed PCM is never cached
+            this->cacheKey.clear();
+
+            // (pre-)render the first few milliseconds
+            frame_t firstFrames = (gConfig.PreRenderTime == 0) ? TotalFrames : msToFrames(gConfig.PreRenderTime, this->Format.SampleRate);
+            this->renderCompressed(Channels, (firstFrames + PcmBlockFrames - 1) / PcmBlockFrames);
+
+            // render and compress the rest in slices of about one second
+            const frame_t RestBlocks = (TotalFrames - this->framesAlreadyRendered + PcmBlockFrames - 1) / PcmBlockFrames;
+            const frame_t BlocksPerTask = std::max<frame_t>(1, msToFrames(1000, this->Format.SampleRate) / PcmBlockFrames);
+            for (frame_t b = 0; b < RestBlocks; b += BlocksPerTask)
+            {
+                this->futureFillBuffer = DecoderPool::Singleton().submit(this, [this, Channels, BlocksPerTask]() {
+                    this->renderCompressed(Channels, BlocksPerTask);
+                });
+            }
+            return;
+        }
+
+        const bool fitsBudget = wholeSong && PcmBudget::Singleton().tryReserve(this, itemsToAlloc * sizeof(SAMPLEFORMAT));
+        if (wholeSong && !fitsBudget)
         {
-            itemsToAlloc = TotalFrames * Channels;
+            CLOG(LogLevel_t::Info, "Holding \"" << this->Filename << "\" in memory would exceed the PCM budget, it will be streamed." << std::endl);
+        }
+
+        if (fitsBudget)
+        {
+            // try to alloc a buffer to hold the whole song's pcm in memory, if possible backed by a new entry of the cache
+            if (!this->cacheKey.empty())
+            {
+                this->data = PcmCache::Singleton().create(this->cacheKey, itemsToAlloc * sizeof(SAMPLEFORMAT), this->cacheTmpFile);
+            }
+            if (this->data == nullptr)
+            {
+                this->cacheKey.clear();
+                this->data = this->allocPcmBuffer(itemsToAlloc);
+            }
+            if (this->data == nullptr)
+            {
+                PcmBudget::Singleton().unreserve(this, itemsToAlloc * sizeof(SAMPLEFORMAT));
+            }
 
-            // try to alloc a buffer to hold the whole song's pcm in memory
-            this->data = this->allocPcmBuffer(itemsToAlloc);
             if (this->data != nullptr) // buffer successfully allocated, fill it asynchronously
             {
                 this->count = itemsToAlloc;
 
+#ifdef STANDARDWRAPPER_MADV_FREE
+                // pages reclaimed by the kernel can only be restored by decoding them again
+                if ((gConfig.useMadvFree || gConfig.useMemoryPressure) && this->cacheKey.empty() && this->isSeekable())
+                {
+                    const size_t Bytes = itemsToAlloc * sizeof(SAMPLEFORMAT);
+                    const size_t PageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+                    const frame_t AheadFrames = msToFrames(gConfig.RenderAheadTime, this->Format.SampleRate);
+
+                    auto p = std::make_unique<PagedPcm>();
+                    p->pageSize = PageSize;
+                    p->chunkBytes = std::max(PageSize, PagedChunkBytes / PageSize * PageSize);
+                    p->chunks = (Bytes + p->chunkBytes - 1) / p->chunkBytes;
+                    p->lookahead = std::max<size_t>(2, (AheadFrames * Channels * sizeof(SAMPLEFORMAT) + p->chunkBytes - 1) / p->chunkBytes);
+                    p->pinned.reset(new std::atomic<bool>[p->chunks]);
+                    for (size_t c = 0; c < p->chunks; c++)
+                    {
+                        p->pinned[c] = true;
+                    }
+                    this->paged = std::move(p);
+                }
+#endif
+
                 // (pre-)render the first few milliseconds
                 frame_t firstFrames = (gConfig.PreRenderTime == 0) ? TotalFrames : msToFrames(gConfig.PreRenderTime, this->Format.SampleRate);
                 this->render(this->data, Channels, firstFrames);
 
                 // immediatly start filling the rest of the pcm buffer
                 frame_t restFrames = TotalFrames - this->framesAlreadyRendered;
-                if(restFrames > 0)
+                if (restFrames == 0)
                 {
-                    /* advance the pcm pointer by that many items where we previously ended filling it */
-                    SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(this->data);
-                    pcm += (this->framesAlreadyRendered * Channels);
+                    this->commitCached();
+                    this->allowReclaim();
+                }
+                else
+                {
+                    // render the rest in slices of about one second, so that the decoder threads can serve other songs in between
+                    const frame_t FramesPerTask = std::max(gConfig.FramesToRender, msToFrames(1000, this->Format.SampleRate));
+                    for (frame_t f = 0; f < restFrames; f += FramesPerTask)
+                    {
+                        const bool isLast = f + FramesPerTask >= restFrames;
+                        this->futureFillBuffer = DecoderPool::Singleton().submit(this, [this, Channels, FramesPerTask, isLast]() {
+                            /* advance the pcm pointer by that many items where we previously ended filling it */
+                            SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(this->data);
+                            pcm += (this->framesAlreadyRendered * Channels);
 
-                    this->futureFillBuffer = std::async(std::launch::async, &StandardWrapper::renderAsync, this, pcm, Channels, restFrames /*render everything*/);
+                            if (isLast)
+                            {
+                                this->renderAsync(pcm, Channels, FramesPerTask);
+                            }
+                            else
+                            {
+                                this->render(pcm, Channels, FramesPerTask);
+                            }
+                        });
+                    }
 
                     // allow the render thread to do his work
                     std::this_thread::yield();
@@ -170,24 +310,32 @@ void StandardWrapper<SAMPLEFORMAT>::fillBuffer()
             }
         }
 
+        // the ring buffer is never cached
+        this->cacheKey.clear();
+
         // well either we shall not render whole song once or something went wrong during alloc (not enough memory??)
-        // so try to alloc at least enough to do double buffering
+        // so try to alloc at least a ring buffer, whose size is a multiple of FramesToRender
         // if this fails too, an exception will be thrown
-        itemsToAlloc = gConfig.FramesToRender * Channels;
+        const frame_t Chunk = gConfig.FramesToRender;
+        frame_t ring = std::max(msToFrames(gConfig.RenderAheadTime, this->Format.SampleRate), 2 * Chunk);
+        ring += (Chunk - ring % Chunk) % Chunk;
+        itemsToAlloc = ring * Channels;
 
         try
         {
-            auto len = itemsToAlloc * 2;
-            SAMPLEFORMAT* tmp = this->allocPcmBuffer(len);
+            SAMPLEFORMAT* tmp = this->allocPcmBuffer(itemsToAlloc);
             if(tmp == nullptr)
             {
                 throw std::bad_alloc();
             }
+            PcmBudget::Singleton().reserve(this, itemsToAlloc * sizeof(SAMPLEFORMAT));
             this->data = tmp;
-            this->preRenderBuf = tmp + itemsToAlloc;
             this->count = itemsToAlloc;
+            this->ringFrames = ring;
+            this->ringChunk = Chunk;
+            this->readPosition = 0;
 
-            len *= sizeof(SAMPLEFORMAT);
+            auto len = itemsToAlloc * sizeof(SAMPLEFORMAT);
             if(!::PageLockMemory(tmp, len))
             {
                 CLOG(LogLevel_t::Info, "Failed to page-lock " << len << " bytes of memory, swapping possible." << std::endl);
@@ -203,46 +351,497 @@ void StandardWrapper<SAMPLEFORMAT>::fillBuffer()
             throw;
         }
 
-        this->render(this->data, Channels, gConfig.FramesToRender);
+        if (mode != RenderPolicy::Mode::Streaming)
+        {
+            this->allocResidentRegions(Channels);
+        }
+
+        this->render(this->data, Channels, Chunk);
+        this->keepResident(static_cast<SAMPLEFORMAT *>(this->data), Channels, 0, this->framesAlreadyRendered);
+    }
+
+    // only a ring buffer allocated: never block here, just make sure the decoder keeps running ahead of the player
+    this->renderAhead(Channels);
+}
+
+/**
+ * Prepares keeping the whole song compressed: this->data becomes the buffer a single block is rendered to, before
+ * it gets compressed.
+ *
+ * @return false if the song is too short or allocating failed, in which case it shall be held uncompressed
+ */
+template<typename SAMPLEFORMAT>
+bool StandardWrapper<SAMPLEFORMAT>::allocCompressed(const uint32_t Channels, const frame_t TotalFrames) noexcept
+{
+    if (TotalFrames < CompressMinBlocks * PcmBlockFrames)
+    {
+        return false;
     }
-    else // only small buffer allocated, i.e. this->count == gConfig.FramesToRender * this->Format.Channels
+
+    const size_t BlockItems = static_cast<size_t>(PcmBlockFrames) * Channels;
+
+    std::unique_ptr<CompressedPcm> c;
+    try
     {
-        WAIT(this->futureFillBuffer);
+        c = std::make_unique<CompressedPcm>();
+        c->blocks.resize((TotalFrames + PcmBlockFrames - 1) / PcmBlockFrames);
+        c->window.reset(new SAMPLEFORMAT[2 * BlockItems]);
+    }
+    catch (const std::bad_alloc &e)
+    {
+        return false;
+    }
+
+    SAMPLEFORMAT *pcm = this->allocPcmBuffer(BlockItems);
+    if (pcm == nullptr)
+    {
+        return false;
+    }
+
+    // the block buffer and the window are needed anyway, the blocks are accounted once they are compressed
+    PcmBudget::Singleton().reserve(this, 3 * BlockItems * sizeof(SAMPLEFORMAT));
+
+    c->frames = TotalFrames;
+    this->compressed = std::move(c);
+    this->data = pcm;
+    this->count = BlockItems;
+    return true;
+}
+
+/**
+ * Renders up to @p blocks blocks to this->data, compresses them one by one and appends them to this->compressed.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::renderCompressed(const uint32_t Channels, frame_t blocks)
+{
+    CompressedPcm &c = *this->compressed;
+    SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(this->data);
+
+    for (; blocks > 0 && !this->stopFillBuffer && this->framesAlreadyRendered < c.frames; blocks--)
+    {
+        const frame_t Start = this->framesAlreadyRendered;
+        const frame_t Frames = std::min(PcmBlockFrames, c.frames - Start);
+
+        // a block must be complete before compressing it, regardless of how many frames the decoder returns at once
+        while (!this->stopFillBuffer && this->framesAlreadyRendered < Start + Frames)
+        {
+            const frame_t Done = this->framesAlreadyRendered - Start;
+            this->render(pcm + Done * Channels, Channels, Frames - Done);
+
+            if (!this->stopFillBuffer && this->framesAlreadyRendered == Start + Done)
+            {
+                // the decoder ran dry before reaching getFrames(), pad with silence
+                std::fill(pcm + Done * Channels, pcm + Frames * Channels, SAMPLEFORMAT{});
+                this->framesAlreadyRendered = Start + Frames;
+            }
+        }
+        if (this->stopFillBuffer)
+        {
+            break;
+        }
+
+        std::vector<uint8_t> &block = c.blocks[Start / PcmBlockFrames];
+        PcmEncodeBlock(pcm, Channels, Frames, block);
+        block.shrink_to_fit();
+        PcmBudget::Singleton().reserve(this, block.size());
+        c.bytes += block.size();
+
+        // publish the block to the player
+        c.framesCompressed = Start + Frames;
+
+        if (c.framesCompressed == c.frames)
+        {
+            const size_t Uncompressed = static_cast<size_t>(c.frames) * Channels * sizeof(SAMPLEFORMAT);
+            CLOG(LogLevel_t::Debug, "Compressed PCM of \"" << this->Filename << "\" from " << Uncompressed << " to " << c.bytes << " bytes (" << (100.0 * c.bytes / Uncompressed) << " %)" << std::endl);
+        }
+    }
+}
+
+/**
+ * Decompresses @p block of this->compressed to its slot of the window, unless the player is reading another block from that slot.
+ *
+ * Must only be called on the decoder threads.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::decompressBlock(frame_t block) const noexcept
+{
+    CompressedPcm &c = *this->compressed;
+    const uint32_t Channels = this->Format.Channels();
+    const frame_t Slot = block % 2;
+
+    // invalidate the slot before looking at the block being played: getResidentPcm() claims its block before looking at the slot,
+    // so either we notice the claim or the player notices the slot being invalid
+    const frame_t Old = c.windowBlock[Slot].exchange(-1);
+    const frame_t Playing = c.playingBlock;
+    if (Old == block || (Playing != block && Playing >= 0 && Playing % 2 == Slot))
+    {
+        c.windowBlock[Slot] = Old;
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const frame_t Frames = std::min(PcmBlockFrames, c.frames - block * PcmBlockFrames);
+    PcmDecodeBlock(c.blocks[block].data(), Channels, Frames, c.window.get() + Slot * PcmBlockFrames * Channels);
+    c.windowBlock[Slot] = block;
+
+    c.blocksDecompressed++;
+    c.decompressTime += std::chrono::steady_clock::now() - start;
+}
+
+/**
+ * Decompresses the blocks [@p first, @p last) of this->compressed on the decoder threads, unless they are still busy with the blocks
+ * requested last time.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::decompressAsync(frame_t first, frame_t last) const noexcept
+{
+    CompressedPcm &c = *this->compressed;
+    if (c.futureDecompress.valid() && c.futureDecompress.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    try
+    {
+        c.futureDecompress = DecoderPool::Singleton().submit(&c, [this, first, last]() {
+            for (frame_t b = first; b < last; b++)
+            {
+                this->decompressBlock(b);
+            }
+        });
+    }
+    catch (const std::exception &e)
+    {
+        // the player will ask again
+    }
+}
+
+/**
+ * In case this->data is a ring buffer, allocates buffers for the outermost loops of the song, so they can be played
+ * without decoding them again. They are filled by keepResident() whenever the decoder passes them.
+ *
+ * If this fails, the loops are simply streamed like the rest of the song.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::allocResidentRegions(const uint32_t Channels) noexcept
+{
+    if (!gConfig.RenderLoopsResident)
+    {
+        return;
+    }
+
+    size_t bytes = 0;
+    for (core::tree<loop_t>::iterator it = this->loopTree.begin(); it != this->loopTree.end(); ++it)
+    {
+        const loop_t &loop = *it;
+        const size_t items = static_cast<size_t>(loop.stop - loop.start) * Channels;
+
+        SAMPLEFORMAT *pcm = nullptr;
+        if (PcmBudget::Singleton().tryReserve(this, items * sizeof(SAMPLEFORMAT)))
+        {
+            pcm = this->allocPcmBuffer(items);
+            if (pcm == nullptr)
+            {
+                PcmBudget::Singleton().unreserve(this, items * sizeof(SAMPLEFORMAT));
+            }
+        }
+
+        if (pcm == nullptr)
+        {
+            CLOG(LogLevel_t::Info, "Failed to allocate " << items * sizeof(SAMPLEFORMAT) << " bytes for keeping the loops of \"" << this->Filename << "\" in memory, they will be streamed." << std::endl);
 
-        // data is the consumed pcm buffer, preRenderBuf holds fresh pcm
-        std::swap(this->data, this->preRenderBuf);
+            for (ResidentRegion &r : this->residentRegions)
+            {
+                ::PageUnlockMemory(r.pcm, (r.stop - r.start) * Channels * sizeof(SAMPLEFORMAT));
+                this->freePcmBuffer(r.pcm, (r.stop - r.start) * Channels);
+            }
+            PcmBudget::Singleton().unreserve(this, bytes);
+            this->residentRegions.clear();
+            return;
+        }
+
+        ::PageLockMemory(pcm, items * sizeof(SAMPLEFORMAT));
+        this->residentRegions.emplace_back(loop.start, loop.stop, pcm);
+        bytes += items * sizeof(SAMPLEFORMAT);
+    }
+
+    if (!this->residentRegions.empty())
+    {
+        CLOG(LogLevel_t::Debug, "Keeping " << this->residentRegions.size() << " loops (" << bytes << " bytes) of \"" << this->Filename << "\" in memory." << std::endl);
+    }
+}
+
+/**
+ * Copies the frames [from, to), which have just been rendered to @p pcm, to those resident regions, that are waiting for them.
+ *
+ * A region is only ever filled contiguously from its start, so frames are kept only, if the decoder passed all
+ * frames of the region before as well.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::keepResident(const SAMPLEFORMAT *pcm, const uint32_t Channels, frame_t from, frame_t to) noexcept
+{
+    for (ResidentRegion &r : this->residentRegions)
+    {
+        const frame_t next = r.start + r.rendered;
+        if (next < from || next >= to || next >= r.stop)
+        {
+            continue;
+        }
+
+        const frame_t last = std::min(to, r.stop);
+        std::copy(pcm + (next - from) * Channels, pcm + (last - from) * Channels, r.pcm + (next - r.start) * Channels);
+        r.rendered = last - r.start;
     }
+}
+
+/**
+ * In case this->data is a ring buffer, starts filling its free space on the decoder threads, unless already doing so.
+ *
+ * Must only be called by the consumer of the ring buffer, i.e. the thread calling fillBuffer().
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::renderAhead(const uint32_t Channels)
+{
+    const frame_t Chunk = this->ringChunk;
+    const frame_t Free = this->ringFrames - (this->framesAlreadyRendered - this->readPosition);
+    if (this->isRenderingAhead || this->isSeeking() || this->framesAlreadyRendered >= this->getFrames() || Free < Chunk)
+    {
+        return;
+    }
+
+    // the previous task has already finished, since isRenderingAhead is false, so this doesnt block
+    WAIT(this->futureFillBuffer);
+
+    this->isRenderingAhead = true;
+    this->futureFillBuffer = DecoderPool::Singleton().submit(this, [this, Channels, Chunk]() {
+        while (!this->stopFillBuffer && this->framesAlreadyRendered < this->getFrames())
+        {
+            const frame_t Written = this->framesAlreadyRendered;
+            if (this->ringFrames - (Written - this->readPosition) < Chunk)
+            {
+                // ring buffer is full, the player will kick us again once it consumed some PCM
+                break;
+            }
+
+            // render contiguously up to the end of the ring buffer; since its size is a multiple of Chunk, this is always a full Chunk,
+            // unless the song has been seeked to a frame that is not aligned to Chunk
+            const frame_t Pos = Written % this->ringFrames;
+            const frame_t FramesToDo = std::min(Chunk, this->ringFrames - Pos);
+            SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(this->data) + Pos * Channels;
+            this->render(pcm, Channels, FramesToDo);
 
-    this->futureFillBuffer = std::async(std::launch::async, &StandardWrapper::renderAsync, this, this->preRenderBuf, Channels, gConfig.FramesToRender);
+            if (!this->stopFillBuffer && this->framesAlreadyRendered == Written)
+            {
+                // the decoder ran dry before reaching getFrames(), pad with silence so the player doesnt wait forever
+                const frame_t Frames = std::min(FramesToDo, this->getFrames() - Written);
+                std::fill(pcm, pcm + Frames * Channels, SAMPLEFORMAT{});
+                this->framesAlreadyRendered += Frames;
+            }
+
+            this->keepResident(pcm, Channels, Written, this->framesAlreadyRendered);
+        }
+
+        this->isRenderingAhead = false;
+    });
 }
 
 /**
- * The purpose of renderAsync is to forward the polymorphic call to this->render(), since we cannot make polymorphic calls in std::async().
+ * Renders the last chunk of PCM on one of the decoder threads. If this->data holds the whole song, it afterwards gets marked as freeable.
  */
 template<typename SAMPLEFORMAT>
 void StandardWrapper<SAMPLEFORMAT>::renderAsync(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender)
 {
     this->render(bufferToFill, Channels, framesToRender);
+    this->commitCached();
+    this->allowReclaim();
+}
 
-#if defined(_POSIX_C_SOURCE) && _POSIX_MAPPED_FILES && _POSIX_C_SOURCE >= 200112L && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
-    if (this->preRenderBuf == nullptr && gConfig.useMadvFree)
+/**
+ * If this->data holds the whole song, which has been rendered completely, lets the kernel reclaim its pages, except for the ones
+ * around the playhead. Reclaimed pages are decoded again by makeResident(), before being played.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::allowReclaim() noexcept
+{
+#ifdef STANDARDWRAPPER_MADV_FREE
+    // only set up for songs held in memory as a whole, that are not kept in the PcmCache (which are backed by a file anyway)
+    if (this->paged == nullptr || this->paged->active || this->framesAlreadyRendered != this->getFrames())
+    {
+        return;
+    }
+    PagedPcm &p = *this->paged;
+
+    // without useMadvFree, the song is only downgraded like this if the system is thrashing
+    if (!gConfig.useMadvFree && RenderPolicy::Singleton().poll() != RenderPolicy::Pressure::High)
+    {
+        return;
+    }
+
+    // If we allocated a PCM buffer for the whole file, advice the kernel to free related pages when the system comes under memory pressure.
+    // This avoids triggering the OOM killer and prevents potentially heavy disk activity leading to system unresponsiveness.
+    //
+    // To achieve this, we use the Linux specific MADV_FREE. On a proper POSIX compliant OS one would use MADV_DONTNEED. Linux,
+    // unfortunately implements MADV_DONTNEED in the same broken way as TRU64. See the following links for further reading:
+    //
+    // http://linux-kernel.2935.n7.nabble.com/wrong-madvise-MADV-DONTNEED-semantic-td18033.html
+    // https://www.youtube.com/watch?v=bg6-LVCHmGM&feature=youtu.be&t=3518
+    // https://stackoverflow.com/q/14968309
+    //
+    // Although MADV_FREE is available since linux 4.5, we require at least 4.12, because (madvise man page):
+    // "In Linux before version 4.12, when freeing pages on a swapless system, the pages in the given range are freed instantly, regardless of memory pressure."
+    const size_t Bytes = this->count * sizeof(SAMPLEFORMAT);
+    const uint8_t *pcm = static_cast<const uint8_t *>(this->data);
+
+    // a reclaimed page reads as zeros, which only needs to be noticed, if it held anything else
+    try
+    {
+        p.pageHasData.resize((Bytes + p.pageSize - 1) / p.pageSize);
+    }
+    catch (const std::bad_alloc &e)
+    {
+        return;
+    }
+    for (size_t i = 0; i < p.pageHasData.size(); i++)
+    {
+        const uint8_t *page = pcm + i * p.pageSize;
+        const size_t len = std::min(p.pageSize, Bytes - i * p.pageSize);
+        p.pageHasData[i] = std::any_of(page, page + len, [](uint8_t b) { return b != 0; });
+    }
+
+    // the player may be reading the chunks around the playhead right now, they stay pinned
+    const size_t Current = static_cast<size_t>(this->readPosition) * this->Format.Channels() * sizeof(SAMPLEFORMAT) / p.chunkBytes;
+    p.active = true;
+    for (size_t c = 0; c < p.chunks; c++)
+    {
+        if (c + 1 < Current || c > Current + p.lookahead)
+        {
+            this->freeChunk(c);
+        }
+    }
+#endif
+}
+
+/**
+ * Pins the chunks of this->paged from @p chunk on, as far as the player may read soon, and frees all other ones.
+ *
+ * Must only be called on the decoder threads.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::pageAround(size_t chunk)
+{
+    PagedPcm &p = *this->paged;
+
+    if (chunk != p.chunk)
+    {
+        // the playhead moved on meanwhile, the task queued for its new chunk does the job
+        return;
+    }
+
+    const size_t Last = std::min(p.chunks - 1, chunk + p.lookahead);
+    for (size_t c = chunk; c <= Last && !this->stopFillBuffer && chunk == p.chunk; c++)
+    {
+        if (!p.pinned[c])
+        {
+            this->pinChunk(c);
+        }
+    }
+
+    for (size_t c = 0; c < p.chunks; c++)
+    {
+        if (p.pinned[c] && (c + 1 < chunk || c > Last))
+        {
+            this->freeChunk(c);
+        }
+    }
+}
+
+/**
+ * Keeps the kernel from reclaiming the pages of @p chunk and decodes it again, if any of them has been reclaimed already.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::pinChunk(size_t chunk)
+{
+    PagedPcm &p = *this->paged;
+    uint8_t *pcm = static_cast<uint8_t *>(this->data);
+
+    const size_t Begin = chunk * p.chunkBytes;
+    const size_t End = std::min(Begin + p.chunkBytes, this->count * sizeof(SAMPLEFORMAT));
+
+    bool reclaimed = false;
+    for (size_t off = Begin; off < End; off += p.pageSize)
     {
-        // If we allocated a PCM buffer for the whole file, advice the kernel to free related pages when the system comes under memory pressure.
-        // This avoids triggering the OOM killer and prevents potentially heavy disk activity leading to system unresponsiveness.
-        //
-        // To achieve this, we use the Linux specific MADV_FREE. On a proper POSIX compliant OS one would use MADV_DONTNEED. Linux,
-        // unfortunately implements MADV_DONTNEED in the same broken way as TRU64. See the following links for further reading:
-        //
-        // http://linux-kernel.2935.n7.nabble.com/wrong-madvise-MADV-DONTNEED-semantic-td18033.html
-        // https://www.youtube.com/watch?v=bg6-LVCHmGM&feature=youtu.be&t=3518
-        // https://stackoverflow.com/q/14968309
-        //
-        // Although MADV_FREE is available since linux 4.5, we require at least 4.12, because (madvise man page):
-        // "In Linux before version 4.12, when freeing pages on a swapless system, the pages in the given range are freed instantly, regardless of memory pressure."
-        if (::madvise(this->data, this->count * sizeof(SAMPLEFORMAT), MADV_FREE) != 0)
+        // writing to a page makes the kernel keep it. this must be done atomically, otherwise the page might be reclaimed
+        // in between reading and writing, leaving a page of zeros except for the byte written, which goes unnoticed below
+        __atomic_fetch_or(static_cast<volatile uint8_t *>(pcm + off), 0, __ATOMIC_RELAXED);
+
+        if (!reclaimed && p.pageHasData[off / p.pageSize])
+        {
+            const uint8_t *page = pcm + off;
+            reclaimed = std::all_of(page, page + std::min(p.pageSize, End - off), [](uint8_t b) { return b == 0; });
+        }
+    }
+
+    if (reclaimed)
+    {
+        const uint32_t Channels = this->Format.Channels();
+        const size_t FrameBytes = Channels * sizeof(SAMPLEFORMAT);
+        const frame_t First = Begin / FrameBytes;
+        const frame_t Last = (End + FrameBytes - 1) / FrameBytes;
+        // render() advances this->framesAlreadyRendered, which is only restored afterwards. getFramesRendered() and isBufferComplete()
+        // dont look at it while paging is active, so the player never sees it rewound
+        const frame_t Rendered = this->framesAlreadyRendered;
+
+        CLOG(LogLevel_t::Debug, "PCM of \"" << this->Filename << "\" has been reclaimed, decoding frames " << First << " to " << Last << " again" << std::endl);
+        try
+        {
+            std::vector<SAMPLEFORMAT> pcmAgain((Last - First) * Channels);
+
+            this->seekDecoder(First);
+            this->framesAlreadyRendered = First;
+            this->render(pcmAgain.data(), Channels, Last - First);
+
+            // copy this chunk only: partially overwriting a reclaimed page of a neighbouring chunk would hide the fact that it has been reclaimed
+            std::memcpy(pcm + Begin, reinterpret_cast<const uint8_t *>(pcmAgain.data()) + (Begin - First * FrameBytes), End - Begin);
+            p.chunksRedecoded++;
+        }
+        catch (const std::exception &e)
         {
-            CLOG(LogLevel_t::Debug, "madvise(MADV_FREE) failed: " << strerror(errno));
+            CLOG(LogLevel_t::Error, "failed to decode frames " << First << " to " << Last << " of \"" << this->Filename << "\" again: " << e.what());
         }
+        this->framesAlreadyRendered = Rendered;
+    }
+
+    p.pinned[chunk] = true;
+}
+
+/**
+ * Lets the kernel reclaim the pages of @p chunk, unless the player may be reading it.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::freeChunk(size_t chunk) noexcept
+{
+#ifdef STANDARDWRAPPER_MADV_FREE
+    PagedPcm &p = *this->paged;
+    uint8_t *pcm = static_cast<uint8_t *>(this->data);
+
+    const size_t Begin = chunk * p.chunkBytes;
+    const size_t End = std::min(Begin + p.chunkBytes, this->count * sizeof(SAMPLEFORMAT));
+
+    // makeResident() publishes the chunk of the playhead before checking whether it is pinned, we unpin before checking the
+    // playhead. thus either makeResident() doesnt report the chunk to be readable or we notice that the player seeked close to it
+    p.pinned[chunk] = false;
+    const size_t Current = p.chunk;
+    if (Current != SIZE_MAX && chunk + 1 >= Current && chunk <= Current + p.lookahead)
+    {
+        p.pinned[chunk] = true;
+        return;
+    }
+
+    if (::madvise(pcm + Begin, End - Begin, MADV_FREE) != 0)
+    {
+        CLOG(LogLevel_t::Debug, "madvise(MADV_FREE) failed: " << strerror(errno));
+        p.pinned[chunk] = true;
     }
 #endif
 }
@@ -250,47 +849,63 @@ void StandardWrapper<SAMPLEFORMAT>::renderAsync(pcm_t *const bufferToFill, const
 template<typename SAMPLEFORMAT>
 void StandardWrapper<SAMPLEFORMAT>::releaseBuffer() noexcept
 {
+    PcmBudget::Singleton().release(this);
+
     this->stopFillBuffer = true;
     WAIT(this->futureFillBuffer);
 
-#if defined(_POSIX_C_SOURCE) && _POSIX_MAPPED_FILES && _POSIX_C_SOURCE >= 200112L
-    if (this->data != nullptr)
+    if (this->compressed != nullptr)
     {
-        if (::munmap(this->data, this->count * sizeof(SAMPLEFORMAT)) != 0)
+        WAIT(this->compressed->futureDecompress);
+        if (this->compressed->blocksDecompressed != 0)
         {
-            CLOG(LogLevel_t::Error, "munmap() failed: " << strerror(errno));
+            const auto Us = std::chrono::duration_cast<std::chrono::microseconds>(this->compressed->decompressTime).count();
+            CLOG(LogLevel_t::Debug, "Decompressed " << this->compressed->blocksDecompressed << " blocks of \"" << this->Filename << "\", " << (Us / this->compressed->blocksDecompressed) << " us per block on average" << std::endl);
         }
-        else
+        this->compressed.reset();
+    }
+
+    if (this->paged != nullptr)
+    {
+        WAIT(this->paged->futurePaging);
+        if (this->paged->chunksRedecoded != 0)
         {
-            this->data = nullptr;
+            CLOG(LogLevel_t::Debug, "Decoded " << this->paged->chunksRedecoded << " chunks of \"" << this->Filename << "\" again, after they had been reclaimed" << std::endl);
         }
+        this->paged.reset();
     }
-#endif
 
-    if (this->backingFile != nullptr)
+    const uint32_t Channels = this->Format.Channels();
+    for (ResidentRegion &r : this->residentRegions)
     {
-        fclose(this->backingFile);
-        this->backingFile = nullptr;
+        ::PageUnlockMemory(r.pcm, (r.stop - r.start) * Channels * sizeof(SAMPLEFORMAT));
+        this->freePcmBuffer(r.pcm, (r.stop - r.start) * Channels);
     }
-    else
+    this->residentRegions.clear();
+
+    if (this->ringFrames != 0)
     {
-        if(this->preRenderBuf != nullptr)
-        {
-            ::PageUnlockMemory(this->data, this->count * 2 * sizeof(SAMPLEFORMAT));
+        ::PageUnlockMemory(this->data, this->count * sizeof(SAMPLEFORMAT));
+    }
 
-            // make sure we pass the pointer returned by new[] to delete[], i.e. the one pointing to the beginning of the alloced buffer
-            if(this->data > this->preRenderBuf)
-            {
-                std::swap(this->data, this->preRenderBuf);
-            }
-        }
+    this->freePcmBuffer(static_cast<SAMPLEFORMAT *>(this->data), this->count);
+
+    if (!this->cacheTmpFile.empty())
+    {
+        // rendering didnt complete, the entry is useless
+        PcmCache::Singleton().discard(this->cacheTmpFile);
+        this->cacheTmpFile.clear();
     }
+    this->cacheKey.clear();
 
-    delete[] static_cast<SAMPLEFORMAT *>(this->data);
     this->data = nullptr;
-    this->preRenderBuf = nullptr;
     this->count = 0;
     this->framesAlreadyRendered = 0;
+    this->ringFrames = 0;
+    this->ringChunk = 0;
+    this->readPosition = 0;
+    this->isRenderingAhead = false;
+    this->seekCompleted = this->seekRequested.load();
 
     this->stopFillBuffer = false;
 }
@@ -298,9 +913,330 @@ void StandardWrapper<SAMPLEFORMAT>::releaseBuffer() noexcept
 template<typename SAMPLEFORMAT>
 frame_t StandardWrapper<SAMPLEFORMAT>::getFramesRendered() const noexcept
 {
+    if (this->compressed != nullptr)
+    {
+        // frames rendered, but not yet compressed, are not available to the player
+        return this->compressed->framesCompressed;
+    }
+    if (this->paged != nullptr && this->paged->active)
+    {
+        // paging is only activated once the whole song has been rendered. while pinChunk() decodes reclaimed chunks again,
+        // this->framesAlreadyRendered follows the decoder, which must not be published to the player
+        return this->getFrames();
+    }
+    if (this->isSeeking())
+    {
+        // the ring buffer is about to be filled starting at the read position, what it holds now is invalid
+        return this->readPosition;
+    }
     return this->framesAlreadyRendered;
 }
 
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::setReadPosition(frame_t frame) noexcept
+{
+    // when playing a loop kept in memory, the player goes back in time. but the frames following that loop must stay
+    // in the ring buffer. moving the read position backwards is left to this->seek()
+    if (frame > this->readPosition)
+    {
+        this->readPosition = frame;
+    }
+}
+
+template<typename SAMPLEFORMAT>
+const pcm_t *StandardWrapper<SAMPLEFORMAT>::getResidentPcm(frame_t frame, size_t &itemOffset, frame_t &framesAvailable) const noexcept
+{
+    if (this->compressed != nullptr)
+    {
+        CompressedPcm &c = *this->compressed;
+        const frame_t Compressed = c.framesCompressed;
+        if (frame < 0 || frame >= Compressed)
+        {
+            return nullptr;
+        }
+
+        const uint32_t Channels = this->Format.Channels();
+        const frame_t Block = frame / PcmBlockFrames;
+        const frame_t Next = Block + 1;
+        const frame_t Blocks = (Compressed + PcmBlockFrames - 1) / PcmBlockFrames;
+
+        // claim the slot of this block before looking at it, see decompressBlock()
+        c.playingBlock = Block;
+        if (c.windowBlock[Block % 2] != Block)
+        {
+            // we seeked or the decoder threads were too busy to decompress it in time. never decompress on the playback thread,
+            // the player rather waits for the decoder threads
+            this->decompressAsync(Block, std::min(Next + 1, Blocks));
+            return nullptr;
+        }
+
+        // decompress the next block while this one is being played; it goes to the other slot of the window, so this one stays valid
+        if (Next < Blocks && c.windowBlock[Next % 2] != Next)
+        {
+            this->decompressAsync(Next, Next + 1);
+        }
+
+        itemOffset = static_cast<size_t>((Block % 2) * PcmBlockFrames + frame - Block * PcmBlockFrames) * Channels;
+        framesAvailable = std::min(Next * PcmBlockFrames, Compressed) - frame;
+        return c.window.get();
+    }
+
+    for (const ResidentRegion &r : this->residentRegions)
+    {
+        const frame_t end = r.start + r.rendered;
+        if (r.start <= frame && frame < end)
+        {
+            itemOffset = static_cast<size_t>(frame - r.start) * this->Format.Channels();
+            framesAvailable = end - frame;
+            return r.pcm;
+        }
+    }
+
+    return nullptr;
+}
+
+template<typename SAMPLEFORMAT>
+bool StandardWrapper<SAMPLEFORMAT>::hasResidentLoops() const noexcept
+{
+    return this->ringFrames != 0 && !this->residentRegions.empty();
+}
+
+template<typename SAMPLEFORMAT>
+bool StandardWrapper<SAMPLEFORMAT>::isFullyResident() const noexcept
+{
+    return this->compressed != nullptr;
+}
+
+template<typename SAMPLEFORMAT>
+frame_t StandardWrapper<SAMPLEFORMAT>::makeResident(frame_t frame, frame_t frames)
+{
+    if (this->paged == nullptr || frames <= 0)
+    {
+        return frames;
+    }
+    PagedPcm &p = *this->paged;
+
+    if (!p.active)
+    {
+        // the memory pressure became high while playing, let the kernel reclaim what isnt played soon
+        if (!p.activationRequested && this->isBufferComplete() && RenderPolicy::Singleton().pressure() == RenderPolicy::Pressure::High)
+        {
+            try
+            {
+                p.futurePaging = DecoderPool::Singleton().submit(this, [this]() { this->allowReclaim(); });
+                p.activationRequested = true;
+                CLOG(LogLevel_t::Info, "Memory pressure high, allowing the kernel to reclaim the PCM of \"" << this->Filename << "\"." << std::endl);
+            }
+            catch (const std::exception &e)
+            {
+            }
+        }
+
+        // nothing has been freed
+        return frames;
+    }
+
+    const size_t FrameBytes = this->Format.Channels() * sizeof(SAMPLEFORMAT);
+    const size_t Chunk = static_cast<size_t>(frame) * FrameBytes / p.chunkBytes;
+    if (Chunk >= p.chunks)
+    {
+        return frames;
+    }
+
+    const size_t Previous = p.chunk;
+    if (Chunk != Previous)
+    {
+        // the playhead moved on to another chunk, pin the ones ahead and free the ones behind. publish the chunk first,
+        // so that tasks queued before dont free it anymore, see freeChunk()
+        p.chunk = Chunk;
+        try
+        {
+            p.futurePaging = DecoderPool::Singleton().submit(this, [this, Chunk]() { this->pageAround(Chunk); });
+        }
+        catch (const std::exception &e)
+        {
+            p.chunk = Previous;
+            return frames;
+        }
+    }
+
+    if (!p.pinned[Chunk] || (Chunk + 1 < p.chunks && !p.pinned[Chunk + 1]))
+    {
+        // we seeked or the decoder threads didnt manage to pin the chunk in time. dont wait for them on the playback thread,
+        // rather let the player retry once they are done
+        if (!p.pinned[Chunk] && p.futurePaging.valid() && p.futurePaging.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            return 0;
+        }
+    }
+
+    // chunks beyond the lookahead may still be pinned, but are about to be freed
+    size_t end = Chunk;
+    while (end < p.chunks && end <= Chunk + p.lookahead && p.pinned[end])
+    {
+        end++;
+    }
+
+    const frame_t Available = static_cast<frame_t>(std::min(end * p.chunkBytes, this->count * sizeof(SAMPLEFORMAT)) / FrameBytes) - frame;
+    return std::max<frame_t>(1, std::min(frames, Available));
+}
+
+template<typename SAMPLEFORMAT>
+bool StandardWrapper<SAMPLEFORMAT>::isBufferComplete()
+{
+    if (this->compressed != nullptr)
+    {
+        if (this->compressed->framesCompressed != this->compressed->frames)
+        {
+            return false;
+        }
+
+        WAIT(this->futureFillBuffer);
+        return true;
+    }
+
+    if (this->paged != nullptr && this->paged->active)
+    {
+        // rendered completely, see getFramesRendered()
+        return true;
+    }
+
+    if (this->ringFrames != 0 || this->count == 0 || this->framesAlreadyRendered != this->getFrames())
+    {
+        return false;
+    }
+
+    // the last task may still be finishing, after having rendered the last frame
+    WAIT(this->futureFillBuffer);
+    return true;
+}
+
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::seek(frame_t frame)
+{
+    if (this->ringFrames == 0)
+    {
+        // either no buffer at all or the whole song is held in memory, nothing to do
+        return;
+    }
+
+    // frames kept in memory dont need to be decoded again, rather the decoder has to continue right after them
+    for (bool moved = true; moved;)
+    {
+        moved = false;
+        for (const ResidentRegion &r : this->residentRegions)
+        {
+            const frame_t end = r.start + r.rendered;
+            if (r.start <= frame && frame < end)
+            {
+                frame = end;
+                moved = true;
+            }
+        }
+    }
+
+    if (!this->isSeeking() && this->readPosition <= frame && frame <= this->framesAlreadyRendered)
+    {
+        // already decoded (most likely case, i.e. no seek at all), just skip the frames in between
+        this->setReadPosition(frame);
+        return;
+    }
+
+    // whatever is left in the ring buffer is invalid now. stop filling it and let the decoder threads seek, once they are done
+    // with the task being executed. until then, getFramesRendered() doesnt exceed frame, so the player doesnt wait for them
+    const unsigned int Generation = ++this->seekRequested;
+    this->readPosition = frame;
+    this->stopFillBuffer = true;
+    this->futureFillBuffer = DecoderPool::Singleton().submit(this, [this, frame, Generation]() {
+        if (Generation != this->seekRequested)
+        {
+            // another seek has been requested meanwhile, its task is queued after this one
+            return;
+        }
+        this->stopFillBuffer = false;
+        try
+        {
+            this->seekDecoder(frame);
+        }
+        catch (const std::exception &e)
+        {
+            CLOG(LogLevel_t::Error, "failed to continue decoding \"" << this->Filename << "\" at frame " << frame << ": " << e.what());
+        }
+        this->framesAlreadyRendered = frame;
+        // only the latest seek may publish its position; if another one has been requested meanwhile,
+        // this->seekCompleted keeps differing from this->seekRequested until that one's task completes
+        this->seekCompleted = Generation;
+    });
+}
+
+template<typename SAMPLEFORMAT>
+bool StandardWrapper<SAMPLEFORMAT>::isSeeking() const noexcept
+{
+    return this->seekCompleted != this->seekRequested;
+}
+
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::seekDecoder(frame_t)
+{
+    throw NotImplementedException();
+}
+
+template<typename SAMPLEFORMAT>
+std::string StandardWrapper<SAMPLEFORMAT>::getCacheParams() const
+{
+    return "";
+}
+
+/**
+ * @return the key of this song's PCM within the PcmCache, or an empty string if it shall not be cached
+ */
+template<typename SAMPLEFORMAT>
+std::string StandardWrapper<SAMPLEFORMAT>::getCacheKey() const
+{
+    if (!gConfig.usePcmCache)
+    {
+        return "";
+    }
+
+    const std::string params = this->getCacheParams();
+    if (params.empty())
+    {
+        return "";
+    }
+
+    const std::string hash = PcmCache::hashFile(this->Filename);
+    if (hash.empty())
+    {
+        return "";
+    }
+
+    std::stringstream key;
+    key << typeid(*this).name() << '|' << hash << '|';
+    key << (this->fileOffset.hasValue ? std::to_string(this->fileOffset.Value) : "-") << '|';
+    key << (this->fileLen.hasValue ? std::to_string(this->fileLen.Value) : "-") << '|';
+    key << static_cast<int>(this->Format.SampleFormat) << '|' << this->Format.Channels() << '|' << this->Format.SampleRate << '|';
+    key << this->getFrames() << '|';
+    key << (gConfig.useAudioNormalization ? this->gainCorrection : 0.0f) << '|';
+    key << params;
+
+    return key.str();
+}
+
+/**
+ * Makes the PCM rendered into a new entry of the PcmCache available for subsequent playbacks, once the whole song has been rendered.
+ */
+template<typename SAMPLEFORMAT>
+void StandardWrapper<SAMPLEFORMAT>::commitCached() noexcept
+{
+    if (this->cacheTmpFile.empty() || this->framesAlreadyRendered != this->getFrames())
+    {
+        return;
+    }
+
+    PcmCache::Singleton().commit(this->cacheKey, this->cacheTmpFile);
+    this->cacheTmpFile.clear();
+}
+
 
 DEFINE_INSTANCES
 
@@ -3,7 +3,11 @@
 
 #include "Song.h"
 
+#include <chrono>
+#include <deque>
 #include <future>
+#include <memory>
+#include <vector>
 
 /**
   * class StandardWrapper
@@ -36,11 +40,13 @@
     {                                                                                                                                             \
         auto backup = framesToRender = std::min(framesToRender, this->getFrames() - this->framesAlreadyRendered);                                      \
         SAMPLEFORMAT *pcm = static_cast<SAMPLEFORMAT *>(bufferToFill);                                                                            \
+        /* gConfig.FramesToRender may be changed by the user at any time, thus read it only once */                                               \
+        const frame_t chunkSize = gConfig.FramesToRender;                                                                                         \
                                                                                                                                                   \
         while (framesToRender > 0 && !this->stopFillBuffer)                                                                                       \
         {                                                                                                                                         \
             /* render in chunks of gConfig.FramesToRender size */                                                                                 \
-            int framesToDoNow = (framesToRender / gConfig.FramesToRender) > 0 ? gConfig.FramesToRender : framesToRender % gConfig.FramesToRender; \
+            int framesToDoNow = (framesToRender / chunkSize) > 0 ? chunkSize : framesToRender % chunkSize;                                        \
                                                                                                                                                   \
             /* call the function whatever is responsible for decoding to raw pcm */                                                               \
             LIB_SPECIFIC_RENDER_FUNCTION;                                                                                                         \
@@ -75,6 +81,22 @@ class StandardWrapper : public Song
 
     frame_t getFramesRendered() const noexcept override;
 
+    void setReadPosition(frame_t frame) noexcept override;
+
+    void seek(frame_t frame) override;
+
+    bool isSeeking() const noexcept override;
+
+    const pcm_t *getResidentPcm(frame_t frame, size_t &itemOffset, frame_t &framesAvailable) const noexcept override;
+
+    bool hasResidentLoops() const noexcept override;
+
+    bool isFullyResident() const noexcept override;
+
+    frame_t makeResident(frame_t frame, frame_t frames) override;
+
+    bool isBufferComplete() override;
+
     /**
      * The render function that actually decodes and saves everything to @p bufferToFill.
      * 
@@ -85,15 +107,32 @@ class StandardWrapper : public Song
     virtual void render(pcm_t *const bufferToFill, const uint32_t channels, frame_t framesToRender) = 0;
 
     protected:
-
-    std::FILE* backingFile = nullptr;
-
     // a flag that indicates a prematurely abort of async buffer fill
-    bool stopFillBuffer = false;
+    std::atomic<bool> stopFillBuffer = {false};
 
     // number of frames that have been rendered to this->pcm since the song has been opened
     std::atomic<frame_t> framesAlreadyRendered = {0};
 
+    /**
+     * Repositions the underlying decoder, so that the next call to this->render() starts decoding at @p frame.
+     *
+     * Must be implemented by all wrappers claiming to be this->isSeekable(). There is no need to care about
+     * this->framesAlreadyRendered or the ring buffer, this is done by this->seek().
+     *
+     * @param frame: frame to continue at, relative to the beginning of the song (i.e. not accounting for this->fileOffset)
+     */
+    virtual void seekDecoder(frame_t frame);
+
+    /**
+     * Describes the settings the PCM rendered by this wrapper depends on, besides the content of this->Filename and this->Format.
+     *
+     * Wrappers of formats that are expensive to decode override this to have their PCM kept in the PcmCache. They must
+     * account for every setting that changes the PCM, including the content of any other file being loaded.
+     *
+     * @return an empty string if the PCM shall not be cached (default)
+     */
+    virtual std::string getCacheParams() const;
+
     template<typename REAL_SAMPLEFORMAT>
     void doAudioNormalization(REAL_SAMPLEFORMAT *bufferToFill, const frame_t framesToProcess);
 
@@ -105,14 +144,134 @@ class StandardWrapper : public Song
     float gainCorrection = 1.0f;
 
     private:
-    // used for double buffering, whenever we were unable to allocate a buffer big enough to hold the whole song in memory
-    pcm_t *preRenderBuf = nullptr;
+    // whenever we were unable to allocate a buffer big enough to hold the whole song in memory, this->data is used as ring buffer
+    // holding that many frames, i.e. frame f is located at (f % ringFrames); 0 if this->data holds the whole song
+    frame_t ringFrames = 0;
+
+    // number of frames rendered at once into the ring buffer, ringFrames is a multiple of it
+    frame_t ringChunk = 0;
+
+    // frames before this one have been consumed by the player, their space in the ring buffer may be reused
+    std::atomic<frame_t> readPosition = {0};
+
+    // whether a task on the decoder threads is currently filling the ring buffer
+    std::atomic<bool> isRenderingAhead = {false};
+
+    // generation of the latest call to this->seek() that had to reposition the decoder, and the generation of the latest one
+    // the decoder threads have completed. as long as they differ, the decoder is about to continue at this->readPosition
+    std::atomic<unsigned int> seekRequested = {0};
+    std::atomic<unsigned int> seekCompleted = {0};
 
     std::future<void> futureFillBuffer;
 
+    // a range of frames of the song kept in memory, besides the ring buffer
+    struct ResidentRegion
+    {
+        ResidentRegion(frame_t start, frame_t stop, SAMPLEFORMAT *pcm)
+        : start(start), stop(stop), pcm(pcm)
+        {
+        }
+
+        // the frames [start, stop) of the song
+        const frame_t start;
+        const frame_t stop;
+        SAMPLEFORMAT *const pcm;
+
+        // number of frames, beginning with start, that are valid in pcm
+        std::atomic<frame_t> rendered = {0};
+    };
+
+    // if this->data is a ring buffer: the outermost loops of the song, filled whenever the ring buffer is filled with their frames
+    std::deque<ResidentRegion> residentRegions;
+
+    // the whole song, kept compressed in blocks of PcmBlockFrames frames
+    struct CompressedPcm
+    {
+        // frames of the song
+        frame_t frames = 0;
+
+        // one entry per block, each written only once by the decoder thread, before framesCompressed passes it
+        std::vector<std::vector<uint8_t>> blocks;
+
+        // frames compressed so far, always a multiple of PcmBlockFrames, unless all frames have been compressed
+        std::atomic<frame_t> framesCompressed = {0};
+
+        size_t bytes = 0;
+
+        // the last two blocks decompressed, block b lives in window[b % 2]: while one is being played, the next one is decompressed in the background.
+        // windowBlock is -1 while its slot is being written
+        std::unique_ptr<SAMPLEFORMAT[]> window;
+        std::atomic<frame_t> windowBlock[2] = {{-1}, {-1}};
+
+        // the block the player reads from, its slot of the window is never written meanwhile
+        std::atomic<frame_t> playingBlock = {-1};
+
+        // blocks are only decompressed on the decoder threads, the player just checks whether they are done
+        std::future<void> futureDecompress;
+
+        uint64_t blocksDecompressed = 0;
+        std::chrono::nanoseconds decompressTime{0};
+    };
+
+    // if gConfig.CompressWholeSong: the compressed PCM, this->data only holds the block currently being rendered and compressed
+    // (the window is filled on behalf of the const getResidentPcm(), thus mutable)
+    mutable std::unique_ptr<CompressedPcm> compressed;
+
+    // if this->data holds the whole song and gConfig.useMadvFree (or the memory pressure is high, see RenderPolicy): once rendered, the kernel may reclaim the pages of this->data, which
+    // then read as zeros. to detect this, this->data is divided into chunks, that are either pinned (i.e. known to be valid and written
+    // to, so the kernel doesnt reclaim them anymore) or freeable. only the chunks around the playhead are pinned.
+    struct PagedPcm
+    {
+        size_t pageSize = 0;
+        size_t chunkBytes = 0;
+        size_t chunks = 0;
+
+        // number of chunks pinned ahead of the playhead
+        size_t lookahead = 0;
+
+        // whether the pages of this->data have been made freeable at all
+        std::atomic<bool> active = {false};
+
+        // whether makeResident() asked the decoder threads to activate paging, because the memory pressure became high
+        bool activationRequested = false;
+
+        std::unique_ptr<std::atomic<bool>[]> pinned;
+
+        // per page: whether it held anything but zeros after rendering
+        std::vector<bool> pageHasData;
+
+        // the chunk the playhead was in when makeResident() was called last time, the chunks around it must not be freed
+        std::atomic<size_t> chunk = {SIZE_MAX};
+
+        // pinning and freeing chunks is done on the decoder threads only
+        std::future<void> futurePaging;
+
+        uint64_t chunksRedecoded = 0;
+    };
+
+    std::unique_ptr<PagedPcm> paged;
+
+    // if this->data is being rendered into a new entry of the PcmCache: its key and the temporary file backing this->data
+    std::string cacheKey;
+    std::string cacheTmpFile;
+
     void init() noexcept;
+    std::string getCacheKey() const;
+    void commitCached() noexcept;
     SAMPLEFORMAT* allocPcmBuffer(size_t) noexcept;
+    void freePcmBuffer(SAMPLEFORMAT *, size_t) noexcept;
+    void allocResidentRegions(const uint32_t Channels) noexcept;
+    void keepResident(const SAMPLEFORMAT *pcm, const uint32_t Channels, frame_t from, frame_t to) noexcept;
     void renderAsync(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender);
+    void renderAhead(const uint32_t Channels);
+    bool allocCompressed(const uint32_t Channels, const frame_t TotalFrames) noexcept;
+    void renderCompressed(const uint32_t Channels, frame_t blocks);
+    void decompressBlock(frame_t block) const noexcept;
+    void decompressAsync(frame_t first, frame_t last) const noexcept;
+    void allowReclaim() noexcept;
+    void pageAround(size_t chunk);
+    void pinChunk(size_t chunk);
+    void freeChunk(size_t chunk) noexcept;
 };
 
 #endif // STANDARDWRAPPER_H
@@ -71,6 +71,16 @@ void VGMStreamWrapper::render(pcm_t *const bufferToFill, const uint32_t Channels
     STANDARDWRAPPER_RENDER(int16_t, render_vgmstream(pcm, framesToDoNow, this->handle))
 }
 
+bool VGMStreamWrapper::isSeekable() const noexcept
+{
+    return this->handle != nullptr;
+}
+
+void VGMStreamWrapper::seekDecoder(frame_t frame)
+{
+    seek_vgmstream(this->handle, frame);
+}
+
 vector<loop_t> VGMStreamWrapper::getLoopArray() const noexcept
 {
     vector<loop_t> res;
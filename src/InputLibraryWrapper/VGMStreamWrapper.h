@@ -39,8 +39,13 @@ class VGMStreamWrapper : public StandardWrapper<int16_t>
 
     void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override;
 
+    bool isSeekable() const noexcept override;
+
     void buildMetadata() noexcept override;
 
+    protected:
+    void seekDecoder(frame_t frame) override;
+
     private:
     VGMSTREAM *handle = nullptr;
 };
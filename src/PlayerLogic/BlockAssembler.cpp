@@ -0,0 +1,55 @@
+#include "BlockAssembler.h"
+
+#include <cstring>
+
+
+void BlockAssembler::setFormat(const SongFormat &format)
+{
+    this->channels = format.Channels();
+    this->itemSize = this->channels != 0 ? format.getFrameSize() / this->channels : 0;
+    this->sampleFormat = format.SampleFormat;
+    this->sampleRate = format.SampleRate;
+    this->voiceChannels = format.VoiceChannels;
+}
+
+bool BlockAssembler::accepts(const SongFormat &format) const noexcept
+{
+    return this->sampleFormat == format.SampleFormat &&
+           this->sampleRate == format.SampleRate &&
+           this->voiceChannels == format.VoiceChannels;
+}
+
+void BlockAssembler::append(const pcm_t *buffer, size_t offset, frame_t frames)
+{
+    const size_t frameBytes = static_cast<size_t>(this->itemSize) * this->channels;
+    const size_t bytesNeeded = (this->frames + frames) * frameBytes;
+    if (this->buffer.size() < bytesNeeded)
+    {
+        this->buffer.resize(bytesNeeded);
+    }
+
+    std::memcpy(this->buffer.data() + this->frames * frameBytes,
+                static_cast<const uint8_t *>(buffer) + offset * this->itemSize,
+                frames * frameBytes);
+    this->frames += frames;
+}
+
+void BlockAssembler::clear() noexcept
+{
+    this->frames = 0;
+}
+
+const pcm_t *BlockAssembler::data() const noexcept
+{
+    return this->buffer.data();
+}
+
+frame_t BlockAssembler::size() const noexcept
+{
+    return this->frames;
+}
+
+bool BlockAssembler::empty() const noexcept
+{
+    return this->frames == 0;
+}
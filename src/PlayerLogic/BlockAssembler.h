@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SongFormat.h"
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+  * class BlockAssembler
+  *
+  * collects pcm in front of IAudioOutput::write(), so that the audio driver receives full-sized periods,
+  * even if playback jumps around within the pcm buffer, e.g. at loop points, when seeking or when reaching
+  * the end of the ring buffer or the song
+  *
+  * the frames are copied as they are, mixing is left to the audio driver
+  */
+class BlockAssembler
+{
+    public:
+    /**
+     * sets the format of the pcm to be assembled
+     *
+     * only call this if there are no frames pending or this->accepts(format) is true
+     */
+    void setFormat(const SongFormat &format);
+
+    /**
+     * @return true if pcm of the given format can be appended to the frames pending, i.e. it has the same
+     * sample format, sample rate and voices
+     */
+    bool accepts(const SongFormat &format) const noexcept;
+
+    /**
+     * copies @p frames frames of @p buffer starting at item @p offset to the end of the frames pending
+     */
+    void append(const pcm_t *buffer, size_t offset, frame_t frames);
+
+    // drops all frames pending
+    void clear() noexcept;
+
+    // @return the pcm assembled so far
+    const pcm_t *data() const noexcept;
+
+    // @return the number of frames pending
+    frame_t size() const noexcept;
+
+    bool empty() const noexcept;
+
+    private:
+    std::vector<uint8_t> buffer;
+
+    frame_t frames = 0;
+
+    // size of a single item in bytes
+    uint32_t itemSize = 0;
+    uint32_t channels = 0;
+
+    SampleFormat_t sampleFormat = SampleFormat_t::unknown;
+    uint32_t sampleRate = 0;
+    std::vector<uint16_t> voiceChannels;
+};
@@ -7,7 +7,6 @@
 #include <filesystem>
 
 // definitions go here
-constexpr frame_t Config::FramesToRender;
 constexpr const char Config::UserDir[];
 constexpr const char Config::UserFile[];
 
@@ -1,6 +1,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include "ThreadPriority.h"
 #include "types.h"
 
 #include <cereal/cereal.hpp>
@@ -31,9 +32,16 @@ class Config
     static constexpr const char UserDir[] = ".anmp";
     static constexpr const char UserFile[] = "config.json";
 
-    // number of frames that are pushed to audioDriver during each run AND minimum no. of frames
-    // that have to be prepared (i.e. rendered) by a single call to Song::fillBuffer()
-    static constexpr frame_t FramesToRender = 2048;
+    // number of frames that are rendered by a single call to the underlying decoding library AND
+    // preferred number of frames that are pushed to audioDriver during each run
+    //
+    // the audio driver may negotiate a different period size, see IAudioOutput::GetPeriodSize()
+    //
+    // small values (64 - 256) allow low latency playback, big values (32768 and more) increase
+    // the throughput when writing to files
+    //
+    // you have to call Player::initAudio() for changes to take effect, songs will only pick it up after being reopened
+    frame_t FramesToRender = 2048;
 
     // indicates the default audio driver to use
     // you have to call Player::initAudio() for changes to take effect
@@ -50,15 +58,74 @@ class Config
     unsigned int PreRenderTime = 500;
 
     // indicates whether the currently playing audiofile shall be only decoded once and held in memory as a whole (true)
-    // or if only a small buffer shall be allocated holding only FramesToRender frames at one time
-    // can be set to false, if user needs to save memory, however this will also make seeking within the file impossible
+    // or if only a small ring buffer shall be allocated holding RenderAheadTime of PCM at one time
+    // can be set to false, if user needs to save memory, however seeking within the file is then only possible if the decoder supports it
     bool RenderWholeSong = true;
 
+    // if the whole song is not held in memory: how far the decoder may run ahead of the playhead, i.e. the size of the ring buffer
+    // between decoder and player; will be at least twice FramesToRender
+    //
+    // time in milliseconds
+    //
+    // bigger values allow to compensate for long taking decode calls, at the cost of memory
+    unsigned int RenderAheadTime = 500;
+
+    // if the whole song is not held in memory: whether to additionally keep the PCM of its loops in memory, once they
+    // have been decoded. this allows playing loops without seeking the decoder (which not all formats support) at
+    // a fraction of the memory needed for the whole song
+    bool RenderLoopsResident = true;
+
+    // if the whole song is held in memory: whether to keep its PCM losslessly compressed (see PcmCodec) rather than
+    // uncompressed. the PCM is decompressed in small blocks just ahead of the playhead, so seeking and loops still work,
+    // at the cost of some CPU time during playback
+    bool CompressWholeSong = false;
+
     // whether to use the audio normalization information generated by anmp-normalize or not
     bool useAudioNormalization = true;
 
+    // if the whole song is held in memory: whether the OS may reclaim its PCM under memory pressure (using Linux' MADV_FREE),
+    // rather than swapping it out. reclaimed parts are decoded again before being played, thus this only applies to songs,
+    // whose decoder can seek
     bool useMadvFree = false;
 
+    // number of threads shared by all songs for asynchronously rendering PCM, 0 picks a suitable number
+    // based on the number of CPU cores
+    // changes take effect after restarting ANMP
+    unsigned int DecoderThreads = 0;
+
+    // scheduling priority of the decoder threads
+    // changes take effect after restarting ANMP
+    Priority DecoderThreadPriority = Priority::Normal;
+
+    // whether to keep the PCM of formats that are expensive to decode (emulated or synthesized ones) on disk, so that
+    // playing them again doesnt require decoding them again, see PcmCache
+    // off by default, since it may take up to PcmCacheSize of disk space
+    bool usePcmCache = false;
+
+    // max. size of the PCM cache in MiB, least recently used songs are evicted first
+    // changes take effect after restarting ANMP
+    unsigned int PcmCacheSize = 2048;
+
+    // allows to exclude single formats from the PCM cache
+    bool PcmCacheUsf = true;
+    bool PcmCachePsf = true;
+    bool PcmCacheMidi = true;
+
+    // max. amount of memory in MiB used for the PCM of all songs, see PcmBudget
+    // songs played recently are kept in memory as long as it fits into this budget, so playing them again doesnt require decoding them
+    // if a new song doesnt fit into the budget, it is streamed through a ring buffer as if RenderWholeSong was false
+    // changes take effect after restarting ANMP
+    unsigned int PcmBudgetSize = 2048;
+
+    // whether to look at the memory pressure of the system (Linux' PSI, /proc/meminfo and cgroup limits) when deciding
+    // whether a song is held in memory as a whole, only its loops are, or it is streamed, see RenderPolicy
+    // when the pressure rises, songs retained by the PcmBudget are released
+    bool useMemoryPressure = true;
+
+    // share of time in % tasks may be stalled on memory (PSI "some avg10"), before songs are only streamed anymore
+    // a tenth of it already limits songs held in memory to a small part of the memory available
+    unsigned int MemoryPressureThreshold = 10;
+
     //**********************************
     //       HOW-TO-PLAY SECTION       *
     //**********************************
@@ -69,6 +136,12 @@ class Config
     // play each and every loop that many time, -1 will ignore this setting
     int overridingGlobalLoopCount = -1;
 
+    // time in milliseconds before the end of the currently played song, when to start opening and
+    // pre-rendering the next song of the playlist in the background, to allow gapless playback
+    //
+    // 0 disables preloading, i.e. the next song will be opened on the playback thread once the current one has finished
+    unsigned int GaplessPreloadTime = 5000;
+
     // time in milliseconds to fade out a song when the user hits stop
     unsigned int fadeTimeStop = 3500;
 
@@ -193,6 +266,23 @@ class Config
     //**********************************
     bool MadPermissive = false;
 
+    // the length of mp3 files is taken from their Xing/Info or VBRI header, or calculated from their bitrate if they have none.
+    // whether to additionally decode the header of every mpeg frame in the background once a song is about to be played, which
+    // confirms its length and completes the table used for seeking within it (otherwise built while seeking)
+    bool MadScanFrames = true;
+
+    //**********************************
+    //   FFMPEG-SPECIFIC SECTION   *
+    //**********************************
+
+    // number of threads each ffmpeg decoder may use for frame and slice threading, if the codec supports it
+    // 0 lets ffmpeg pick a suitable number based on the number of CPU cores, 1 decodes on the thread rendering the song
+    unsigned int FFMpegDecoderThreads = 0;
+
+    // number of packets a separate thread reads ahead from the file while the ones before are being decoded,
+    // so that waiting for I/O doesnt hold up decoding. 0 reads every packet right before decoding it
+    unsigned int FFMpegReadAheadPackets = 64;
+
 
     void Load() noexcept;
     void Save() noexcept;
@@ -202,6 +292,44 @@ class Config
     {
         switch (version)
         {
+            case 18:
+                archive(CEREAL_NVP(this->FFMpegDecoderThreads), CEREAL_NVP(this->FFMpegReadAheadPackets));
+                [[fallthrough]];
+            case 17:
+                archive(CEREAL_NVP(this->MadScanFrames));
+                [[fallthrough]];
+            case 16:
+                archive(CEREAL_NVP(this->useMemoryPressure), CEREAL_NVP(this->MemoryPressureThreshold));
+                [[fallthrough]];
+            case 15:
+                archive(CEREAL_NVP(this->CompressWholeSong));
+                [[fallthrough]];
+            case 14:
+                archive(CEREAL_NVP(this->PcmBudgetSize));
+                [[fallthrough]];
+            case 13:
+                archive(CEREAL_NVP(this->usePcmCache));
+                archive(CEREAL_NVP(this->PcmCacheSize));
+                archive(CEREAL_NVP(this->PcmCacheUsf));
+                archive(CEREAL_NVP(this->PcmCachePsf));
+                archive(CEREAL_NVP(this->PcmCacheMidi));
+                [[fallthrough]];
+            case 12:
+                archive(CEREAL_NVP(this->RenderLoopsResident));
+                [[fallthrough]];
+            case 11:
+                archive(CEREAL_NVP(this->FramesToRender));
+                [[fallthrough]];
+            case 10:
+                archive(CEREAL_NVP(this->RenderAheadTime));
+                [[fallthrough]];
+            case 9:
+                archive(CEREAL_NVP(this->DecoderThreads));
+                archive(CEREAL_NVP(this->DecoderThreadPriority));
+                [[fallthrough]];
+            case 8:
+                archive(CEREAL_NVP(this->GaplessPreloadTime));
+                [[fallthrough]];
             case 7:
                 archive(CEREAL_NVP(this->FluidsynthFilterFC));
                 archive(CEREAL_NVP(this->FluidsynthGain));
@@ -275,7 +403,7 @@ class Config
     }
 };
 
-CEREAL_CLASS_VERSION(Config, 7)
+CEREAL_CLASS_VERSION(Config, 18)
 
 // global var holding the singleton Config instance
 // just a nice little shortcut, so one doesnt always have to write Config::Singleton()
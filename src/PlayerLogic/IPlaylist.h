@@ -73,6 +73,16 @@ class IPlaylist
     virtual Song *next() = 0;
 
 
+    /**
+     * @brief gets the song that would be returned by the next call to next()
+     *
+     * in contrast to next() this does not change the currently played back song
+     *
+     * @return returns the song following the currently played back song, nullptr if there is no next song
+     */
+    virtual Song *peekNext() = 0;
+
+
     /**
      * @brief sets the previous song to play
      *
@@ -4,7 +4,9 @@
 #include "Common.h"
 #include "CommonExceptions.h"
 #include "Config.h"
-#include "tree.h"
+#include "LoopPlan.h"
+#include "PcmBudget.h"
+#include "RenderPolicy.h"
 #include "ThreadPriority.h"
 
 #include "IAudioOutput.h"
@@ -29,6 +31,7 @@
 #include "PortAudioOutput.h"
 #endif
 
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <limits>
@@ -44,14 +47,34 @@
 
 using namespace std::chrono_literals;
 
+// how many times per second observers are told about the playback progress
+static constexpr int NotificationRate = 30;
+
 Player::Player(IPlaylist *playlist)
 {
     this->playlist = playlist;
 }
 
+Player::Player(IPlaylist *playlist, IAudioOutput *audioDriver)
+{
+    this->playlist = playlist;
+
+    try
+    {
+        audioDriver->open();
+    }
+    catch (...)
+    {
+        delete audioDriver;
+        throw;
+    }
+    this->audioDriver = audioDriver;
+}
+
 Player::Player(Player &&other)
 {
     other.pause();
+    other.cancelPreload();
 
     this->currentSong = other.currentSong;
     other.currentSong = nullptr;
@@ -70,6 +93,7 @@ Player::~Player()
 {
     CLOG(LogLevel_t::Debug, "destroy player " << std::hex << this);
     this->pause();
+    this->cancelPreload();
 
     delete this->audioDriver;
 }
@@ -146,7 +170,12 @@ bool Player::IsPlaying()
 
 bool Player::IsSeekingPossible()
 {
-    return (this->currentSong == nullptr ? false : this->currentSong->count == FramesToItems(static_cast<size_t>(this->currentSong->getFrames())));
+    return this->currentSong != nullptr && (this->holdsWholeSong() || this->currentSong->isFullyResident() || this->currentSong->isSeekable());
+}
+
+bool Player::holdsWholeSong()
+{
+    return this->currentSong->count == FramesToItems(static_cast<size_t>(this->currentSong->getFrames()));
 }
 
 void Player::play()
@@ -157,6 +186,7 @@ void Player::play()
     }
 
     WAIT(this->futurePlayInternal);
+    WAIT(this->futureNotifyInternal);
 
     if (this->currentSong == nullptr)
     {
@@ -173,11 +203,15 @@ void Player::play()
     }
 
     this->audioDriver->setVolume(this->PreAmpVolume);
+    // undo any previous fadeout
+    this->audioDriver->rampVolume(1.0f, 0);
+    this->isFadingOut = false;
 
     this->isPlaying = true;
 
     // new thread that runs playInternal
     this->futurePlayInternal = std::async(std::launch::async, &Player::playInternal, this);
+    this->futureNotifyInternal = std::async(std::launch::async, &Player::notifyInternal, this);
 }
 
 
@@ -200,7 +234,7 @@ void Player::setCurrentSong(Song *song)
 
 // this method is quite unlinear, but unfortunately it seems to be the only correct way to do it
 // basically currentSong and newSong have to be opened while audioDriver is inited and callback is done
-void Player::_setCurrentSong(Song *newSong)
+void Player::_setCurrentSong(Song *newSong, bool releaseAsync)
 {
     // make sure audio driver is initialized
     if (this->audioDriver == nullptr)
@@ -212,7 +246,29 @@ void Player::_setCurrentSong(Song *newSong)
 
     this->_seekTo(0);
 
+    // if newSong has already been prepared in the background, we can start playing it right away
+    Song *preloadedSong = this->takePreloadedSong();
+    if (preloadedSong != nullptr && preloadedSong != newSong)
+    {
+        // playlist has changed in the meantime
+        preloadedSong->releaseBuffer();
+        preloadedSong->close();
+        preloadedSong = nullptr;
+    }
+
+    // the song played before might still be released in the background, make sure we are done with it
+    WAIT(this->futureRelease);
+
     Song *oldSong = this->currentSong;
+
+    // the last frames of oldSong may still be pending. they can be played along with the beginning of newSong,
+    // unless newSong requires the audio driver to be reconfigured
+    if (!this->assembler.empty() &&
+        (newSong == nullptr || !this->audioDriver->CanSpliceSongs() || !this->assembler.accepts(newSong->Format)))
+    {
+        this->flushBlock();
+    }
+
     try
     {
         if (newSong == nullptr) // nullptr here means this.stop()
@@ -221,8 +277,12 @@ void Player::_setCurrentSong(Song *newSong)
         }
         else if (oldSong == nullptr)
         {
-            newSong->open();
-            newSong->fillBuffer();
+            if (preloadedSong == nullptr)
+            {
+                PcmBudget::Singleton().reuse(newSong);
+                newSong->open();
+                newSong->fillBuffer();
+            }
             this->audioDriver->init(newSong->Format);
         }
         else
@@ -238,9 +298,15 @@ void Player::_setCurrentSong(Song *newSong)
             }
             else
             {
-                oldSong->releaseBuffer();
-                newSong->open();
-                newSong->fillBuffer();
+                if (preloadedSong == nullptr)
+                {
+                    // make room for newSong
+                    this->releaseOrRetain(oldSong);
+
+                    PcmBudget::Singleton().reuse(newSong);
+                    newSong->open();
+                    newSong->fillBuffer();
+                }
                 // DO NOT CLOSE oldSong here!
                 // some audiodrivers (waveoutput) might be doing some calls to the old song which are only valid if the song is still open
             }
@@ -250,6 +316,12 @@ void Player::_setCurrentSong(Song *newSong)
 
         // then update currently played song
         this->currentSong = newSong;
+        if (newSong != nullptr)
+        {
+            this->assembler.setFormat(newSong->Format);
+        }
+        // any frames pending belong to the song played before, even if newSong is that one being restarted
+        this->assemblerSong = nullptr;
 
         // now we are ready to do the callback
         this->onCurrentSongChanged(newSong);
@@ -257,8 +329,19 @@ void Player::_setCurrentSong(Song *newSong)
         // oldSong needs to stay open until the very end, i.e. after onCurrentSongChanged() and audioDriver init() are done!
         if (oldSong != nullptr && oldSong != newSong)
         {
-            oldSong->releaseBuffer();
-            oldSong->close();
+            if (releaseAsync)
+            {
+                // unmapping a whole song may take a while, dont let the playback thread wait for it
+                this->futureRelease = std::async(std::launch::async, [this, oldSong]() {
+                    this->releaseOrRetain(oldSong);
+                    oldSong->close();
+                });
+            }
+            else
+            {
+                this->releaseOrRetain(oldSong);
+                oldSong->close();
+            }
         }
     }
     catch (const std::exception &e)
@@ -282,6 +365,94 @@ void Player::_setCurrentSong(Song *newSong)
     }
 }
 
+void Player::releaseOrRetain(Song *song)
+{
+    // under memory pressure, the PCM of songs not being played is the first thing to give up
+    if (song->isBufferComplete() && RenderPolicy::Singleton().pressure() == RenderPolicy::Pressure::None)
+    {
+        PcmBudget::Singleton().retain(song);
+    }
+    else
+    {
+        song->releaseBuffer();
+    }
+}
+
+void Player::preloadNextSong()
+{
+    std::lock_guard<std::mutex> lck(this->mtxPreload);
+
+    // the request is dropped by takePreloadedSong(), once the playback thread moved on to the next song
+    if (!this->preloadRequested.exchange(false) || this->preloadTriggered)
+    {
+        return;
+    }
+    this->preloadTriggered = true;
+
+    Song *nextSong = this->playlist->peekNext();
+    if (nextSong == nullptr || nextSong == this->currentSong)
+    {
+        return;
+    }
+
+    // the next song might be the one we have played before, which might still be released in the background
+    WAIT(this->futureRelease);
+
+    this->futurePreload = std::async(std::launch::async, [nextSong]() -> Song * {
+        try
+        {
+            PcmBudget::Singleton().reuse(nextSong);
+            nextSong->open();
+            nextSong->fillBuffer();
+            return nextSong;
+        }
+        catch (const std::exception &e)
+        {
+            CLOG(LogLevel_t::Warning, "failed to preload next song: " << e.what());
+            nextSong->releaseBuffer();
+            nextSong->close();
+        }
+
+        // the error will show up again, when trying to play the song regularly
+        return nullptr;
+    });
+}
+
+Song *Player::takePreloadedSong()
+{
+    std::lock_guard<std::mutex> lck(this->mtxPreload);
+
+    this->preloadRequested = false;
+    this->preloadTriggered = false;
+
+    Song *s = nullptr;
+    if (this->futurePreload.valid())
+    {
+        s = this->futurePreload.get();
+    }
+
+    return s;
+}
+
+void Player::cancelPreload()
+{
+    std::lock_guard<std::mutex> lck(this->mtxPreload);
+
+    this->preloadRequested = false;
+    // the song following currentSong may have changed, allow preloading again
+    this->preloadTriggered = false;
+
+    if (this->futurePreload.valid())
+    {
+        Song *s = this->futurePreload.get();
+        if (s != nullptr)
+        {
+            s->releaseBuffer();
+            s->close();
+        }
+    }
+}
+
 void Player::stop()
 {
     this->pause();
@@ -292,11 +463,16 @@ void Player::pause()
 {
     this->_pause();
     WAIT(this->futurePlayInternal);
+    WAIT(this->futureNotifyInternal);
+    WAIT(this->futureRelease);
 }
 
 void Player::_pause()
 {
     this->isPlaying = false;
+    // may be called by the playing thread, thus dont lock mtxNotify. in the unlikely case
+    // of a lost wakeup, notifyInternal() will notice a little later
+    this->cvNotify.notify_all();
 
     if (this->audioDriver != nullptr)
     {
@@ -310,38 +486,17 @@ void Player::fadeout(unsigned int fadeTime, int8_t fadeType)
 {
     USERS_ARE_STUPID
 
-    if (fadeTime == 0)
+    this->audioDriver->rampVolume(0.0f, msToFrames(fadeTime, this->currentSong->Format.SampleRate), static_cast<GainCurve>(fadeType));
+
+    if (this->IsPlaying())
     {
-        this->audioDriver->setVolume(0);
+        // the notification thread will fire the event, once the audio driver has played the whole ramp
+        this->isFadingOut = true;
     }
-
-    float vol = 0.0f, timePast = 0.0f;
-    do
+    else
     {
-        switch (fadeType)
-        {
-            case 1:
-                // linear
-                vol = 1.0f - (timePast / fadeTime);
-                break;
-            case 2:
-                // logarithmic
-                vol = 1.0f - pow(0.1, (1 - (timePast / fadeTime)) * 1);
-                break;
-            case 3:
-                // sine
-                vol = 1.0f - sin((timePast / fadeTime) * M_PI / 2);
-                break;
-        }
-
-        float volToPush = vol * this->PreAmpVolume;
-        this->audioDriver->setVolume(volToPush);
-        auto start = std::chrono::high_resolution_clock::now();
-        std::this_thread::sleep_for(1ms);
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double, std::milli> elapsed = end - start;
-        timePast += elapsed.count();
-    } while (timePast <= fadeTime);
+        this->onFadeoutFinished();
+    }
 }
 
 void Player::Mute(int i, bool isMuted)
@@ -370,66 +525,46 @@ void Player::_seekTo(frame_t frame)
     }
 
     this->playhead = frame;
-    this->onPlayheadChanged(this->playhead);
-}
-
-core::tree<loop_t> *Player::getNextLoop(core::tree<loop_t> &l)
-{
-    loop_t compareLoop;
-    compareLoop.start = std::numeric_limits<frame_t>::max();
 
-    core::tree<loop_t> *ptrToNearest = nullptr;
-    // find loop that starts closest, i.e. right after, to whereever playhead points to
-    for (core::tree<loop_t>::iterator it = l.begin(); it != l.end(); ++it)
+    // while playing, observers are notified by notifyInternal()
+    if (!this->IsPlaying())
     {
-        if (this->playhead <= (*it).start && (*it).start < compareLoop.start)
-        {
-            compareLoop = *it;
-            ptrToNearest = it.tree_ptr();
-        }
+        this->onPlayheadChanged(this->playhead);
     }
-
-    return ptrToNearest;
 }
 
-void Player::playLoop(core::tree<loop_t> &loop)
+void Player::playLoopPlan()
 {
     USERS_ARE_STUPID
 
-    // sub-loops that need to be played
-    core::tree<loop_t> *subloop;
+    const LoopPlan &plan = this->currentSong->loopPlan;
+    const std::vector<LoopPlan::Segment> &segments = plan.segments();
+
+    LoopPlan::Cursor cursor;
+    plan.seek(cursor, this->playhead);
 
-    while (this->IsPlaying() && // are we still playing?
-           gConfig.useLoopInfo && // user wishes to use available loop info
-           this->IsSeekingPossible() && // we loop by setting the playhead, if this is not possible, since we dont hold the whole pcm, no loops are available
-           ((subloop = this->getNextLoop(loop)) != nullptr)) // are there subloops left that need to be played?
+    while (this->IsPlaying() && cursor.segment < segments.size())
     {
-        if (this->playhead > (*(*subloop)).stop)
+        const LoopPlan::Segment &seg = segments[cursor.segment];
+
+        this->playFrames(seg.start, seg.stop);
+        if (this->playhead != seg.stop)
         {
-            // Should never happen, unless there are illegal loop points
-            throw LoopTreeConstructionException();
+            // someone seeked, find out where we are now; loops played so far are forgotten
+            plan.seek(cursor, this->playhead);
+            continue;
         }
 
-        this->playFrames((*loop).start, (*(*subloop)).start);
-        // at this point: playhead==subloop.start
+        // we loop by setting the playhead, if this is not possible, since we neither hold the whole pcm (or at least the loops)
+        // nor can the decoder seek, no loops are available
+        bool useLoops = gConfig.useLoopInfo && (this->IsSeekingPossible() || this->currentSong->hasResidentLoops());
 
-        uint32_t mycount = gConfig.overridingGlobalLoopCount != -1 ? gConfig.overridingGlobalLoopCount : (*(*subloop)).count;
-        bool forever = mycount == 0;
-        //         mycount += 1; // +1 because the subloop we are just going to play, should be played one additional time by the parent of subloop (i.e. the loop we are currently in)
-        while (this->IsPlaying() && (forever || mycount-- != 0u))
+        frame_t next = plan.advance(cursor, useLoops, gConfig.overridingGlobalLoopCount);
+        if (next != this->playhead)
         {
-            // if we play this loop multiple time, make sure we start at the beginning again
-            this->_seekTo((*(*subloop)).start);
-            this->playLoop(*subloop);
-            // at this point: playhead=subloop.end
-
-            // actually we could leave this loop with playhead==subloop.start, which would avoid subloop.count+1 up ^ there ^, however
-            // this would cause an infinite loop since getNextLoop() would return the same subloop again and again
+            this->_seekTo(next);
         }
     }
-
-    // play rest of file
-    this->playFrames((*loop).start, (*loop).stop);
 }
 
 
@@ -467,6 +602,14 @@ void Player::playFrames(frame_t framesToPlay)
     frame_t memorizedPlayhead = this->playhead;
     size_t &bufSize = this->currentSong->count;
 
+    const bool wholeSong = this->holdsWholeSong();
+    if (!wholeSong && this->currentSong->isSeekable())
+    {
+        // the pcm buffer is a ring buffer, make sure the decoder continues where the playhead is, in case someone seeked
+        // or we jumped back to the start of a loop; this is cheap if the frames requested have already been decoded
+        this->currentSong->seek(memorizedPlayhead);
+    }
+
     // here is a very simple form of what we do below
     // just hand in every frame separately
     //       for(int i=0; i<framesToPlay; i+=channels)
@@ -481,83 +624,281 @@ void Player::playFrames(frame_t framesToPlay)
            memorizedPlayhead == this->playhead // make sure noone seeked while playing
            )
     {
-        // seek within the pcm buffer to that item where the playhead points to, but make sure we dont run over the buffer; in doubt we should start again at the beginning of the buffer
-        size_t itemOffset = FramesToItems(memorizedPlayhead) % bufSize;
-        // number of frames we will write to audioDriver in this run
-        int framesToPush = std::min(gConfig.FramesToRender, framesToPlay);
-
-        int framesWritten = 0;
+        // number of frames the audio driver wants to receive per call to write()
+        const frame_t period = this->audioDriver->GetPeriodSize();
+        if (this->realtime && this->assembler.size() >= period)
+        {
+            // period size has shrunk in the meantime
+            this->flushBlock();
+            continue;
+        }
 
-    // PLAY!
-    again:
-        this->audioDriver->SetMuteMask(this->currentSong->Format.VoiceIsMuted);
+        // number of frames we will write to audioDriver in this run, completing the period that has been assembled so far
+        frame_t framesToPush = std::min(period - this->assembler.size(), framesToPlay);
 
-        framesWritten = this->audioDriver->write(this->currentSong->data, framesToPush, itemOffset);
-        // before we go on rendering the next pcm chunk, make sure we really played the current one.
-        //
-        // audioDriver.write() may return a value !=framesToPush.
-        // In this case we should call audioDriver.write() again in order to fix playback whenever we dont hold the whole song in memory.
-        // However this breaks playback using jack, since there (usually) resampling is necessary and calling JackOutput::write() with only e.g. 100 frames will not produce enough resampled frames that can be put into jack's playback buffer, padding its buffer with zeros, resulting in interrupted playback.
-        //
-        // thus the case when audioDriver.write() was only able to partly play the provided pcm chunk, cannot be recovered
-        // but we can try it again whenever audioDriver failed at all (i.e. returned 0)
-        if (this->IsPlaying() && framesWritten == 0)
+        const pcm_t *pcm = nullptr;
+        size_t itemOffset = 0;
+        frame_t framesResident = 0;
+        if (!wholeSong && (pcm = this->currentSong->getResidentPcm(memorizedPlayhead, itemOffset, framesResident)) != nullptr)
+        {
+            // we dont hold the whole song, but we are playing a loop that is being kept in memory
+            framesToPush = std::min(framesToPush, framesResident);
+        }
+        else if (!wholeSong && this->currentSong->isFullyResident())
         {
-            CLOG(LogLevel_t::Info, "failed to play the rendered pcm chunk, trying again");
-            // something went terribly wrong, wait some time, so the cpu doesnt get too busy
+            // the song is held in memory some other way than this->data (e.g. compressed), the frames are just not ready yet
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            // and try again
-            goto again;
+            continue;
         }
+        else
+        {
+            pcm = this->currentSong->data;
 
-        // ensure PCM buffer(s) are well filled
-        this->currentSong->fillBuffer();
+            // seek within the pcm buffer to that item where the playhead points to, but make sure we dont run over the buffer; in doubt we should start again at the beginning of the buffer
+            itemOffset = FramesToItems(memorizedPlayhead) % bufSize;
+            // if the pcm buffer is a ring buffer, dont wrap around within a single write
+            framesToPush = std::min<frame_t>(framesToPush, (bufSize - itemOffset) / this->currentSong->Format.Channels());
 
-        if (framesWritten != framesToPush
-#ifdef USE_JACK
-            && gConfig.audioDriver != AudioDriver_t::Jack /*very spammy for jack*/
-#endif
-            )
+            if (!wholeSong)
+            {
+                // we dont hold the whole song, only play what the decoder has already prepared for us
+                frame_t framesAvailable = this->currentSong->getFramesRendered() - memorizedPlayhead;
+                if (framesAvailable <= 0 && this->realtime && this->currentSong->isSeeking())
+                {
+                    // we jumped somewhere the decoder has to seek to first, keep the audio driver busy meanwhile
+                    this->writeSilence(period);
+                    this->currentSong->fillBuffer();
+                    continue;
+                }
+                if (framesAvailable <= 0)
+                {
+                    // buffer underrun, give the decoder some time to catch up
+                    this->currentSong->fillBuffer();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                framesToPush = std::min(framesToPush, framesAvailable);
+            }
+            else
+            {
+                // the OS may have reclaimed parts of the song, in which case they are decoded again
+                const frame_t framesResident = this->currentSong->makeResident(memorizedPlayhead, framesToPush);
+                if (framesResident <= 0)
+                {
+                    // still being decoded again, give the decoder some time to catch up
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    continue;
+                }
+                framesToPush = std::min(framesToPush, framesResident);
+            }
+        }
+
+        int framesWritten;
+        if (!this->realtime || (this->assembler.empty() && framesToPush == period))
         {
-            CLOG(LogLevel_t::Info, "failed playing the rendered pcm chunk\nframes written: " << framesWritten << "\nframes pushed: " << framesToPush);
+            // PLAY! a whole period at once, no need to copy anything
+            // if we are not realtime, the driver doesnt care about the size of blocks anyway
+            framesWritten = this->writeBlock(pcm, framesToPush, itemOffset);
+        }
+        else
+        {
+            // we are about to jump somewhere else (loop point, end of ring buffer, end of song, ...) or the decoder
+            // is running late. dont bother the audio driver with a short write, rather collect the frames until the period is complete
+            if (this->assemblerSong != this->currentSong)
+            {
+                this->assemblerSong = this->currentSong;
+                this->assemblerStart = memorizedPlayhead;
+            }
+            this->assembler.append(pcm, itemOffset, framesToPush);
+            if (this->assembler.size() >= period)
+            {
+                this->flushBlock();
+            }
+            framesWritten = framesToPush;
         }
 
         // update the playhead
         this->playhead += framesWritten;
-        // notify observers
-        this->onPlayheadChanged(this->playhead);
-        this->onBufferHealthChanged(this->currentSong->getFramesRendered());
+
+        // the frames written are not needed anymore, ensure PCM buffer(s) are well filled
+        this->currentSong->setReadPosition(memorizedPlayhead + framesWritten);
+        this->currentSong->fillBuffer();
+
+        this->framesPushed += framesWritten;
+
+        // observers will be notified by notifyInternal()
+        this->framesRendered = this->currentSong->getFramesRendered();
+
+        // approaching the end of the song, let notifyInternal() prepare the next one, since that may take a while
+        if (!this->preloadRequested && !this->preloadTriggered && gConfig.GaplessPreloadTime != 0 &&
+            this->currentSong->getFrames() - this->playhead <= msToFrames(gConfig.GaplessPreloadTime, this->currentSong->Format.SampleRate))
+        {
+            this->preloadRequested = true;
+        }
 
         // update our local copy of playhead
         memorizedPlayhead += framesWritten;
         // update frames-left-to-play
         framesToPlay -= framesWritten;
     }
+
+    if (memorizedPlayhead != this->playhead && this->assemblerSong == this->currentSong)
+    {
+        // someone seeked, the frames of currentSong pending are not to be played anymore
+        this->dropBlock();
+    }
 }
 
 
+int Player::writeBlock(const pcm_t *buffer, frame_t frames, size_t offset)
+{
+    int framesWritten = 0;
+
+    // PLAY!
+again:
+    if (this->realtime)
+    {
+        // the user may mute voices during playback. non realtime drivers just take the mute mask passed to init()
+        this->audioDriver->SetMuteMask(this->currentSong->Format.VoiceIsMuted);
+    }
+
+    framesWritten = this->audioDriver->write(buffer, frames, offset);
+    // before we go on rendering the next pcm chunk, make sure we really played the current one.
+    //
+    // audioDriver.write() may return a value !=frames.
+    // In this case we should call audioDriver.write() again in order to fix playback whenever we dont hold the whole song in memory.
+    // However this breaks playback using jack, since there (usually) resampling is necessary and calling JackOutput::write() with only e.g. 100 frames will not produce enough resampled frames that can be put into jack's playback buffer, padding its buffer with zeros, resulting in interrupted playback.
+    //
+    // thus the case when audioDriver.write() was only able to partly play the provided pcm chunk, cannot be recovered
+    // but we can try it again whenever audioDriver failed at all (i.e. returned 0)
+    if (this->IsPlaying() && framesWritten == 0)
+    {
+        CLOG(LogLevel_t::Info, "failed to play the rendered pcm chunk, trying again");
+        // something went terribly wrong, wait some time, so the cpu doesnt get too busy
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // and try again
+        goto again;
+    }
+
+    if (framesWritten != frames
+#ifdef USE_JACK
+        && gConfig.audioDriver != AudioDriver_t::Jack /*very spammy for jack*/
+#endif
+        )
+    {
+        CLOG(LogLevel_t::Info, "failed playing the rendered pcm chunk\nframes written: " << framesWritten << "\nframes pushed: " << frames);
+    }
+
+    return framesWritten;
+}
+
+void Player::flushBlock()
+{
+    if (!this->assembler.empty())
+    {
+        this->writeBlock(this->assembler.data(), this->assembler.size(), 0);
+        this->dropBlock();
+    }
+}
+
+void Player::dropBlock() noexcept
+{
+    this->assembler.clear();
+    this->assemblerSong = nullptr;
+}
+
+void Player::writeSilence(frame_t frames)
+{
+    // the frames assembled so far precede the silence
+    this->flushBlock();
+
+    const SongFormat &format = this->currentSong->Format;
+    // unsigned samples are silent at their midpoint
+    this->silence.assign(static_cast<size_t>(frames) * format.getFrameSize(), format.SampleFormat == SampleFormat_t::uint8 ? 0x80 : 0);
+    this->writeBlock(this->silence.data(), frames, 0);
+}
+
+
+void Player::notifyInternal()
+{
+    frame_t lastPlayhead = -1;
+    frame_t lastRendered = -1;
+
+    std::unique_lock<std::mutex> lck(this->mtxNotify);
+    bool playing;
+    do
+    {
+        playing = !this->cvNotify.wait_for(lck, std::chrono::milliseconds(1000 / NotificationRate), [this] { return !this->IsPlaying(); });
+
+        // only fire if something changed, and do so without holding the lock
+        lck.unlock();
+
+        frame_t pos = this->playhead;
+        if (pos != lastPlayhead)
+        {
+            lastPlayhead = pos;
+            this->onPlayheadChanged(pos);
+        }
+
+        frame_t rendered = this->framesRendered;
+        if (rendered != lastRendered)
+        {
+            lastRendered = rendered;
+            this->onBufferHealthChanged(rendered);
+        }
+
+        if (this->isFadingOut && !this->audioDriver->IsRamping() && this->isFadingOut.exchange(false))
+        {
+            this->onFadeoutFinished();
+        }
+
+        // the playback thread only looks at the pressure read here (at most once a second), since reading it takes
+        // a few files and a rise releases the PCM of retained songs
+        RenderPolicy::Singleton().poll();
+
+        if (this->preloadRequested)
+        {
+            this->preloadNextSong();
+        }
+
+        lck.lock();
+    } while (playing);
+}
+
 void Player::playInternal()
 {
     ThreadPriority tp(Priority::High);
     Nullable<string> exceptionMsg = Nullable<string>();
     this->onIsPlayingChanged(this->IsPlaying(), exceptionMsg);
 
+    // frames left over from a previous playback session are not wanted anymore
+    this->dropBlock();
+    this->realtime = this->audioDriver->IsRealtime();
+
     try
     {
         this->audioDriver->start();
         while (this->IsPlaying())
         {
-            core::tree<loop_t> &loops = this->currentSong->loopTree;
+            auto songStart = std::chrono::steady_clock::now();
+            this->framesPushed = 0;
 
-            this->playLoop(loops);
+            this->playLoopPlan();
 
-            // ok, for some reason we left playLoop, if this was due to we shall stop playing
+            if (!this->realtime && this->framesPushed > 0)
+            {
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - songStart;
+                double duration = static_cast<double>(this->framesPushed) / this->currentSong->Format.SampleRate;
+                CLOG(LogLevel_t::Info, "rendered \"" << this->currentSong->Filename << "\" at " << duration / elapsed.count() << "x realtime");
+            }
+
+            // ok, for some reason we left playLoopPlan, if this was due to we shall stop playing
             // leave this loop immediately, else play next song
             if (!this->IsPlaying())
             {
                 break;
             }
-            this->_setCurrentSong(this->playlist->next());
+            this->_setCurrentSong(this->playlist->next(), true);
         }
     }
     catch (const std::exception &e)
@@ -567,12 +908,20 @@ void Player::playInternal()
         exceptionMsg = e.what();
     }
 
-    if (!this->IsSeekingPossible())
+    // if playback has been stopped, the audio driver drops any frames pending anyway. they have already been counted to
+    // the playhead though, so move it back to the first of them to continue there when playback is resumed. the playhead
+    // cannot be computed from the number of frames pending, since they may span loop jumps; frames of a previous song are
+    // just dropped
+    if (!this->assembler.empty() && this->assemblerSong == this->currentSong)
+    {
+        this->_seekTo(this->assemblerStart);
+    }
+    this->dropBlock();
+
+    // playback ended before the fadeout did, no reason to keep anyone waiting for it
+    if (this->isFadingOut.exchange(false))
     {
-        // in case we are not holding whole song in memory, align playhead to FramesToRender boundary to avoid corrupt playback next time
-        frame_t f = this->playhead;
-        f -= f % gConfig.FramesToRender;
-        this->_seekTo(f);
+        this->onFadeoutFinished();
     }
 
     this->onIsPlayingChanged(this->IsPlaying(), exceptionMsg);
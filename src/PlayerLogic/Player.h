@@ -1,17 +1,16 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include "BlockAssembler.h"
 #include "Event.h"
 #include "types.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <future>
+#include <mutex>
+#include <vector>
 
-namespace core
-{
-    template<typename T>
-    class tree;
-}
 class IAudioOutput;
 class IPlaylist;
 class Song;
@@ -28,6 +27,13 @@ class Player
     public:
     Player(IPlaylist *playlist);
 
+    /**
+     * uses @p audioDriver rather than the one indicated by gConfig.audioDriver, until this->initAudio() is called
+     *
+     * takes ownership of @p audioDriver and opens it
+     */
+    Player(IPlaylist *playlist, IAudioOutput *audioDriver);
+
     // forbid copying
     Player(Player const &) = delete;
     Player &operator=(Player const &) = delete;
@@ -66,12 +72,15 @@ class Player
     bool IsPlaying();
 
     /**
-     * @return true, if seeking withing the currently played song is possible
+     * @return true, if seeking withing the currently played song is possible, i.e. either its whole PCM
+     * is held in memory or its decoder supports seeking
      */
     bool IsSeekingPossible();
 
     /**
-     * smoothly decreases playback volume to zero. when this method returns, the volume reached zero and playback continues!
+     * smoothly decreases playback volume to zero. returns immediately, the fade is applied by the audio driver
+     * while playback continues. this->onFadeoutFinished is fired once the volume reached zero; playback continues
+     * silently afterwards, it's up to the caller to pause or stop it then.
      * 
      * @param fadeTime time in milliseconds needed to decrease the volume
      * @param fadeType specifies the fade type to use: 1 - linear; 2 - log; 3 - sine;
@@ -99,10 +108,18 @@ class Player
 
     void Mute(int i, bool);
 
-    Event<bool, Nullable<std::string>> onIsPlayingChanged;
+    /**
+     * discards the song that has been opened and pre-rendered in the background to allow gapless playback.
+     * must be called before songs get removed from the playlist, so that no song is kept open that is about to be deleted
+     */
+    void cancelPreload();
+
+    Event<bool, const Nullable<std::string> &> onIsPlayingChanged;
+    // while playing, these two are fired by a separate thread at no more than NotificationRate Hz
     Event<frame_t> onPlayheadChanged;
     Event<frame_t> onBufferHealthChanged;
     Event<const Song *> onCurrentSongChanged;
+    Event<> onFadeoutFinished;
 
 
     private:
@@ -129,30 +146,92 @@ class Player
     // future for the playing thread
     std::future<void> futurePlayInternal;
 
+    // future for the thread firing onPlayheadChanged and onBufferHealthChanged during playback
+    std::future<void> futureNotifyInternal;
+
+    // number of frames currentSong has rendered, published by the playing thread for this->notifyInternal()
+    std::atomic<frame_t> framesRendered{0};
+
+    // used to wake up this->notifyInternal() when playback stops
+    std::mutex mtxNotify;
+    std::condition_variable cvNotify;
+
+    // future for the thread that opens and pre-renders the song following currentSong, to allow gapless playback
+    // returns that song, or nullptr if preparing it failed
+    std::future<Song *> futurePreload;
+
+    // whether preloading the next song has already been started during playback of currentSong
+    std::atomic<bool> preloadTriggered{false};
+
+    // set by the playback thread when approaching the end of currentSong, so that notifyInternal() preloads the next song
+    std::atomic<bool> preloadRequested{false};
+
+    // synchronizes access to futurePreload and preloadTriggered made by playback thread and qt's gui thread
+    std::mutex mtxPreload;
+
+    // whether a fadeout has been requested and this->onFadeoutFinished is yet to be fired
+    std::atomic<bool> isFadingOut{false};
+
+    // whether this->audioDriver plays back in realtime, updated when the playback thread starts
+    bool realtime = true;
+
+    // number of frames pushed to the audio driver since currentSong started playing, including loops
+    frame_t framesPushed = 0;
+
+    // collects pcm to be written to the audio driver, whenever less than a period can be taken from currentSong at once
+    // only accessed by the playback thread
+    BlockAssembler assembler;
+
+    // the song whose frames have been appended to this->assembler last and the frame of that song the first of them
+    // has been taken from; the frames of a previous song may precede them. only accessed by the playback thread
+    Song *assemblerSong = nullptr;
+    frame_t assemblerStart = 0;
+
+    // buffer for writeSilence(), only accessed by the playback thread
+    std::vector<uint8_t> silence;
+
+    // future for the thread releasing the song that has been played before currentSong
+    std::future<void> futureRelease;
+
 
     /**
      * private methods containing the acutal implementation logic for their corresponding public ones
      */
     void _initAudio();
     void _seekTo(frame_t frame);
-    void _setCurrentSong(Song *newSong);
+    void _setCurrentSong(Song *newSong, bool releaseAsync = false);
     void _pause();
 
     /**
-     * within this->currentSong->loopTree at a level given by "l": retrieve that loop that starts just right after playhead
-     * 
-     * @return subloop as subnode
+     * @return true, if currentSong->data holds the whole PCM of the song, false if it is a ring buffer
+     */
+    bool holdsWholeSong();
+
+    /**
+     * to be called once @p song is not played anymore: if it holds its completely decoded PCM, it is kept in memory,
+     * so that playing it again doesnt require decoding it again; the PcmBudget will free it, once the memory is needed
+     */
+    void releaseOrRetain(Song *song);
+
+    /**
+     * asynchronously opens and pre-renders the song that follows this->currentSong in the playlist, if requested by the
+     * playback thread and not already done. called by notifyInternal(), so the playback thread never waits for it
      */
-    core::tree<loop_t> *getNextLoop(core::tree<loop_t> &l);
+    void preloadNextSong();
 
+    /**
+     * waits for the preloading of the next song to complete
+     *
+     * @return the preloaded song, ready for playback, or nullptr if no song has been preloaded
+     */
+    Song *takePreloadedSong();
 
     /**
-     * THAT method which recursively walks through a loop tree, playing all the loops, subloops and subsubsubloops given by "loop" recursively
+     * plays this->currentSong by walking through its loop plan, starting at whereever playhead stands
      *
-     * @note this is not the playing threads mainloop
-     * @note this method might be called recursively :P
+     * returns when the end of the song has been reached or playback has been stopped
      */
-    void playLoop(core::tree<loop_t> &loop);
+    void playLoopPlan();
 
 
     /**
@@ -179,10 +258,38 @@ class Player
      */
     void playFrames(frame_t framesToPlay);
 
+    /**
+     * pushes the given pcm to the audio driver, trying again if the driver failed to play anything
+     *
+     * @return number of frames written
+     */
+    int writeBlock(const pcm_t *buffer, frame_t frames, size_t offset);
+
+    /**
+     * writes the frames pending in this->assembler to the audio driver, even if they dont make up a whole period
+     */
+    void flushBlock();
+
+    /**
+     * drops the frames pending in this->assembler without playing them
+     */
+    void dropBlock() noexcept;
+
+    /**
+     * writes @p frames frames of silence to the audio driver, without moving the playhead, e.g. while currentSong is seeking
+     */
+    void writeSilence(frame_t frames);
+
     /**
      * the internal loop for the playing thread
      */
     void playInternal();
+
+    /**
+     * the loop of the thread delivering the playback progress to observers, so that a slow observer
+     * never delays the playing thread
+     */
+    void notifyInternal();
 };
 
 #endif // PLAYER_H
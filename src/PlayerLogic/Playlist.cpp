@@ -93,6 +93,18 @@ Song *Playlist::next()
     return this->setCurrentSong((this->currentSong + 1) % this->queue.size());
 }
 
+Song *Playlist::peekNext()
+{
+    std::lock_guard<std::recursive_mutex> lck(this->mtx);
+
+    if (this->queue.empty())
+    {
+        return nullptr;
+    }
+
+    return this->getSong((this->currentSong + 1) % this->queue.size());
+}
+
 Song *Playlist::previous()
 {
     std::lock_guard<std::recursive_mutex> lck(this->mtx);
@@ -32,6 +32,8 @@ class Playlist : public IPlaylist
 
     Song *next() override;
 
+    Song *peekNext() override;
+
     Song *previous() override;
 
     Song *getSong(size_t id) const override;
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Event.h"
+#include "Nullable.h"
+
+using namespace std;
+
+
+// the map and mutex based implementation Event used before, for comparison
+template<typename... Args>
+class MapEvent
+{
+    std::map<void *, void (*)(void *, Args...)> callbacks;
+    std::mutex mtx;
+
+    public:
+    void operator+=(std::pair<void *, void (*)(void *, Args...)> t)
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->callbacks[t.first] = t.second;
+    }
+
+    void operator()(Args... args)
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        for (auto it = this->callbacks.begin(); it != this->callbacks.end(); it++)
+        {
+            it->second(it->first, args...);
+        }
+    }
+};
+
+static volatile size_t sink = 0;
+
+static void OnFireByValue(void *, bool b, Nullable<string> msg)
+{
+    sink += b + msg.Value.size();
+}
+
+static void OnFireByRef(void *, bool b, const Nullable<string> &msg)
+{
+    sink += b + msg.Value.size();
+}
+
+// returns nanoseconds per fire
+template<typename EVENT>
+double Measure(EVENT &event, const Nullable<string> &msg)
+{
+    constexpr int Runs = 1000000;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < Runs; i++)
+    {
+        event(true, msg);
+    }
+    chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+
+    return elapsed.count() / Runs;
+}
+
+
+int main()
+{
+    const Nullable<string> msg(string("a message long enough to defeat the small string optimization"));
+
+    for (int subscribers : {1, 4, 16})
+    {
+        vector<int> contexts(subscribers);
+
+        MapEvent<bool, Nullable<string>> mapEvent;
+        Event<bool, const Nullable<string> &> event;
+        for (int &c : contexts)
+        {
+            mapEvent += make_pair(&c, &OnFireByValue);
+            event += make_pair(&c, &OnFireByRef);
+        }
+
+        cout << subscribers << " subscribers:" << endl;
+        cout << "    map + mutex: " << Measure(mapEvent, msg) << " ns per fire" << endl;
+        cout << "    copy-on-write: " << Measure(event, msg) << " ns per fire" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "MixKernels.h"
+#include "NullOutput.h"
+
+using namespace std;
+
+
+static const char *IsaName(MixIsa isa)
+{
+    switch (isa)
+    {
+        case MixIsa::Scalar:
+            return "scalar";
+        case MixIsa::SSE2:
+            return "sse2";
+        case MixIsa::AVX2:
+            return "avx2";
+    }
+    return "";
+}
+
+// returns the number of frames mixed per second
+template<typename TIN, typename TOUT, bool Generic>
+double Measure(NullOutput &output, const SongFormat &format)
+{
+    constexpr frame_t Frames = 2048;
+    constexpr int Runs = 2000;
+
+    vector<TIN> in(Frames * format.Channels(), TIN(1));
+    vector<TOUT> out(Frames * output.GetOutputChannels());
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < Runs; i++)
+    {
+        if (Generic)
+        {
+            output.MixGeneric<TIN, TOUT>(Frames, in.data(), format, out.data());
+        }
+        else
+        {
+            output.Mix<TIN, TOUT>(Frames, in.data(), format, out.data());
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    return Frames * Runs / elapsed.count();
+}
+
+template<typename TIN, typename TOUT>
+void Bench(NullOutput &output, const SongFormat &format, const char *name)
+{
+    cout << name << ":" << endl;
+    cout << "    generic: " << Measure<TIN, TOUT, true>(output, format) / 1e6 << " Mframes/s" << endl;
+    for (MixIsa isa : {MixIsa::Scalar, MixIsa::SSE2, MixIsa::AVX2})
+    {
+        if (MixSetIsa(isa))
+        {
+            cout << "    " << IsaName(isa) << ": " << Measure<TIN, TOUT, false>(output, format) / 1e6 << " Mframes/s" << endl;
+        }
+    }
+}
+
+template<typename TIN, typename TOUT>
+void BenchLayouts(NullOutput &output, const char *types)
+{
+    SongFormat format;
+    output.setVolume(0.8f);
+
+    format.SetVoices(1);
+    format.VoiceChannels[0] = 2;
+    Bench<TIN, TOUT>(output, format, (string(types) + " stereo passthrough").c_str());
+
+    format.VoiceChannels[0] = 1;
+    Bench<TIN, TOUT>(output, format, (string(types) + " mono to stereo").c_str());
+
+    format.SetVoices(8);
+    for (int i = 0; i < 8; i++)
+    {
+        format.VoiceChannels[i] = 2;
+    }
+    Bench<TIN, TOUT>(output, format, (string(types) + " 8 stereo voices to stereo").c_str());
+}
+
+// what LibMadWrapper::render() used to do for every mpeg frame: convert sample by sample, keeping what doesnt fit in a vector
+static void ConvertFixedPerSample(const int32_t *left, const int32_t *right, int32_t *out, size_t frames, vector<int32_t> &tempBuf, bool normalize, float gain)
+{
+    auto toInt24 = [](int32_t sample) {
+        sample += (1L << (28 - 24));
+        sample = min(max(sample, -(1 << 28)), (1 << 28) - 1);
+        sample >>= (28 + 1 - 24);
+        return sample * 256;
+    };
+
+    // a quarter of each frame doesnt fit into the buffer, is pushed back and erased from the front on the next call
+    const size_t direct = frames * 3 / 4;
+    memcpy(out, tempBuf.data(), tempBuf.size() * sizeof(int32_t));
+    tempBuf.erase(tempBuf.begin(), tempBuf.end());
+    for (size_t f = 0; f < direct; f++)
+    {
+        int32_t sample = toInt24(left[f]);
+        out[2 * f] = normalize ? floor(sample * gain) : sample;
+        sample = toInt24(right[f]);
+        out[2 * f + 1] = normalize ? floor(sample * gain) : sample;
+    }
+    for (size_t f = direct; f < frames; f++)
+    {
+        int32_t sample = toInt24(left[f]);
+        tempBuf.push_back(normalize ? floor(sample * gain) : sample);
+        sample = toInt24(right[f]);
+        tempBuf.push_back(normalize ? floor(sample * gain) : sample);
+    }
+}
+
+// returns the number of frames converted per second
+template<bool PerSample>
+double MeasureConvertFixed(float gain)
+{
+    constexpr size_t Frames = 1152;
+    constexpr int Runs = 20000;
+
+    vector<int32_t> left(Frames), right(Frames), out(Frames * 2);
+    for (size_t i = 0; i < Frames; i++)
+    {
+        left[i] = static_cast<int32_t>(sin(i * 0.01) * (1 << 28));
+        right[i] = static_cast<int32_t>(cos(i * 0.01) * (1 << 28));
+    }
+    vector<int32_t> tempBuf;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < Runs; i++)
+    {
+        if (PerSample)
+        {
+            ConvertFixedPerSample(left.data(), right.data(), out.data(), Frames, tempBuf, gain != 1.0f, gain);
+        }
+        else
+        {
+            MixConvertFixed(left.data(), right.data(), out.data(), Frames, 2, gain);
+        }
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    return Frames * Runs / elapsed.count();
+}
+
+void BenchConvertFixed()
+{
+    for (float gain : {1.0f, 0.8f})
+    {
+        cout << "libmad fixed point -> int32 stereo" << (gain != 1.0f ? ", normalized" : "") << ":" << endl;
+        cout << "    per sample: " << MeasureConvertFixed<true>(gain) / 1e6 << " Mframes/s" << endl;
+        for (MixIsa isa : {MixIsa::Scalar, MixIsa::SSE2, MixIsa::AVX2})
+        {
+            if (MixSetIsa(isa))
+            {
+                cout << "    " << IsaName(isa) << ": " << MeasureConvertFixed<false>(gain) / 1e6 << " Mframes/s" << endl;
+            }
+        }
+    }
+}
+
+
+// returns the number of frames interleaved per second
+template<typename T>
+double MeasureInterleave()
+{
+    constexpr size_t Frames = 4096;
+    constexpr int Runs = 20000;
+
+    vector<T> left(Frames), right(Frames), out(Frames * 2);
+    for (size_t i = 0; i < Frames; i++)
+    {
+        left[i] = static_cast<T>(i);
+        right[i] = static_cast<T>(Frames - i);
+    }
+    const T *planes[2] = {left.data(), right.data()};
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < Runs; i++)
+    {
+        MixInterleave(planes, out.data(), Frames, 2);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    return Frames * Runs / elapsed.count();
+}
+
+template<typename T>
+void BenchInterleave(const char *name)
+{
+    cout << name << ":" << endl;
+    for (MixIsa isa : {MixIsa::Scalar, MixIsa::SSE2, MixIsa::AVX2})
+    {
+        if (MixSetIsa(isa))
+        {
+            cout << "    " << IsaName(isa) << ": " << MeasureInterleave<T>() / 1e6 << " Mframes/s" << endl;
+        }
+    }
+}
+
+
+int main()
+{
+    NullOutput output;
+    output.SetOutputChannels(2);
+
+    BenchLayouts<int16_t, int16_t>(output, "int16 -> int16");
+    BenchLayouts<int32_t, int32_t>(output, "int32 -> int32");
+    BenchLayouts<float, float>(output, "float -> float");
+    BenchLayouts<int16_t, float>(output, "int16 -> float");
+    BenchLayouts<int32_t, float>(output, "int32 -> float");
+
+    BenchConvertFixed();
+    BenchInterleave<int16_t>("planar int16 -> interleaved stereo");
+    BenchInterleave<float>("planar float -> interleaved stereo");
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PcmCodec.h"
+
+using namespace std;
+
+
+// something resembling music: a few partials at half of full scale plus some noise
+template<typename T>
+vector<T> Signal(frame_t frames, uint32_t channels, double fullScale, double noise)
+{
+    mt19937 rng(1);
+    normal_distribution<double> dist(0.0, noise);
+
+    vector<T> pcm(frames * channels);
+    for (frame_t f = 0; f < frames; f++)
+    {
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            double s = 0.25 * sin(f * 0.0627 + c) + 0.15 * sin(f * 0.1883) + 0.1 * sin(f * 0.0091 * (c + 1)) + dist(rng);
+            pcm[f * channels + c] = static_cast<T>(s * fullScale);
+        }
+    }
+    return pcm;
+}
+
+template<typename T>
+void Bench(const char *name, const vector<T> &pcm, uint32_t channels)
+{
+    const frame_t Frames = pcm.size() / channels;
+    constexpr int Runs = 20;
+
+    vector<uint8_t> encoded;
+    vector<size_t> offsets;
+
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < Runs; r++)
+    {
+        encoded.clear();
+        offsets.clear();
+        for (frame_t f = 0; f < Frames; f += PcmBlockFrames)
+        {
+            offsets.push_back(encoded.size());
+            PcmEncodeBlock(pcm.data() + f * channels, channels, min(PcmBlockFrames, Frames - f), encoded);
+        }
+    }
+    chrono::duration<double> encodeTime = chrono::steady_clock::now() - start;
+
+    vector<T> decoded(pcm.size());
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < Runs; r++)
+    {
+        for (size_t b = 0; b < offsets.size(); b++)
+        {
+            const frame_t f = b * PcmBlockFrames;
+            PcmDecodeBlock(encoded.data() + offsets[b], channels, min(PcmBlockFrames, Frames - f), decoded.data() + f * channels);
+        }
+    }
+    chrono::duration<double> decodeTime = chrono::steady_clock::now() - start;
+
+    const double ratio = static_cast<double>(encoded.size()) / (pcm.size() * sizeof(T));
+    cout << name << ":" << endl;
+    cout << "    compressed to: " << ratio * 100 << " %" << endl;
+    cout << "    encode: " << Frames * Runs / encodeTime.count() / 1e6 << " Mframes/s" << endl;
+    cout << "    decode: " << Frames * Runs / decodeTime.count() / 1e6 << " Mframes/s, " << decodeTime.count() * 1e9 / (Frames * Runs) << " ns/frame" << endl;
+}
+
+int main()
+{
+    // one minute of stereo at 44.1 kHz
+    constexpr frame_t Frames = 60 * 44100;
+
+    Bench("int16 stereo", Signal<int16_t>(Frames, 2, 32767, 0.001), 2);
+    Bench("int16 stereo, quiet", Signal<int16_t>(Frames, 2, 3000, 0.001), 2);
+    Bench("int32 stereo", Signal<int32_t>(Frames, 2, 2147483647, 0.001), 2);
+    Bench("int32 stereo, 24 bit source", Signal<int32_t>(Frames, 2, 8388607, 0.001), 2);
+    Bench("float stereo", Signal<float>(Frames, 2, 1, 0.001), 2);
+
+    // what most decoders deliver as float: 16 bit PCM converted
+    vector<int16_t> pcm16 = Signal<int16_t>(Frames, 2, 32767, 0.001);
+    vector<float> pcm16f(pcm16.size());
+    for (size_t i = 0; i < pcm16.size(); i++)
+    {
+        pcm16f[i] = pcm16[i] / 32768.0f;
+    }
+    Bench("float stereo, 16 bit source", pcm16f, 2);
+    Bench("float stereo, silence", vector<float>(Frames * 2, 0.0f), 2);
+    Bench("double stereo", Signal<double>(Frames, 2, 1, 0.001), 2);
+
+    return 0;
+}
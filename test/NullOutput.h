@@ -0,0 +1,58 @@
+#pragma once
+
+#include "IAudioOutput.h"
+#include "IAudioOutput_impl.h"
+
+// minimal implementation of IAudioOutput, that discards all PCM, but allows to access its internals
+class NullOutput : public IAudioOutput
+{
+    public:
+    using IAudioOutput::Mix;
+    using IAudioOutput::MixGeneric;
+    using IAudioOutput::Process;
+    using IAudioOutput::passthrough;
+    using IAudioOutput::write;
+
+    void open() override
+    {
+    }
+
+    void init(SongFormat &format, bool) override
+    {
+        this->currentFormat = format;
+    }
+
+    void start() override
+    {
+    }
+
+    void stop() override
+    {
+    }
+
+    void close() override
+    {
+    }
+
+    // the pcm most recently handed to the driver
+    const void *lastWritten = nullptr;
+
+    protected:
+    int write(const float *buffer, frame_t frames) override
+    {
+        this->lastWritten = this->Process<float>(frames, buffer);
+        return frames;
+    }
+
+    int write(const int16_t *buffer, frame_t frames) override
+    {
+        this->lastWritten = this->Process<int16_t>(frames, buffer);
+        return frames;
+    }
+
+    int write(const int32_t *buffer, frame_t frames) override
+    {
+        this->lastWritten = this->Process<int32_t>(frames, buffer);
+        return frames;
+    }
+};
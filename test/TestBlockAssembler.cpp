@@ -0,0 +1,58 @@
+#include <vector>
+
+#include "BlockAssembler.h"
+#include "Test.h"
+
+using namespace std;
+
+
+int main()
+{
+    SongFormat format;
+    format.SampleFormat = SampleFormat_t::int16;
+    format.SampleRate = 44100;
+    format.SetVoices(1);
+    format.VoiceChannels[0] = 2;
+
+    vector<int16_t> pcm(200);
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        pcm[i] = static_cast<int16_t>(i);
+    }
+
+    BlockAssembler assembler;
+    assembler.setFormat(format);
+    TEST_ASSERT(assembler.empty());
+
+    // splice two regions of the buffer, as it happens when jumping back to a loop start
+    assembler.append(pcm.data(), 40, 10);
+    assembler.append(pcm.data(), 10, 5);
+    TEST_ASSERT(assembler.size() == 15);
+
+    const int16_t *data = static_cast<const int16_t *>(assembler.data());
+    for (int i = 0; i < 20; i++)
+    {
+        TEST_ASSERT(data[i] == 40 + i);
+    }
+    for (int i = 0; i < 10; i++)
+    {
+        TEST_ASSERT(data[20 + i] == 10 + i);
+    }
+
+    assembler.clear();
+    TEST_ASSERT(assembler.empty());
+
+    // pcm of a song having the same layout can be spliced, others cannot
+    SongFormat other = format;
+    TEST_ASSERT(assembler.accepts(other));
+    other.SampleRate = 48000;
+    TEST_ASSERT(!assembler.accepts(other));
+    other = format;
+    other.SampleFormat = SampleFormat_t::float32;
+    TEST_ASSERT(!assembler.accepts(other));
+    other = format;
+    other.VoiceChannels[0] = 1;
+    TEST_ASSERT(!assembler.accepts(other));
+
+    return 0;
+}
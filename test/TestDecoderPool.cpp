@@ -0,0 +1,61 @@
+#include <atomic>
+#include <vector>
+
+#include "DecoderPool.h"
+#include "Test.h"
+
+using namespace std;
+
+
+int main()
+{
+    DecoderPool &pool = DecoderPool::Singleton();
+    TEST_ASSERT(pool.size() > 0);
+
+    // tasks of the same owner must run in order and never concurrently
+    constexpr int Owners = 4;
+    constexpr int TasksPerOwner = 200;
+
+    vector<int> executed[Owners];
+    atomic<int> concurrent[Owners] = {};
+    atomic<bool> overlapped{false};
+    vector<future<void>> futures;
+
+    for (int i = 0; i < TasksPerOwner; i++)
+    {
+        for (int o = 0; o < Owners; o++)
+        {
+            futures.push_back(pool.submit(&executed[o], [&, o, i]() {
+                if (concurrent[o]++ != 0)
+                {
+                    overlapped = true;
+                }
+                executed[o].push_back(i);
+                concurrent[o]--;
+            }));
+        }
+    }
+
+    for (future<void> &f : futures)
+    {
+        f.wait();
+    }
+
+    TEST_ASSERT(!overlapped);
+    for (int o = 0; o < Owners; o++)
+    {
+        TEST_ASSERT(executed[o].size() == TasksPerOwner);
+        for (int i = 0; i < TasksPerOwner; i++)
+        {
+            TEST_ASSERT(executed[o][i] == i);
+        }
+    }
+
+    // a failing task must neither take down the worker nor block the owner's queue
+    bool ranAfterFailure = false;
+    pool.submit(&pool, []() { throw std::runtime_error("expected failure"); });
+    pool.submit(&pool, [&]() { ranAfterFailure = true; }).wait();
+    TEST_ASSERT(ranAfterFailure);
+
+    return 0;
+}
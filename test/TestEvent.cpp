@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Event.h"
+#include "Test.h"
+
+using namespace std;
+
+
+struct Subscriber
+{
+    Event<int, const string &> *event = nullptr;
+    int calls = 0;
+    int sum = 0;
+
+    static void OnFire(void *context, int i, const string &s)
+    {
+        Subscriber *pthis = static_cast<Subscriber *>(context);
+        pthis->calls++;
+        pthis->sum += i + static_cast<int>(s.size());
+    }
+
+    static void OnFireOnce(void *context, int i, const string &s)
+    {
+        OnFire(context, i, s);
+
+        // unsubscribing from within the callback must neither deadlock nor disturb the current dispatch
+        Subscriber *pthis = static_cast<Subscriber *>(context);
+        *pthis->event -= pthis;
+    }
+};
+
+// a subscriber being destroyed right after unsubscribing, while another thread keeps firing
+struct Volatile
+{
+    atomic<bool> alive{true};
+    atomic<int> calls{0};
+
+    static void OnFire(void *context, int, const string &)
+    {
+        Volatile *pthis = static_cast<Volatile *>(context);
+        TEST_ASSERT(pthis->alive);
+        pthis->calls++;
+
+        // give the other thread a chance to unsubscribe meanwhile
+        this_thread::sleep_for(chrono::microseconds(50));
+        TEST_ASSERT(pthis->alive);
+    }
+};
+
+void TestConcurrentUnsubscribe()
+{
+    Event<int, const string &> event;
+    const string str("abc");
+
+    atomic<bool> stop{false};
+    thread firing([&]() {
+        while (!stop)
+        {
+            event(1, str);
+        }
+    });
+
+    for (int i = 0; i < 200; i++)
+    {
+        Volatile v;
+        event += make_pair(&v, &Volatile::OnFire);
+        while (v.calls == 0)
+        {
+            this_thread::yield();
+        }
+
+        event -= &v;
+        // no dispatch may see it anymore
+        v.alive = false;
+    }
+
+    stop = true;
+    firing.join();
+}
+
+// a subscriber subscribing someone else from within its callback, while another thread is unsubscribing it
+struct Subscribing
+{
+    Event<int, const string &> *event = nullptr;
+    Subscriber other;
+    atomic<bool> entered{false};
+    atomic<int> running{0};
+
+    static void OnFire(void *context, int, const string &)
+    {
+        Subscribing *pthis = static_cast<Subscribing *>(context);
+
+        // firing is serialized, even if done by different threads
+        TEST_ASSERT(++pthis->running == 1);
+        pthis->entered = true;
+
+        // give the other thread a chance to start waiting for this dispatch
+        this_thread::sleep_for(chrono::milliseconds(20));
+        *pthis->event += make_pair(&pthis->other, &Subscriber::OnFire);
+
+        pthis->running--;
+    }
+};
+
+void TestSubscribeWhileUnsubscribing()
+{
+    Event<int, const string &> event;
+    const string str("abc");
+
+    Subscribing s;
+    s.event = &event;
+    event += make_pair(&s, &Subscribing::OnFire);
+
+    thread firing([&]() { event(1, str); });
+    thread firingToo([&]() { event(1, str); });
+    while (!s.entered)
+    {
+        this_thread::yield();
+    }
+
+    // must not hold any lock the callback needs while waiting for it
+    event -= &s;
+
+    firing.join();
+    firingToo.join();
+}
+
+
+int main()
+{
+    Event<int, const string &> event;
+    Subscriber a, b, c;
+    a.event = b.event = c.event = &event;
+
+    const string str("abc");
+
+    // firing without subscribers
+    event(1, str);
+
+    event += make_pair(&a, &Subscriber::OnFire);
+    event += make_pair(&b, &Subscriber::OnFireOnce);
+    event += make_pair(&c, &Subscriber::OnFire);
+    event(1, str);
+    TEST_ASSERT(a.calls == 1 && b.calls == 1 && c.calls == 1);
+    TEST_ASSERT(a.sum == 4);
+
+    // b unsubscribed itself
+    event(2, str);
+    TEST_ASSERT(a.calls == 2 && b.calls == 1 && c.calls == 2);
+
+    // subscribing the same object again replaces its callback
+    event += make_pair(&a, &Subscriber::OnFireOnce);
+    event(3, str);
+    event(3, str);
+    TEST_ASSERT(a.calls == 3 && c.calls == 4);
+
+    // unsubscribing requires the matching callback
+    event -= make_pair(&c, &Subscriber::OnFireOnce);
+    event(4, str);
+    TEST_ASSERT(c.calls == 5);
+    event -= make_pair(&c, &Subscriber::OnFire);
+    event(4, str);
+    TEST_ASSERT(c.calls == 5);
+
+    TestConcurrentUnsubscribe();
+    TestSubscribeWhileUnsubscribing();
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <vector>
+
+#include "LoopPlan.h"
+#include "Test.h"
+
+using namespace std;
+
+
+static loop_t MakeLoop(frame_t start, frame_t stop, uint32_t count)
+{
+    loop_t l;
+    l.start = start;
+    l.stop = stop;
+    l.count = count;
+    return l;
+}
+
+static void Append(vector<frame_t> &frames, frame_t start, frame_t stop, int times = 1)
+{
+    while (times-- > 0)
+    {
+        for (frame_t f = start; f < stop; f++)
+        {
+            frames.push_back(f);
+        }
+    }
+}
+
+// plays the plan from the given frame on, like the Player does, returning the frames in the order they are played
+static vector<frame_t> Play(const LoopPlan &plan, frame_t from, bool useLoops, int overridingCount, size_t maxFrames)
+{
+    vector<frame_t> played;
+
+    LoopPlan::Cursor cursor;
+    plan.seek(cursor, from);
+
+    frame_t playhead = from;
+    while (cursor.segment < plan.segments().size() && played.size() < maxFrames)
+    {
+        const LoopPlan::Segment &seg = plan.segments()[cursor.segment];
+        Append(played, playhead, seg.stop);
+
+        playhead = plan.advance(cursor, useLoops, overridingCount);
+    }
+
+    played.resize(min(played.size(), maxFrames));
+    return played;
+}
+
+
+int main()
+{
+    constexpr frame_t Frames = 100;
+
+    /*
+                        ([0,100],1)
+                     /       |      \
+             ([10,50],3)  ([60,70],1)  ([80,90],0)
+              /      \
+      ([20,30],2)  ([30,50],2)
+    */
+    core::tree<loop_t> loopTree;
+    *loopTree = MakeLoop(0, Frames, 1);
+    core::tree<loop_t>::iterator outer = loopTree.insert(MakeLoop(10, 50, 3));
+    outer.tree_ref().insert(MakeLoop(20, 30, 2));
+    outer.tree_ref().insert(MakeLoop(30, 50, 2));
+    loopTree.insert(MakeLoop(60, 70, 1));
+    loopTree.insert(MakeLoop(80, 90, 0));
+
+    LoopPlan plan;
+    TEST_ASSERT(plan.empty());
+    plan.compile(loopTree);
+    TEST_ASSERT(!plan.empty());
+
+    // without taking loops, the segments cover the whole song in order
+    const vector<LoopPlan::Segment> &segments = plan.segments();
+    frame_t pos = 0;
+    for (const LoopPlan::Segment &seg : segments)
+    {
+        TEST_ASSERT(seg.start == pos);
+        TEST_ASSERT(seg.stop >= seg.start);
+        pos = seg.stop;
+    }
+    TEST_ASSERT(pos == Frames);
+
+    vector<frame_t> once;
+    Append(once, 0, Frames);
+    TEST_ASSERT(Play(plan, 0, false, -1, 10000) == once);
+    TEST_ASSERT(Play(plan, 0, true, 1, 10000) == once);
+
+    // nested loops, including two loops ending at the same frame
+    vector<frame_t> expected;
+    Append(expected, 0, 10);
+    for (int i = 0; i < 3; i++)
+    {
+        Append(expected, 10, 20);
+        Append(expected, 20, 30, 2);
+        Append(expected, 30, 50, 2);
+    }
+    Append(expected, 50, 80);
+    // the last loop is played forever
+    Append(expected, 80, 90, 5);
+    TEST_ASSERT(Play(plan, 0, true, -1, expected.size()) == expected);
+
+    // overriding the count of all loops
+    expected.clear();
+    Append(expected, 0, 10);
+    for (int i = 0; i < 2; i++)
+    {
+        Append(expected, 10, 20);
+        Append(expected, 20, 30, 2);
+        Append(expected, 30, 50, 2);
+    }
+    Append(expected, 50, 60);
+    Append(expected, 60, 70, 2);
+    Append(expected, 70, 80);
+    Append(expected, 80, 90, 2);
+    Append(expected, 90, Frames);
+    TEST_ASSERT(Play(plan, 0, true, 2, 10000) == expected);
+
+    // seeking into a loop continues to play that loop
+    expected.clear();
+    Append(expected, 25, 30);
+    Append(expected, 20, 30);
+    Append(expected, 30, 50, 2);
+    Append(expected, 10, 20);
+    TEST_ASSERT(Play(plan, 25, true, -1, expected.size()) == expected);
+
+    // seeking beyond the end
+    LoopPlan::Cursor cursor;
+    plan.seek(cursor, Frames);
+    TEST_ASSERT(cursor.segment == segments.size());
+
+    // a song without any loops
+    core::tree<loop_t> flatTree;
+    *flatTree = MakeLoop(0, Frames, 1);
+    plan.compile(flatTree);
+    TEST_ASSERT(plan.segments().size() == 1);
+    TEST_ASSERT(Play(plan, 0, true, -1, 10000) == once);
+
+    return 0;
+}
@@ -0,0 +1,326 @@
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "MixKernels.h"
+#include "NullOutput.h"
+#include "Test.h"
+
+using namespace std;
+
+
+template<typename T>
+vector<T> GenPcm(size_t items)
+{
+    mt19937 gen(items);
+    vector<T> pcm(items);
+    for (T &item : pcm)
+    {
+        if (is_floating_point<T>())
+        {
+            item = uniform_real_distribution<float>(-1.0f, 1.0f)(gen);
+        }
+        else
+        {
+            item = static_cast<T>(uniform_int_distribution<int64_t>(numeric_limits<T>::min(), numeric_limits<T>::max())(gen));
+        }
+    }
+    return pcm;
+}
+
+// the vectorized kernels must produce the same output as the generic implementation, apart from rounding
+template<typename TIN, typename TOUT>
+void TestLayout(NullOutput &output, const SongFormat &format)
+{
+    constexpr frame_t Frames = 5003;
+    const double tolerance = is_floating_point<TOUT>() ? 1e-6 : 1.0;
+
+    vector<TIN> in = GenPcm<TIN>(Frames * format.Channels());
+    vector<TOUT> expected(Frames * output.GetOutputChannels());
+    vector<TOUT> actual(Frames * output.GetOutputChannels());
+
+    output.MixGeneric<TIN, TOUT>(Frames, in.data(), format, expected.data());
+    output.Mix<TIN, TOUT>(Frames, in.data(), format, actual.data());
+
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        TEST_ASSERT(std::abs(static_cast<double>(expected[i]) - static_cast<double>(actual[i])) <= tolerance);
+    }
+}
+
+template<typename TIN, typename TOUT>
+void TestAllLayouts(NullOutput &output)
+{
+    SongFormat format;
+
+    // passthrough
+    output.SetOutputChannels(2);
+    format.SetVoices(1);
+    format.VoiceChannels[0] = 2;
+    TestLayout<TIN, TOUT>(output, format);
+
+    // passthrough of 5.1
+    output.SetOutputChannels(6);
+    format.VoiceChannels[0] = 6;
+    TestLayout<TIN, TOUT>(output, format);
+
+    // mono to stereo
+    output.SetOutputChannels(2);
+    format.VoiceChannels[0] = 1;
+    TestLayout<TIN, TOUT>(output, format);
+
+    // several stereo voices to stereo, summing up beyond the limits of TOUT
+    format.SetVoices(4);
+    for (int i = 0; i < 4; i++)
+    {
+        format.VoiceChannels[i] = 2;
+    }
+    format.VoiceIsMuted[1] = true;
+    TestLayout<TIN, TOUT>(output, format);
+
+    // generic fallback: two voices of different channel count
+    format.SetVoices(2);
+    format.VoiceChannels[0] = 1;
+    format.VoiceChannels[1] = 3;
+    TestLayout<TIN, TOUT>(output, format);
+}
+
+// if no mixing is needed, the pcm must be passed on to the driver as it is, or be converted only
+template<typename TIN>
+void TestPassthrough(NullOutput &output)
+{
+    constexpr frame_t Frames = 1001;
+
+    SongFormat format;
+    format.SampleFormat = is_same<TIN, float>() ? SampleFormat_t::float32 : is_same<TIN, int16_t>() ? SampleFormat_t::int16 : SampleFormat_t::int32;
+    format.SetVoices(1);
+    format.VoiceChannels[0] = 2;
+    output.SetOutputChannels(2);
+    output.init(format, false);
+
+    vector<TIN> in = GenPcm<TIN>(Frames * 2);
+
+    output.setVolume(1.0f);
+    output.write(in.data(), Frames, 0);
+    TEST_ASSERT(output.passthrough);
+    TEST_ASSERT(output.lastWritten == in.data());
+
+    if (!is_floating_point<TIN>())
+    {
+        vector<float> expected(Frames * 2);
+        output.Mix<TIN, float>(Frames, in.data(), format, expected.data());
+        const float *actual = output.Process<TIN, float>(Frames, in.data());
+        TEST_ASSERT(static_cast<const void *>(actual) != in.data());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            TEST_ASSERT(std::abs(expected[i] - actual[i]) <= 1e-6);
+        }
+    }
+
+    output.setVolume(0.5f);
+    output.write(in.data(), Frames, 0);
+    TEST_ASSERT(!output.passthrough);
+    TEST_ASSERT(output.lastWritten != in.data());
+
+    output.setVolume(1.0f);
+    format.VoiceIsMuted[0] = true;
+    output.init(format, false);
+    output.write(in.data(), Frames, 0);
+    TEST_ASSERT(!output.passthrough);
+}
+
+// a gain ramp must be applied frame by frame, continuing seamlessly across several calls to write()
+void TestRamp(NullOutput &output)
+{
+    constexpr frame_t Frames = 600;
+    constexpr frame_t RampLength = 1000;
+
+    SongFormat format;
+    format.SampleFormat = SampleFormat_t::float32;
+    format.SetVoices(1);
+    format.VoiceChannels[0] = 2;
+    output.SetOutputChannels(2);
+    output.init(format, false);
+    output.setVolume(1.0f);
+
+    vector<float> in(Frames * 2, 0.5f);
+
+    output.rampVolume(0.0f, RampLength, GainCurve::Linear);
+    TEST_ASSERT(output.IsRamping());
+
+    for (frame_t done = 0; done < 2 * Frames; done += Frames)
+    {
+        output.write(in.data(), Frames, 0);
+        TEST_ASSERT(!output.passthrough);
+
+        const float *out = static_cast<const float *>(output.lastWritten);
+        for (frame_t f = 0; f < Frames; f++)
+        {
+            const float expected = 0.5f * std::max(0.0f, 1.0f - static_cast<float>(done + f) / RampLength);
+            TEST_ASSERT(std::abs(out[2 * f] - expected) <= 1e-6);
+            TEST_ASSERT(out[2 * f] == out[2 * f + 1]);
+        }
+    }
+    TEST_ASSERT(!output.IsRamping());
+
+    // the target gain is kept after the ramp finished
+    output.write(in.data(), Frames, 0);
+    TEST_ASSERT(static_cast<const float *>(output.lastWritten)[0] == 0.0f);
+
+    // jump back to unity gain at once
+    output.rampVolume(1.0f, 0);
+    TEST_ASSERT(output.IsRamping());
+    output.write(in.data(), Frames, 0);
+    TEST_ASSERT(!output.IsRamping());
+    TEST_ASSERT(output.passthrough);
+}
+
+// the conversion of libmad's fixed point samples as LibMadWrapper::render() used to do it, sample by sample
+static int32_t FixedToInt24Reference(int32_t sample, float gain)
+{
+    sample += (1L << (28 - 24));
+    if (sample >= (1 << 28))
+    {
+        sample = (1 << 28) - 1;
+    }
+    else if (sample < -(1 << 28))
+    {
+        sample = -(1 << 28);
+    }
+    sample >>= (28 + 1 - 24);
+    sample *= 256;
+
+    return gain != 1.0f ? static_cast<int32_t>(floor(sample * gain)) : sample;
+}
+
+void TestConvertFixed()
+{
+    constexpr size_t Frames = 1152 + 7;
+
+    // well within [-1.0, 1.0], but also beyond, as libmad may overshoot
+    mt19937 gen(1);
+    uniform_int_distribution<int32_t> dist(-3 * (1 << 28), 3 * (1 << 28));
+    vector<int32_t> left(Frames), right(Frames);
+    for (size_t i = 0; i < Frames; i++)
+    {
+        left[i] = dist(gen);
+        right[i] = dist(gen);
+    }
+    left[0] = (1 << 28) - 1;
+    left[1] = -(1 << 28);
+    left[2] = -1;
+    left[3] = 15;
+    left[4] = -16;
+
+    for (float gain : {1.0f, 0.61f, 0.999f})
+    {
+        for (uint32_t channels : {1u, 2u})
+        {
+            // incl. offsets and sizes that dont fit the vectors
+            for (size_t offset : {size_t(0), size_t(3)})
+            {
+                const size_t frames = Frames - offset;
+                vector<int32_t> out(frames * channels + 1, 42);
+                MixConvertFixed(left.data() + offset, right.data() + offset, out.data(), frames, channels, gain);
+
+                for (size_t f = 0; f < frames; f++)
+                {
+                    TEST_ASSERT(out[f * channels] == FixedToInt24Reference(left[f + offset], gain));
+                    if (channels == 2)
+                    {
+                        TEST_ASSERT(out[f * channels + 1] == FixedToInt24Reference(right[f + offset], gain));
+                    }
+                }
+                TEST_ASSERT(out.back() == 42);
+            }
+        }
+    }
+
+    // mono decoded to stereo
+    vector<int32_t> out(Frames * 2);
+    MixConvertFixed(left.data(), left.data(), out.data(), Frames, 2, 1.0f);
+    for (size_t f = 0; f < Frames; f++)
+    {
+        TEST_ASSERT(out[2 * f] == out[2 * f + 1]);
+    }
+}
+
+
+template<typename T>
+void TestInterleave()
+{
+    constexpr size_t Frames = 1024 + 13;
+    constexpr uint32_t MaxChannels = 6;
+
+    vector<vector<T>> planes(MaxChannels, vector<T>(Frames));
+    for (uint32_t c = 0; c < MaxChannels; c++)
+    {
+        for (size_t f = 0; f < Frames; f++)
+        {
+            planes[c][f] = static_cast<T>(c * 1000 + f % 1000);
+        }
+    }
+
+    for (uint32_t channels : {1u, 2u, 6u})
+    {
+        // incl. offsets and sizes that dont fit the vectors
+        for (size_t offset : {size_t(0), size_t(3)})
+        {
+            const size_t frames = Frames - offset;
+            vector<const T *> in(channels);
+            for (uint32_t c = 0; c < channels; c++)
+            {
+                in[c] = planes[c].data() + offset;
+            }
+
+            vector<T> out(frames * channels + 1, static_cast<T>(42));
+            MixInterleave(in.data(), out.data(), frames, channels);
+
+            for (size_t f = 0; f < frames; f++)
+            {
+                for (uint32_t c = 0; c < channels; c++)
+                {
+                    TEST_ASSERT(out[f * channels + c] == planes[c][f + offset]);
+                }
+            }
+            TEST_ASSERT(out.back() == static_cast<T>(42));
+        }
+    }
+}
+
+
+int main()
+{
+    NullOutput output;
+
+    for (MixIsa isa : {MixIsa::Scalar, MixIsa::SSE2, MixIsa::AVX2})
+    {
+        if (!MixSetIsa(isa))
+        {
+            cout << "skipping unsupported instruction set " << static_cast<int>(isa) << endl;
+            continue;
+        }
+
+        for (float volume : {1.0f, 0.7f})
+        {
+            output.setVolume(volume);
+
+            TestAllLayouts<int16_t, int16_t>(output);
+            TestAllLayouts<int32_t, int32_t>(output);
+            TestAllLayouts<float, float>(output);
+            TestAllLayouts<int16_t, float>(output);
+            TestAllLayouts<int32_t, float>(output);
+        }
+
+        TestPassthrough<int16_t>(output);
+        TestPassthrough<int32_t>(output);
+        TestPassthrough<float>(output);
+        TestRamp(output);
+        TestConvertFixed();
+        TestInterleave<int16_t>();
+        TestInterleave<int32_t>();
+        TestInterleave<float>();
+    }
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PcmBudget.h"
+#include "Song.h"
+#include "Test.h"
+
+using namespace std;
+
+constexpr size_t SongBytes = 1000;
+
+// a song, that only accounts its buffer against a budget, without allocating anything
+class BudgetTestSong : public Song
+{
+    PcmBudget &budget;
+
+    public:
+    bool holdsBuffer = false;
+    int releases = 0;
+
+    BudgetTestSong(PcmBudget &budget, string name)
+    : Song(std::move(name)), budget(budget)
+    {
+    }
+
+    ~BudgetTestSong() override
+    {
+        this->releaseBuffer();
+    }
+
+    void open() override
+    {
+    }
+
+    void close() noexcept override
+    {
+    }
+
+    void fillBuffer() override
+    {
+        if (!this->holdsBuffer)
+        {
+            // mimic StandardWrapper: the whole song, if it fits, otherwise a small ring buffer that is needed anyway
+            if (!this->budget.tryReserve(this, SongBytes))
+            {
+                this->budget.reserve(this, SongBytes / 10);
+            }
+            this->holdsBuffer = true;
+        }
+    }
+
+    void releaseBuffer() noexcept override
+    {
+        this->budget.release(this);
+        if (this->holdsBuffer)
+        {
+            this->holdsBuffer = false;
+            this->releases++;
+        }
+    }
+
+    frame_t getFrames() const override
+    {
+        return 1;
+    }
+
+    frame_t getFramesRendered() const noexcept override
+    {
+        return this->holdsBuffer ? 1 : 0;
+    }
+};
+
+static void play(PcmBudget &budget, BudgetTestSong &song)
+{
+    budget.reuse(&song);
+    song.fillBuffer();
+}
+
+int main()
+{
+    PcmBudget budget(3 * SongBytes);
+
+    BudgetTestSong a(budget, "a"), b(budget, "b"), c(budget, "c"), d(budget, "d");
+
+    // play a, b, c one after another, retaining each one afterwards
+    play(budget, a);
+    budget.retain(&a);
+    play(budget, b);
+    budget.retain(&b);
+    play(budget, c);
+
+    PcmBudget::Stats s = budget.getStats();
+    TEST_ASSERT(s.used == 3 * SongBytes);
+    TEST_ASSERT(s.retained == 2 * SongBytes);
+    TEST_ASSERT(s.retainedSongs == 2);
+    TEST_ASSERT(s.hits == 0 && s.misses == 3);
+
+    // going back to a is a hit and doesnt require a to be rendered again
+    budget.retain(&c);
+    TEST_ASSERT(budget.reuse(&a));
+    TEST_ASSERT(a.holdsBuffer && a.releases == 0);
+
+    // d doesnt fit, so the least recently used retained song (b) has to go
+    play(budget, d);
+    TEST_ASSERT(!b.holdsBuffer && b.releases == 1);
+    TEST_ASSERT(c.holdsBuffer && d.holdsBuffer);
+
+    s = budget.getStats();
+    TEST_ASSERT(s.used == 3 * SongBytes);
+    TEST_ASSERT(s.retainedSongs == 1);
+    TEST_ASSERT(s.hits == 1 && s.misses == 4);
+    TEST_ASSERT(s.evictions == 1);
+
+    // e fits into the budget once c is evicted
+    budget.reuse(&c);
+    budget.retain(&c);
+    BudgetTestSong e(budget, "e");
+    play(budget, e);
+    TEST_ASSERT(!c.holdsBuffer);
+    TEST_ASSERT(a.holdsBuffer && d.holdsBuffer && e.holdsBuffer);
+
+    // songs being played are never evicted, so f only gets a ring buffer, which exceeds the budget
+    BudgetTestSong f(budget, "f");
+    play(budget, f);
+    TEST_ASSERT(a.holdsBuffer && d.holdsBuffer && e.holdsBuffer && f.holdsBuffer);
+    s = budget.getStats();
+    TEST_ASSERT(s.used == 3 * SongBytes + SongBytes / 10);
+    TEST_ASSERT(s.retainedSongs == 0);
+    TEST_ASSERT(s.hits == 2 && s.misses == 6);
+    TEST_ASSERT(s.evictions == 2);
+
+    // releasing a retained song forgets about it
+    a.releaseBuffer();
+    d.releaseBuffer();
+    e.releaseBuffer();
+    f.releaseBuffer();
+    TEST_ASSERT(budget.getStats().used == 0);
+
+    // concurrent playback and eviction must keep the accounting consistent
+    vector<BudgetTestSong *> songs;
+    for (int i = 0; i < 16; i++)
+    {
+        songs.push_back(new BudgetTestSong(budget, to_string(i)));
+    }
+
+    vector<thread> players;
+    for (int t = 0; t < 4; t++)
+    {
+        players.emplace_back([&, t]() {
+            for (int i = 0; i < 500; i++)
+            {
+                BudgetTestSong *s = songs[(t * 4 + i % 4)];
+                play(budget, *s);
+                budget.retain(s);
+            }
+        });
+    }
+    for (thread &t : players)
+    {
+        t.join();
+    }
+
+    s = budget.getStats();
+    TEST_ASSERT(s.used <= 3 * SongBytes);
+    TEST_ASSERT(s.hits + s.misses == 8 + 4 * 500);
+
+    for (BudgetTestSong *song : songs)
+    {
+        delete song;
+    }
+    TEST_ASSERT(budget.getStats().used == 0);
+    TEST_ASSERT(budget.getStats().retainedSongs == 0);
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include <sys/mman.h>
+
+#include "PcmCache.h"
+#include "Test.h"
+
+using namespace std;
+
+constexpr size_t EntryBytes = 4096;
+
+static void createEntry(PcmCache &cache, const string &key, uint8_t pattern)
+{
+    string tmpFile;
+    void *pcm = cache.create(key, EntryBytes, tmpFile);
+    TEST_ASSERT(pcm != nullptr);
+    TEST_ASSERT(filesystem::exists(tmpFile));
+
+    // not visible until committed
+    TEST_ASSERT(cache.open(key, EntryBytes) == nullptr);
+
+    uint8_t *p = static_cast<uint8_t *>(pcm);
+    for (size_t i = 0; i < EntryBytes; i++)
+    {
+        p[i] = static_cast<uint8_t>(pattern + i);
+    }
+
+    cache.commit(key, tmpFile);
+    TEST_ASSERT(!filesystem::exists(tmpFile));
+    munmap(pcm, EntryBytes);
+
+    // make sure entries differ in their time of last use
+    this_thread::sleep_for(chrono::milliseconds(20));
+}
+
+static bool hasEntry(PcmCache &cache, const string &key, uint8_t pattern)
+{
+    void *pcm = cache.open(key, EntryBytes);
+    if (pcm == nullptr)
+    {
+        return false;
+    }
+
+    const uint8_t *p = static_cast<const uint8_t *>(pcm);
+    for (size_t i = 0; i < EntryBytes; i++)
+    {
+        TEST_ASSERT(p[i] == static_cast<uint8_t>(pattern + i));
+    }
+    munmap(pcm, EntryBytes);
+
+    this_thread::sleep_for(chrono::milliseconds(20));
+    return true;
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/anmp-pcmcache-XXXXXX";
+    TEST_ASSERT(mkdtemp(dirTemplate) != nullptr);
+    const string dir = dirTemplate;
+
+    {
+        PcmCache cache(dir, 3 * EntryBytes);
+        TEST_ASSERT(cache.size() == 0);
+        TEST_ASSERT(cache.open("a", EntryBytes) == nullptr);
+
+        // round trip
+        createEntry(cache, "a", 1);
+        TEST_ASSERT(hasEntry(cache, "a", 1));
+        TEST_ASSERT(cache.size() == EntryBytes);
+
+        // entries of unexpected size are never used
+        TEST_ASSERT(cache.open("a", EntryBytes / 2) == nullptr);
+
+        // entries exceeding the cache are not even created
+        string tmpFile;
+        TEST_ASSERT(cache.create("huge", 4 * EntryBytes, tmpFile) == nullptr);
+
+        // discarded entries leave nothing behind
+        void *pcm = cache.create("b", EntryBytes, tmpFile);
+        TEST_ASSERT(pcm != nullptr);
+        munmap(pcm, EntryBytes);
+        cache.discard(tmpFile);
+        TEST_ASSERT(!filesystem::exists(tmpFile));
+        TEST_ASSERT(cache.open("b", EntryBytes) == nullptr);
+
+        // least recently used entries are evicted first
+        createEntry(cache, "b", 2);
+        createEntry(cache, "c", 3);
+        TEST_ASSERT(cache.size() == 3 * EntryBytes);
+        TEST_ASSERT(hasEntry(cache, "a", 1));
+        createEntry(cache, "d", 4);
+        TEST_ASSERT(cache.size() == 3 * EntryBytes);
+        TEST_ASSERT(!hasEntry(cache, "b", 2));
+        TEST_ASSERT(hasEntry(cache, "a", 1));
+        TEST_ASSERT(hasEntry(cache, "c", 3));
+        TEST_ASSERT(hasEntry(cache, "d", 4));
+    }
+
+    {
+        // temporary files left behind by a crashed process are removed, unless they might still be written by another one
+        const string staleFile = dir + "/0123456789abcdef.pcm.Ab12Cd", recentFile = dir + "/fedcba9876543210.pcm.Ef34Gh";
+        ofstream(staleFile) << string(EntryBytes, 'x');
+        ofstream(recentFile) << string(EntryBytes, 'x');
+        filesystem::last_write_time(staleFile, filesystem::file_time_type::clock::now() - chrono::hours(2));
+
+        PcmCache cache(dir, 3 * EntryBytes);
+        TEST_ASSERT(!filesystem::exists(staleFile));
+        TEST_ASSERT(filesystem::exists(recentFile));
+        TEST_ASSERT(cache.size() == 3 * EntryBytes + EntryBytes);
+
+        // they occupy space, but only committed entries are evicted
+        createEntry(cache, "e", 5);
+        TEST_ASSERT(filesystem::exists(recentFile));
+        TEST_ASSERT(cache.size() == 3 * EntryBytes);
+        TEST_ASSERT(hasEntry(cache, "e", 5));
+        filesystem::remove(recentFile);
+    }
+
+    {
+        const string file1 = dir + "/file1", file2 = dir + "/file2";
+        ofstream(file1) << "some content";
+        ofstream(file2) << "some other content";
+
+        const string hash = PcmCache::hashFile(file1);
+        TEST_ASSERT(!hash.empty());
+        TEST_ASSERT(hash == PcmCache::hashFile(file1));
+        TEST_ASSERT(hash != PcmCache::hashFile(file2));
+        TEST_ASSERT(PcmCache::hashFile(dir + "/nonexisting").empty());
+    }
+
+    filesystem::remove_all(dir);
+
+    return 0;
+}
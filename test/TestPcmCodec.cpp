@@ -0,0 +1,136 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "PcmCodec.h"
+#include "Test.h"
+
+using namespace std;
+
+template<typename T>
+static bool SameBits(const T &a, const T &b)
+{
+    return memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+// encodes several blocks one after another, then decodes them in reverse order
+template<typename T>
+static void RoundTrip(const vector<T> &pcm, uint32_t channels)
+{
+    const frame_t frames = pcm.size() / channels;
+
+    vector<uint8_t> encoded;
+    vector<size_t> offsets;
+    for (frame_t f = 0; f < frames; f += PcmBlockFrames)
+    {
+        offsets.push_back(encoded.size());
+        PcmEncodeBlock(pcm.data() + f * channels, channels, min(PcmBlockFrames, frames - f), encoded);
+    }
+    offsets.push_back(encoded.size());
+
+    vector<T> decoded(pcm.size());
+    for (size_t b = offsets.size() - 1; b-- > 0;)
+    {
+        const frame_t f = b * PcmBlockFrames;
+        const size_t consumed = PcmDecodeBlock(encoded.data() + offsets[b], channels, min(PcmBlockFrames, frames - f), decoded.data() + f * channels);
+        TEST_ASSERT_EQ(consumed, offsets[b + 1] - offsets[b]);
+    }
+
+    for (size_t i = 0; i < pcm.size(); i++)
+    {
+        TEST_ASSERT(SameBits(pcm[i], decoded[i]));
+    }
+}
+
+template<typename T>
+static vector<T> Sine(frame_t frames, uint32_t channels, double amplitude)
+{
+    vector<T> pcm(frames * channels);
+    for (frame_t f = 0; f < frames; f++)
+    {
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            pcm[f * channels + c] = static_cast<T>(amplitude * sin(f * 0.01 * (c + 1)));
+        }
+    }
+    return pcm;
+}
+
+template<typename T>
+static vector<T> Noise(frame_t frames, uint32_t channels)
+{
+    mt19937_64 rng(42);
+    vector<T> pcm(frames * channels);
+    for (T &s : pcm)
+    {
+        uint64_t r = rng();
+        memcpy(&s, &r, sizeof(T));
+    }
+    return pcm;
+}
+
+template<typename T>
+static void TestType(double amplitude)
+{
+    for (uint32_t channels : {1u, 2u, 6u})
+    {
+        // incl. a partial last block and single frames
+        for (frame_t frames : {frame_t(1), frame_t(2), PcmBlockFrames, 3 * PcmBlockFrames + 123})
+        {
+            RoundTrip(Sine<T>(frames, channels, amplitude), channels);
+            RoundTrip(Noise<T>(frames, channels), channels);
+            RoundTrip(vector<T>(frames * channels, T{}), channels);
+        }
+    }
+}
+
+int main()
+{
+    TestType<int16_t>(numeric_limits<int16_t>::max());
+    TestType<int32_t>(numeric_limits<int32_t>::max());
+    TestType<uint8_t>(127);
+    TestType<float>(1.0);
+    TestType<double>(1.0);
+
+    // biggest possible jumps
+    RoundTrip<int16_t>({numeric_limits<int16_t>::min(), numeric_limits<int16_t>::max(), numeric_limits<int16_t>::min(), 0}, 1);
+    RoundTrip<int32_t>({numeric_limits<int32_t>::min(), numeric_limits<int32_t>::max(), -1, numeric_limits<int32_t>::min()}, 2);
+
+    // special floating point values must survive as well
+    RoundTrip<float>({0.0f, -0.0f, numeric_limits<float>::infinity(), -numeric_limits<float>::infinity(), numeric_limits<float>::quiet_NaN(), numeric_limits<float>::denorm_min(), -1.0f, 1.0f}, 1);
+    RoundTrip<double>({0.0, -0.0, numeric_limits<double>::infinity(), -numeric_limits<double>::max(), numeric_limits<double>::quiet_NaN(), numeric_limits<double>::denorm_min()}, 2);
+
+    vector<sndfile_sample_t> snd(2 * PcmBlockFrames);
+    for (size_t i = 0; i < snd.size(); i++)
+    {
+        snd[i].i = static_cast<int32_t>(i * 1000) - 5000000;
+    }
+    RoundTrip(snd, 2);
+
+    // a quiet signal must actually be compressed
+    vector<int16_t> quiet = Sine<int16_t>(PcmBlockFrames, 2, 1000);
+    vector<uint8_t> encoded;
+    PcmEncodeBlock(quiet.data(), 2, PcmBlockFrames, encoded);
+    TEST_ASSERT(encoded.size() < quiet.size() * sizeof(int16_t) / 2);
+
+    // so does PCM with less precision than its sample format
+    vector<int32_t> coarse(PcmBlockFrames * 2);
+    for (size_t i = 0; i < coarse.size(); i++)
+    {
+        coarse[i] = static_cast<int32_t>(quiet[i]) * 65536;
+    }
+    RoundTrip(coarse, 2);
+    encoded.clear();
+    PcmEncodeBlock(coarse.data(), 2, PcmBlockFrames, encoded);
+    TEST_ASSERT(encoded.size() < coarse.size() * sizeof(int32_t) / 4);
+
+    // silence takes almost nothing
+    vector<float> silence(PcmBlockFrames * 2, 0.0f);
+    encoded.clear();
+    PcmEncodeBlock(silence.data(), 2, PcmBlockFrames, encoded);
+    TEST_ASSERT(encoded.size() <= 2 * (2 + sizeof(float)));
+
+    return 0;
+}
@@ -0,0 +1,394 @@
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Config.h"
+#include "NullOutput.h"
+#include "Player.h"
+#include "Playlist.h"
+#include "StandardWrapper.h"
+#include "Test.h"
+
+using namespace std;
+
+constexpr frame_t Period = 2048;
+
+// a song where every item holds the number of the frame it belongs to, plus an offset telling the songs apart
+class PlayerTestSong : public StandardWrapper<int32_t>
+{
+    const frame_t frames;
+    const vector<loop_t> loops;
+
+    // the frame, the decoder would render next
+    frame_t decoderPosition = 0;
+
+    public:
+    const int32_t Base;
+
+    // time open() takes
+    chrono::milliseconds openTime{0};
+    atomic<bool> openStarted{false};
+    atomic<int> closed{0};
+    thread::id openedBy;
+
+    // called by the player after playing frames up to the one given
+    function<void(frame_t)> onReadPosition;
+
+    PlayerTestSong(int32_t base, frame_t frames, vector<loop_t> loops = {})
+    : StandardWrapper<int32_t>(""), frames(frames), loops(std::move(loops)), Base(base)
+    {
+        this->Format.SampleFormat = SampleFormat_t::int32;
+        this->Format.SampleRate = 44100;
+        this->Format.SetVoices(1);
+        this->Format.VoiceChannels[0] = 2;
+        this->buildLoopTree();
+    }
+
+    ~PlayerTestSong() override
+    {
+        this->releaseBuffer();
+        this->close();
+    }
+
+    void open() override
+    {
+        this->openStarted = true;
+        this_thread::sleep_for(this->openTime);
+        this->openedBy = this_thread::get_id();
+        this->decoderPosition = 0;
+    }
+
+    void close() noexcept override
+    {
+        this->closed++;
+    }
+
+    frame_t getFrames() const override
+    {
+        return this->frames;
+    }
+
+    bool isSeekable() const noexcept override
+    {
+        return true;
+    }
+
+    void setReadPosition(frame_t frame) noexcept override
+    {
+        StandardWrapper<int32_t>::setReadPosition(frame);
+        if (this->onReadPosition)
+        {
+            this->onReadPosition(frame);
+        }
+    }
+
+    vector<loop_t> getLoopArray() const noexcept override
+    {
+        return this->loops;
+    }
+
+    void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override
+    {
+        STANDARDWRAPPER_RENDER(int32_t,
+                               for (int f = 0; f < framesToDoNow; f++) {
+                                   for (uint32_t c = 0; c < Channels; c++) {
+                                       pcm[f * Channels + c] = this->Base + static_cast<int32_t>(this->decoderPosition);
+                                   }
+                                   this->decoderPosition++;
+                               })
+    }
+
+    protected:
+    void seekDecoder(frame_t frame) override
+    {
+        this->decoderPosition = frame;
+    }
+};
+
+// records the first item of every frame written, taking about a millisecond per period
+class RecordingOutput : public NullOutput
+{
+    public:
+    using NullOutput::write;
+
+    mutex mtx;
+    vector<int32_t> frames;
+    // number of frames of every call to write()
+    vector<frame_t> writes;
+
+    vector<int32_t> recorded()
+    {
+        lock_guard<mutex> lck(this->mtx);
+        return this->frames;
+    }
+
+    protected:
+    int write(const int32_t *buffer, frame_t frames) override
+    {
+        const int ret = NullOutput::write(buffer, frames);
+        const int32_t *pcm = static_cast<const int32_t *>(this->lastWritten);
+        const uint8_t Channels = this->GetOutputChannels();
+        {
+            lock_guard<mutex> lck(this->mtx);
+            for (frame_t f = 0; f < frames; f++)
+            {
+                this->frames.push_back(pcm[f * Channels]);
+            }
+            this->writes.push_back(frames);
+        }
+
+        this_thread::sleep_for(chrono::microseconds(500));
+        return ret;
+    }
+};
+
+struct SongChanges
+{
+    mutex mtx;
+    vector<const Song *> songs;
+    vector<thread::id> threads;
+
+    static void OnCurrentSongChanged(void *context, const Song *s)
+    {
+        SongChanges *pthis = static_cast<SongChanges *>(context);
+        lock_guard<mutex> lck(pthis->mtx);
+        pthis->songs.push_back(s);
+        pthis->threads.push_back(this_thread::get_id());
+    }
+};
+
+void WaitUntilStopped(Player &player)
+{
+    const auto Timeout = chrono::steady_clock::now() + chrono::seconds(20);
+    while (player.IsPlaying())
+    {
+        TEST_ASSERT(chrono::steady_clock::now() < Timeout);
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    player.pause();
+}
+
+// checks that the frames of song "s" have been written from the beginning up to the end, starting at item "i" of "frames"
+void AssertWholeSong(const vector<int32_t> &frames, size_t &i, const PlayerTestSong &s)
+{
+    TEST_ASSERT(frames.size() >= i + s.getFrames());
+    for (frame_t f = 0; f < s.getFrames(); f++, i++)
+    {
+        TEST_ASSERT_EQ(frames[i], s.Base + f);
+    }
+}
+
+// the song following the current one is opened in the background and its first frames are written in the same period as the last frames of the current one
+void TestGaplessSongChange()
+{
+    Playlist playlist;
+    PlayerTestSong *a = new PlayerTestSong(1000000, 200 * Period + 300);
+    PlayerTestSong *b = new PlayerTestSong(2000000, 50 * Period + 77);
+    playlist.add(a);
+    playlist.add(b);
+    // terminate when reaching end of playlist
+    playlist.add(nullptr);
+
+    RecordingOutput *output = new RecordingOutput();
+    Player player(&playlist, output);
+    SongChanges changes;
+    player.onCurrentSongChanged += make_pair(&changes, &SongChanges::OnCurrentSongChanged);
+
+    player.play();
+    WaitUntilStopped(player);
+
+    TEST_ASSERT(changes.songs.size() == 3);
+    TEST_ASSERT(changes.songs[0] == a && changes.songs[1] == b && changes.songs[2] == nullptr);
+    // b has been opened by the thread preloading it, rather than the playback thread when changing the song
+    TEST_ASSERT(b->openedBy != changes.threads[1]);
+
+    const vector<int32_t> frames = output->recorded();
+    size_t i = 0;
+    AssertWholeSong(frames, i, *a);
+    AssertWholeSong(frames, i, *b);
+    TEST_ASSERT(i == frames.size());
+
+    // all periods are complete, except for the last one
+    const size_t Splice = a->getFrames();
+    size_t begin = 0;
+    bool spliced = false;
+    for (size_t w = 0; w < output->writes.size(); w++)
+    {
+        TEST_ASSERT(w + 1 == output->writes.size() || output->writes[w] == Period);
+        spliced |= begin < Splice && Splice < begin + output->writes[w];
+        begin += output->writes[w];
+    }
+    TEST_ASSERT(spliced);
+}
+
+// cancelling the preload while the song following the current one is being opened must wait for it and close it again
+void TestCancelPreloadWhileRunning()
+{
+    Playlist playlist;
+    PlayerTestSong *a = new PlayerTestSong(1000000, 200 * Period + 300);
+    PlayerTestSong *b = new PlayerTestSong(2000000, 50 * Period + 77);
+    b->openTime = chrono::milliseconds(200);
+    playlist.add(a);
+    playlist.add(b);
+    playlist.add(nullptr);
+
+    RecordingOutput *output = new RecordingOutput();
+    Player player(&playlist, output);
+
+    player.play();
+    while (!b->openStarted)
+    {
+        TEST_ASSERT(player.IsPlaying());
+        this_thread::yield();
+    }
+    player.cancelPreload();
+    TEST_ASSERT(b->closed == 1);
+
+    // b is opened again by the playback thread then
+    WaitUntilStopped(player);
+
+    const vector<int32_t> frames = output->recorded();
+    size_t i = 0;
+    AssertWholeSong(frames, i, *a);
+    AssertWholeSong(frames, i, *b);
+    TEST_ASSERT(i == frames.size());
+}
+
+struct PlayheadChanges
+{
+    atomic<frame_t> last{-1};
+
+    static void OnPlayheadChanged(void *context, frame_t pos)
+    {
+        static_cast<PlayheadChanges *>(context)->last = pos;
+    }
+};
+
+// stopping while frames are pending in the BlockAssembler, that span a loop jump, must continue with the first of them when playing again
+void TestStopMidAssembly()
+{
+    // a loop shorter than a period, whose end isnt aligned to a period either
+    const frame_t LoopStop = 3 * Period + 100;
+    const frame_t LoopStart = LoopStop - 700;
+    loop_t loop;
+    loop.start = LoopStart;
+    loop.stop = LoopStop;
+    loop.count = 0;
+
+    Playlist playlist;
+    PlayerTestSong *a = new PlayerTestSong(1000000, LoopStop + 5000, {loop});
+    playlist.add(a);
+
+    RecordingOutput *output = new RecordingOutput();
+    Player player(&playlist, output);
+    PlayheadChanges playhead;
+    player.onPlayheadChanged += make_pair(&playhead, &PlayheadChanges::OnPlayheadChanged);
+
+    // the first 100 frames before the loop end and the whole loop once are pending when reaching the loop end for the second time.
+    // stop right then, by blocking the playback thread until the player has been paused
+    atomic<int> loopStops{0};
+    atomic<bool> pauseRequested{false};
+    a->onReadPosition = [&](frame_t frame) {
+        if (frame == LoopStop && ++loopStops == 2)
+        {
+            pauseRequested = true;
+            while (player.IsPlaying())
+            {
+                this_thread::yield();
+            }
+        }
+    };
+
+    player.play();
+    while (!pauseRequested)
+    {
+        TEST_ASSERT(player.IsPlaying());
+        this_thread::yield();
+    }
+    player.pause();
+    TEST_ASSERT(playhead.last == 3 * Period);
+
+    player.play();
+    while (output->recorded().size() < 30 * Period)
+    {
+        TEST_ASSERT(player.IsPlaying());
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    player.pause();
+
+    // no frame has been lost or played twice
+    const vector<int32_t> frames = output->recorded();
+    TEST_ASSERT(frames[0] == a->Base);
+    for (size_t i = 1; i < frames.size(); i++)
+    {
+        TEST_ASSERT(frames[i] == frames[i - 1] + 1 || (frames[i - 1] == a->Base + LoopStop - 1 && frames[i] == a->Base + LoopStart));
+    }
+}
+
+struct FadeoutCounter
+{
+    atomic<int> finished{0};
+
+    static void OnFadeoutFinished(void *context)
+    {
+        static_cast<FadeoutCounter *>(context)->finished++;
+    }
+};
+
+// onFadeoutFinished is fired exactly once per fadeout, whether it has been played completely or playback stopped before
+void TestFadeout()
+{
+    loop_t loop;
+    loop.start = 0;
+    loop.stop = 20 * Period;
+    loop.count = 0;
+
+    Playlist playlist;
+    playlist.add(new PlayerTestSong(1000000, loop.stop, {loop}));
+
+    Player player(&playlist, new RecordingOutput());
+    FadeoutCounter counter;
+    player.onFadeoutFinished += make_pair(&counter, &FadeoutCounter::OnFadeoutFinished);
+
+    player.play();
+    player.fadeout(50);
+    const auto Timeout = chrono::steady_clock::now() + chrono::seconds(20);
+    while (counter.finished == 0)
+    {
+        TEST_ASSERT(player.IsPlaying());
+        TEST_ASSERT(chrono::steady_clock::now() < Timeout);
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    // playback continues silently
+    this_thread::sleep_for(chrono::milliseconds(100));
+    TEST_ASSERT(player.IsPlaying());
+    player.pause();
+    TEST_ASSERT(counter.finished == 1);
+
+    // playing again undoes the fadeout, stopping before the next one completed is reported as well
+    player.play();
+    player.fadeout(60000);
+    this_thread::sleep_for(chrono::milliseconds(100));
+    player.pause();
+    TEST_ASSERT(counter.finished == 2);
+    this_thread::sleep_for(chrono::milliseconds(100));
+    TEST_ASSERT(counter.finished == 2);
+}
+
+
+int main()
+{
+    gConfig.PreRenderTime = 0;
+    gConfig.FramesToRender = Period;
+    gConfig.GaplessPreloadTime = 10000;
+
+    TestGaplessSongChange();
+    TestCancelPreloadWhileRunning();
+    TestStopMidAssembly();
+    TestFadeout();
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "RenderPolicy.h"
+#include "Test.h"
+
+using namespace std;
+
+using Mode = RenderPolicy::Mode;
+using Pressure = RenderPolicy::Pressure;
+
+constexpr size_t MiB = 1024 * 1024;
+
+static void writeFile(const filesystem::path &file, const string &content)
+{
+    filesystem::create_directories(file.parent_path());
+    ofstream out(file, ios::trunc);
+    out << content;
+}
+
+static void writePsi(const filesystem::path &root, double some, double full)
+{
+    writeFile(root / "proc/pressure/memory",
+              "some avg10=" + to_string(some) + " avg60=0.00 avg300=0.00 total=12345\n"
+              "full avg10=" + to_string(full) + " avg60=0.00 avg300=0.00 total=678\n");
+}
+
+static void writeMeminfo(const filesystem::path &root, size_t available)
+{
+    writeFile(root / "proc/meminfo",
+              "MemTotal:       16000000 kB\n"
+              "MemFree:          100000 kB\n"
+              "MemAvailable:   " + to_string(available / 1024) + " kB\n"
+              "Buffers:          100000 kB\n");
+}
+
+int main()
+{
+    const filesystem::path root = filesystem::temp_directory_path() / ("anmp-test-renderpolicy-" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    filesystem::remove_all(root);
+    filesystem::create_directories(root);
+
+    // nothing known: everything is held in memory, like without a policy
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::None);
+        TEST_ASSERT(policy.decide(100000 * MiB, 0) == Mode::WholeSong);
+
+        RenderPolicy::Stats stats = policy.getStats();
+        TEST_ASSERT(stats.someAvg10 < 0);
+        TEST_ASSERT(stats.fullAvg10 < 0);
+        TEST_ASSERT(stats.available == SIZE_MAX);
+    }
+
+    // no pressure: up to half of the memory available is used
+    writeMeminfo(root, 1024 * MiB);
+    writePsi(root, 0.5, 0);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::None);
+        TEST_ASSERT(policy.decide(400 * MiB, 0) == Mode::WholeSong);
+        TEST_ASSERT(policy.decide(600 * MiB, 10 * MiB) == Mode::LoopRegions);
+        TEST_ASSERT(policy.decide(600 * MiB, 600 * MiB) == Mode::Streaming);
+
+        RenderPolicy::Stats stats = policy.getStats();
+        TEST_ASSERT(stats.someAvg10 == 0.5);
+        TEST_ASSERT(stats.fullAvg10 == 0);
+        TEST_ASSERT(stats.available == 1024 * MiB);
+        TEST_ASSERT(stats.decisions[static_cast<int>(Mode::WholeSong)] == 1);
+        TEST_ASSERT(stats.decisions[static_cast<int>(Mode::LoopRegions)] == 1);
+        TEST_ASSERT(stats.decisions[static_cast<int>(Mode::Streaming)] == 1);
+        TEST_ASSERT(stats.downgrades == 0);
+    }
+
+    // some pressure: only an eighth
+    writePsi(root, 2, 0);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::Some);
+        TEST_ASSERT(policy.decide(100 * MiB, 0) == Mode::WholeSong);
+        TEST_ASSERT(policy.decide(200 * MiB, 100 * MiB) == Mode::LoopRegions);
+        TEST_ASSERT(policy.decide(400 * MiB, 200 * MiB) == Mode::Streaming);
+    }
+
+    // high pressure, because of tasks being stalled often, all of them being stalled, or memory running out: streaming only
+    writePsi(root, 20, 0);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::High);
+        TEST_ASSERT(policy.decide(1 * MiB, 0) == Mode::Streaming);
+    }
+    writePsi(root, 0, 1.5);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::High);
+    }
+    writePsi(root, 0, 0);
+    writeMeminfo(root, 32 * MiB);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::High);
+    }
+    writeMeminfo(root, 1024 * MiB);
+
+    // cgroup v2: the tightest limit of the cgroup and its parents applies
+    writeFile(root / "proc/self/cgroup", "0::/user.slice/anmp\n");
+    writeFile(root / "sys/fs/cgroup/user.slice/memory.max", to_string(300 * MiB) + "\n");
+    writeFile(root / "sys/fs/cgroup/user.slice/memory.current", to_string(100 * MiB) + "\n");
+    writeFile(root / "sys/fs/cgroup/user.slice/anmp/memory.max", "max\n");
+    writeFile(root / "sys/fs/cgroup/user.slice/anmp/memory.current", to_string(50 * MiB) + "\n");
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::None);
+        TEST_ASSERT(policy.getStats().available == 200 * MiB);
+        TEST_ASSERT(policy.decide(150 * MiB, 0) == Mode::LoopRegions);
+    }
+
+    // cgroup v1
+    writeFile(root / "proc/self/cgroup", "12:cpu,cpuacct:/anmp\n4:memory:/anmp\n");
+    writeFile(root / "sys/fs/cgroup/memory/anmp/memory.limit_in_bytes", to_string(512 * MiB) + "\n");
+    writeFile(root / "sys/fs/cgroup/memory/anmp/memory.usage_in_bytes", to_string(112 * MiB) + "\n");
+    writeFile(root / "sys/fs/cgroup/memory/memory.limit_in_bytes", "9223372036854771712\n");
+    writeFile(root / "sys/fs/cgroup/memory/memory.usage_in_bytes", to_string(4096 * MiB) + "\n");
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.getStats().available == SIZE_MAX);
+        TEST_ASSERT(policy.poll() == Pressure::None);
+        TEST_ASSERT(policy.getStats().available == 400 * MiB);
+    }
+    filesystem::remove(root / "proc/self/cgroup");
+
+    // the pressure is read again after a second at most, a rise counts as downgrade
+    writePsi(root, 0, 0);
+    {
+        RenderPolicy policy(root.string());
+        TEST_ASSERT(policy.poll() == Pressure::None);
+
+        writePsi(root, 50, 10);
+        TEST_ASSERT(policy.poll() == Pressure::None);
+
+        TEST_ASSERT(policy.pressure() == Pressure::None);
+        this_thread::sleep_for(chrono::milliseconds(1100));
+        TEST_ASSERT(policy.pressure() == Pressure::None);
+        TEST_ASSERT(policy.poll() == Pressure::High);
+        TEST_ASSERT(policy.pressure() == Pressure::High);
+        TEST_ASSERT(policy.getStats().downgrades == 1);
+
+        writePsi(root, 0, 0);
+        this_thread::sleep_for(chrono::milliseconds(1100));
+        TEST_ASSERT(policy.poll() == Pressure::None);
+        TEST_ASSERT(policy.getStats().downgrades == 1);
+    }
+
+    filesystem::remove_all(root);
+    return 0;
+}
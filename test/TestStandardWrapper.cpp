@@ -1,13 +1,37 @@
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "PcmCodec.h"
 #include "StandardWrapper.h"
 #include "Test.h"
 
 using namespace std;
 
 
+// whether pages passed to madvise(MADV_FREE) are dropped right away, like the kernel may do under memory pressure
+static atomic<bool> reclaimImmediately{false};
+
+#if defined(MADV_FREE) && defined(MADV_DONTNEED)
+// replaces the one of libc, to catch the calls of StandardWrapper
+extern "C" int madvise(void *addr, size_t len, int advice) noexcept
+{
+    if (reclaimImmediately && advice == MADV_FREE)
+    {
+        advice = MADV_DONTNEED;
+    }
+    return static_cast<int>(syscall(SYS_madvise, addr, len, advice));
+}
+#endif
+
 #define GEN_FRAMES(FORMAT, MAX, ITEM) static_cast<FORMAT>(((ITEM)*1.0L) / (MAX))
 
 // minimal example implementation of StandardWrapper
@@ -54,6 +78,302 @@ class TestSong : public StandardWrapper<FORMAT>
     }
 };
 
+// a song where every item holds the number of the frame it belongs to
+class CountingTestSong : public StandardWrapper<int32_t>
+{
+    const frame_t frames;
+    const bool seekable;
+    const vector<loop_t> loops;
+
+    // the frame, the decoder would render next
+    frame_t decoderPosition = 0;
+
+    public:
+    // time seekDecoder() takes, to make the decoder threads lag behind the player
+    chrono::microseconds seekTime{0};
+
+    CountingTestSong(frame_t frames, bool seekable, vector<loop_t> loops = {})
+    : StandardWrapper<int32_t>(""), frames(frames), seekable(seekable), loops(std::move(loops))
+    {
+    }
+
+    ~CountingTestSong() override
+    {
+        this->releaseBuffer();
+        this->close();
+    }
+
+    void open() override
+    {
+    }
+
+    void close() noexcept override
+    {
+    }
+
+    frame_t getFrames() const override
+    {
+        return this->frames;
+    }
+
+    bool isSeekable() const noexcept override
+    {
+        return this->seekable;
+    }
+
+    vector<loop_t> getLoopArray() const noexcept override
+    {
+        return this->loops;
+    }
+
+    void render(pcm_t *const bufferToFill, const uint32_t Channels, frame_t framesToRender) override
+    {
+        STANDARDWRAPPER_RENDER(int32_t,
+                               for (int f = 0; f < framesToDoNow; f++) {
+                                   for (uint32_t c = 0; c < Channels; c++) {
+                                       pcm[f * Channels + c] = static_cast<int32_t>(this->decoderPosition);
+                                   }
+                                   this->decoderPosition++;
+                               })
+    }
+
+    protected:
+    void seekDecoder(frame_t frame) override
+    {
+        this_thread::sleep_for(this->seekTime);
+        this->decoderPosition = frame;
+    }
+};
+
+// play from "playhead" up to "stop", like the player does
+void TestSeekablePlayback(CountingTestSong &songUnderTest, frame_t playhead, frame_t stop, bool expectResident = false)
+{
+    const uint32_t c = songUnderTest.Format.Channels();
+
+    if (songUnderTest.isSeekable())
+    {
+        songUnderTest.seek(playhead);
+        // the decoder may still be seeking in the background, the stale content of the ring buffer must not be played meanwhile
+        TEST_ASSERT(!songUnderTest.isSeeking() || songUnderTest.getFramesRendered() <= playhead);
+    }
+    while (playhead < stop)
+    {
+        size_t offset = 0;
+        frame_t available = 0;
+        const int32_t *pcm = static_cast<const int32_t *>(songUnderTest.getResidentPcm(playhead, offset, available));
+        if (pcm == nullptr && songUnderTest.isFullyResident())
+        {
+            // still being decompressed on the decoder threads, this->data doesnt hold the frames anyway
+            std::this_thread::yield();
+            continue;
+        }
+        TEST_ASSERT(!expectResident || pcm != nullptr);
+        if (pcm == nullptr)
+        {
+            pcm = static_cast<const int32_t *>(songUnderTest.data);
+            offset = (playhead * c) % songUnderTest.count;
+            available = std::min(songUnderTest.getFramesRendered(), stop) - playhead;
+            if (available <= 0)
+            {
+                songUnderTest.fillBuffer();
+                std::this_thread::yield();
+                continue;
+            }
+            available = std::min<frame_t>(available, (songUnderTest.count - offset) / c);
+        }
+        available = std::min(available, stop - playhead);
+
+        for (frame_t f = 0; f < available; f++)
+        {
+            TEST_ASSERT_EQ(pcm[offset + f * c], playhead + f);
+            TEST_ASSERT_EQ(pcm[offset + f * c + c - 1], playhead + f);
+        }
+
+        playhead += available;
+        songUnderTest.setReadPosition(playhead);
+        songUnderTest.fillBuffer();
+    }
+}
+
+void TestSeek(CountingTestSong &songUnderTest)
+{
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = 2;
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    TEST_ASSERT(songUnderTest.data != nullptr);
+    TEST_ASSERT(songUnderTest.count / 2 < static_cast<size_t>(songUnderTest.getFrames()));
+
+    const frame_t Chunk = gConfig.FramesToRender;
+    const frame_t Frames = songUnderTest.getFrames();
+
+    // play a bit, then jump back, like a loop does
+    TestSeekablePlayback(songUnderTest, 0, 3 * Chunk + 17);
+    TestSeekablePlayback(songUnderTest, 13, 2 * Chunk);
+    // jump far ahead to a frame not aligned to the chunk size
+    TestSeekablePlayback(songUnderTest, Frames - 2 * Chunk - 5, Frames - Chunk);
+    // skip a few frames that have most likely already been rendered
+    TestSeekablePlayback(songUnderTest, Frames - Chunk + 3, Frames);
+
+    TEST_ASSERT(songUnderTest.getFramesRendered() == Frames);
+
+    songUnderTest.releaseBuffer();
+    songUnderTest.close();
+}
+
+// play a loop of a song that cannot seek
+void TestResidentLoop(CountingTestSong &songUnderTest, frame_t loopStart, frame_t loopStop)
+{
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = 2;
+    songUnderTest.buildLoopTree();
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    TEST_ASSERT(songUnderTest.hasResidentLoops());
+    TEST_ASSERT(songUnderTest.count / 2 < static_cast<size_t>(loopStop - loopStart));
+
+    TestSeekablePlayback(songUnderTest, 0, loopStop);
+    for (int i = 0; i < 3; i++)
+    {
+        TestSeekablePlayback(songUnderTest, loopStart, loopStop, true);
+    }
+    TestSeekablePlayback(songUnderTest, loopStop, songUnderTest.getFrames());
+
+    TEST_ASSERT(songUnderTest.getFramesRendered() == songUnderTest.getFrames());
+
+    songUnderTest.releaseBuffer();
+    TEST_ASSERT(!songUnderTest.hasResidentLoops());
+    songUnderTest.close();
+}
+
+// hold the whole song compressed, play it, then jump around like loops do
+void TestCompressed(CountingTestSong &songUnderTest)
+{
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = 2;
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    TEST_ASSERT(songUnderTest.isFullyResident());
+    TEST_ASSERT(songUnderTest.count / 2 < static_cast<size_t>(songUnderTest.getFrames()));
+
+    const frame_t Frames = songUnderTest.getFrames();
+
+    TestSeekablePlayback(songUnderTest, 0, 3 * PcmBlockFrames + 17);
+    TestSeekablePlayback(songUnderTest, 13, 2 * PcmBlockFrames);
+    TestSeekablePlayback(songUnderTest, PcmBlockFrames - 1, Frames);
+
+    // everything has been compressed by now, so any frame is served by getResidentPcm(), once it has been decompressed
+    TEST_ASSERT(songUnderTest.isBufferComplete());
+    TestSeekablePlayback(songUnderTest, 5 * PcmBlockFrames + 3, 7 * PcmBlockFrames, true);
+    TestSeekablePlayback(songUnderTest, Frames - 10, Frames, true);
+    TestSeekablePlayback(songUnderTest, 0, PcmBlockFrames, true);
+
+    songUnderTest.releaseBuffer();
+    TEST_ASSERT(!songUnderTest.isFullyResident());
+    TEST_ASSERT(songUnderTest.data == nullptr);
+    songUnderTest.close();
+}
+
+// hold the whole song in memory, let the kernel throw away some of it, and play it nevertheless
+// play from "playhead" up to "stop" of a song held in memory as a whole, whose pages may be reclaimed, like the player does
+void TestPagedPlayback(CountingTestSong &songUnderTest, frame_t playhead, frame_t stop, frame_t period = 1024)
+{
+    const uint32_t c = songUnderTest.Format.Channels();
+    const frame_t Frames = songUnderTest.getFrames();
+    while (playhead < stop)
+    {
+        const frame_t available = songUnderTest.makeResident(playhead, std::min(period, stop - playhead));
+        // decoding reclaimed frames again must not rewind what is published to the player
+        TEST_ASSERT_EQ(songUnderTest.getFramesRendered(), Frames);
+        TEST_ASSERT(songUnderTest.isBufferComplete());
+        if (available == 0)
+        {
+            // still being decoded again, retry like the player would do
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        TEST_ASSERT(available <= stop - playhead);
+
+        const int32_t *p = static_cast<const int32_t *>(songUnderTest.data);
+        for (frame_t f = playhead; f < playhead + available; f++)
+        {
+            TEST_ASSERT_EQ(p[f * c], f);
+            TEST_ASSERT_EQ(p[f * c + c - 1], f);
+        }
+        playhead += available;
+    }
+}
+
+void TestReclaimed(CountingTestSong &songUnderTest)
+{
+    const uint32_t c = 2;
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = c;
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    const frame_t Frames = songUnderTest.getFrames();
+    TEST_ASSERT_EQ(songUnderTest.count, static_cast<size_t>(Frames) * c);
+    TEST_ASSERT(songUnderTest.isBufferComplete());
+
+    // simulate memory pressure: MADV_DONTNEED drops the pages immediately, just like the kernel would do with pages freed by MADV_FREE
+    const size_t PageSize = sysconf(_SC_PAGESIZE);
+    const size_t Bytes = songUnderTest.count * sizeof(int32_t);
+    uint8_t *pcm = static_cast<uint8_t *>(songUnderTest.data);
+    TEST_ASSERT(madvise(pcm + Bytes / 2 / PageSize * PageSize, Bytes / 4 / PageSize * PageSize, MADV_DONTNEED) == 0);
+
+    TestPagedPlayback(songUnderTest, 0, Frames);
+    // jump back into the region that has been reclaimed, like a loop would do
+    TestPagedPlayback(songUnderTest, Frames / 2 + 1234, Frames / 2 + 50000);
+    TestPagedPlayback(songUnderTest, Frames - 10, Frames);
+
+    songUnderTest.releaseBuffer();
+    songUnderTest.close();
+}
+
+// seek backwards over and over, while the decoder threads are still busy paging around the playhead before
+void TestSeekBackWhilePaging(CountingTestSong &songUnderTest)
+{
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = 2;
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    const frame_t Frames = songUnderTest.getFrames();
+    TEST_ASSERT(songUnderTest.isBufferComplete());
+
+    // any chunk freed is gone right away, so the frames read are wrong, if a chunk is freed while the player reads it
+    reclaimImmediately = true;
+    songUnderTest.seekTime = chrono::milliseconds(2);
+    const frame_t Chunk = 64 * 1024 / (2 * sizeof(int32_t));
+    for (int i = 0; i < 20; i++)
+    {
+        // rush through a few chunks, so that the decoder threads lag behind, then jump back to a chunk they are about to free
+        const frame_t Start = (i % 8) * Frames / 10;
+        TestPagedPlayback(songUnderTest, Start, Start + 6 * Chunk + 100);
+        const frame_t Back = Start + 4 * Chunk;
+        TestPagedPlayback(songUnderTest, Back, Back + 1024);
+
+        // while the decoder threads catch up, the frames around the playhead must stay there
+        const int32_t *p = static_cast<const int32_t *>(songUnderTest.data);
+        const auto Until = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);
+        while (std::chrono::steady_clock::now() < Until)
+        {
+            for (frame_t f = Back; f < Back + 1024; f++)
+            {
+                TEST_ASSERT_EQ(p[f * 2], f);
+            }
+        }
+    }
+    reclaimImmediately = false;
+
+    songUnderTest.releaseBuffer();
+    songUnderTest.close();
+}
+
 template<typename T>
 void TestMethod(TestSong<T> &songUnderTest)
 {
@@ -89,6 +409,59 @@ void TestMethod(TestSong<T> &songUnderTest)
     }
 }
 
+// consume the song like the player does, when the song is not held in memory as a whole
+template<typename T>
+void TestRingBuffer(TestSong<T> &songUnderTest)
+{
+    const uint32_t c = 2;
+    songUnderTest.Format.SetVoices(1);
+    songUnderTest.Format.VoiceChannels[0] = c;
+
+    songUnderTest.open();
+    songUnderTest.fillBuffer();
+    TEST_ASSERT(songUnderTest.data != nullptr);
+
+    const frame_t ringFrames = songUnderTest.count / c;
+    TEST_ASSERT(ringFrames < songUnderTest.getFrames());
+    TEST_ASSERT(ringFrames % gConfig.FramesToRender == 0);
+
+    frame_t playhead = 0;
+    while (playhead < songUnderTest.getFrames())
+    {
+        frame_t available = songUnderTest.getFramesRendered() - playhead;
+        TEST_ASSERT(available <= ringFrames);
+        if (available == 0)
+        {
+            songUnderTest.fillBuffer();
+            std::this_thread::yield();
+            continue;
+        }
+
+        T *pcm = static_cast<T *>(songUnderTest.data);
+        for (frame_t f = playhead; f < playhead + available; f++)
+        {
+            const frame_t chunkStart = f - f % gConfig.FramesToRender;
+            const frame_t chunkItems = std::min(gConfig.FramesToRender, songUnderTest.getFrames() - chunkStart) * c;
+            for (uint32_t i = 0; i < c; i++)
+            {
+                T item = GEN_FRAMES(T, chunkItems, (f - chunkStart) * c + i);
+                TEST_ASSERT_EQ(pcm[(f * c + i) % songUnderTest.count], item);
+            }
+        }
+
+        playhead += available;
+        songUnderTest.setReadPosition(playhead);
+        songUnderTest.fillBuffer();
+    }
+
+    TEST_ASSERT(songUnderTest.getFramesRendered() == songUnderTest.getFrames());
+
+    songUnderTest.releaseBuffer();
+    TEST_ASSERT(songUnderTest.data == nullptr);
+    TEST_ASSERT(songUnderTest.count == 0);
+    songUnderTest.close();
+}
+
 
 int main()
 {
@@ -183,5 +556,114 @@ int main()
         failed |= true;
     }
 
+    try
+    {
+        gConfig.RenderWholeSong = false;
+        gConfig.RenderAheadTime = 0;
+
+        TestSong<float> testFloat(gConfig.FramesToRender * 20 + 123);
+        testFloat.Format.SampleFormat = SampleFormat_t::float32;
+        testFloat.Format.SampleRate = 44100;
+        TestRingBuffer<float>(testFloat);
+
+        gConfig.RenderWholeSong = true;
+    }
+    catch (const AssertionException &e)
+    {
+        cerr << "testing ring buffer failed" << endl;
+        cerr << e.what() << endl;
+        failed |= true;
+    }
+
+    try
+    {
+        gConfig.RenderWholeSong = false;
+        gConfig.RenderAheadTime = 0;
+
+        CountingTestSong testSeek(gConfig.FramesToRender * 20 + 321, true);
+        testSeek.Format.SampleFormat = SampleFormat_t::int32;
+        testSeek.Format.SampleRate = 44100;
+        TestSeek(testSeek);
+
+        gConfig.RenderWholeSong = true;
+    }
+    catch (const AssertionException &e)
+    {
+        cerr << "testing seek failed" << endl;
+        cerr << e.what() << endl;
+        failed |= true;
+    }
+
+    try
+    {
+        gConfig.RenderWholeSong = false;
+        gConfig.RenderAheadTime = 0;
+
+        const frame_t Chunk = gConfig.FramesToRender;
+        loop_t loop;
+        loop.start = 3 * Chunk + 11;
+        loop.stop = 9 * Chunk + 5;
+        loop.count = 4;
+
+        CountingTestSong testLoop(Chunk * 20 + 321, false, {loop});
+        testLoop.Format.SampleFormat = SampleFormat_t::int32;
+        testLoop.Format.SampleRate = 44100;
+        TestResidentLoop(testLoop, loop.start, loop.stop);
+
+        gConfig.RenderWholeSong = true;
+    }
+    catch (const AssertionException &e)
+    {
+        cerr << "testing resident loops failed" << endl;
+        cerr << e.what() << endl;
+        failed |= true;
+    }
+
+#if defined(MADV_FREE) && defined(MADV_DONTNEED)
+    try
+    {
+        gConfig.useMadvFree = true;
+        gConfig.RenderAheadTime = 0;
+
+        CountingTestSong testReclaimed(40 * 8192 + 77, true);
+        testReclaimed.Format.SampleFormat = SampleFormat_t::int32;
+        testReclaimed.Format.SampleRate = 44100;
+        TestReclaimed(testReclaimed);
+
+        CountingTestSong testSeekBack(40 * 8192 + 77, true);
+        testSeekBack.Format.SampleFormat = SampleFormat_t::int32;
+        testSeekBack.Format.SampleRate = 44100;
+        TestSeekBackWhilePaging(testSeekBack);
+
+        gConfig.useMadvFree = false;
+    }
+    catch (const AssertionException &e)
+    {
+        cerr << "testing reclaimed PCM failed" << endl;
+        cerr << e.what() << endl;
+        failed |= true;
+    }
+#endif
+
+    try
+    {
+        gConfig.CompressWholeSong = true;
+        gConfig.PreRenderTime = 10;
+
+        CountingTestSong testCompressed(PcmBlockFrames * 20 + 321, false);
+        testCompressed.Format.SampleFormat = SampleFormat_t::int32;
+        testCompressed.Format.SampleRate = 44100;
+        TestCompressed(testCompressed);
+
+        gConfig.CompressWholeSong = false;
+        gConfig.PreRenderTime = 0;
+    }
+    catch (const AssertionException &e)
+    {
+        cerr << "testing compressed PCM failed" << endl;
+        cerr << e.what() << endl;
+        failed |= true;
+    }
+
     return failed ? -1 : 0;
 }